@@ -0,0 +1,147 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <wait.h>
+#include <ipm/ipm_queue.h>
+
+//  Measures the throughput of a queue shared by the same number of producer and consumer processes, for each power of
+//  two number of them up to the one given as the first argument (64 by default).
+
+enum
+{
+    ELEMENT_TOTAL = 1 << 22,    //  Elements pushed by all producers together in each run
+    QUEUE_CAPACITY = 1 << 12,
+    BATCH_SIZE = 16,
+    WAIT_TIMEOUT_MS = 10000,
+};
+
+static void report_error(const char* msg, const char* file, int line, const char* function, void* param)
+{
+    (void)param;
+    fprintf(stderr, "IPM Error %s:%d - %s: \"%s\"\n", file, line, function, msg);
+}
+
+static void* allocate(void* param, size_t size)
+{
+    (void)param;
+    return malloc(size);
+}
+
+static void deallocate(void* param, void* ptr)
+{
+    (void)param;
+    free(ptr);
+}
+
+static int run_worker(const ipm_context* ctx, int producer, uint64_t count)
+{
+    ipm_memory* mem;
+    ipm_queue* queue;
+    if (ipm_memory_open(ctx, "ipm_queue_bench", IPM_ACCESS_MODE_READ_WRITE, &mem) != IPM_RESULT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
+    if (ipm_queue_open(mem, &queue) != IPM_RESULT_SUCCESS)
+    {
+        ipm_memory_close(mem);
+        return EXIT_FAILURE;
+    }
+    uint64_t batch[BATCH_SIZE] = {0};
+    int status = EXIT_SUCCESS;
+    for (uint64_t done = 0; done < count;)
+    {
+        const unsigned wanted = count - done < BATCH_SIZE ? (unsigned)(count - done) : BATCH_SIZE;
+        unsigned moved;
+        const ipm_result res = producer
+                ? ipm_queue_push_wait(queue, batch, wanted, WAIT_TIMEOUT_MS, &moved)
+                : ipm_queue_pop_wait(queue, batch, wanted, WAIT_TIMEOUT_MS, &moved);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            fprintf(stderr, "Worker stopped, reason: %s\n", ipm_result_to_str(res));
+            status = EXIT_FAILURE;
+            break;
+        }
+        done += moved;
+    }
+    ipm_queue_close(queue);
+    ipm_memory_close(mem);
+    return status;
+}
+
+static double run_once(const ipm_context* ctx, unsigned workers)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t* const children = malloc(sizeof(*children) * 2 * workers);
+    for (unsigned i = 0; i < 2 * workers; ++i)
+    {
+        //  Work is split so that producers and consumers move the same number of elements in total
+        const unsigned index = i % workers;
+        const uint64_t count = ELEMENT_TOTAL / workers + (index < ELEMENT_TOTAL % workers);
+        children[i] = fork();
+        if (children[i] == 0)
+        {
+            _exit(run_worker(ctx, i < workers, count));
+        }
+    }
+    int failed = 0;
+    for (unsigned i = 0; i < 2 * workers; ++i)
+    {
+        int status;
+        if (children[i] < 0 || waitpid(children[i], &status, 0) != children[i] || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        {
+            failed = 1;
+        }
+    }
+    free(children);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (failed)
+    {
+        return 0;
+    }
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned max_workers = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 64;
+    const ipm_context ctx =
+            {
+            .report_callback = report_error,
+            .alloc_callback = allocate,
+            .free_callback = deallocate,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "ipm_queue_bench", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("%10s %10s %12s %16s\n", "producers", "consumers", "seconds", "elements/s");
+    for (unsigned workers = 1; workers <= max_workers; workers *= 2)
+    {
+        ipm_queue* queue;
+        res = ipm_queue_create(mem, sizeof(uint64_t), QUEUE_CAPACITY, &queue);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            break;
+        }
+        ipm_queue_close(queue);
+        const double seconds = run_once(&ctx, workers);
+        if (seconds == 0)
+        {
+            fprintf(stderr, "Run with %u producers and consumers failed\n", workers);
+            break;
+        }
+        printf("%10u %10u %12.4f %16.0f\n", workers, workers, seconds, ELEMENT_TOTAL / seconds);
+    }
+    ipm_memory_close(mem);
+    return EXIT_SUCCESS;
+}
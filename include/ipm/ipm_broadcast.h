@@ -0,0 +1,93 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_BROADCAST_H
+#define IPM_IPM_BROADCAST_H
+#include "ipm_memory.h"
+
+typedef struct ipm_broadcast_T ipm_broadcast;
+
+/**
+ * Formats the shared memory block as a broadcast channel, to which a single writer publishes records that every reader
+ * gets a copy of. The channel keeps its state at the start of the block, so the block must not be used for anything else
+ * and must not be resized, and it is grown if it is too small to hold the channel. The returned handle is the only one
+ * through which records can be published, while readers open the channel with ipm_broadcast_open.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param record_size Largest size of a record. Must be non-zero and at most 2^32.
+ * @param capacity Number of the latest records the channel keeps for the readers. It is rounded up to a power of two.
+ * Must be non-zero and at most 2^32.
+ * @param p_broadcast Pointer which receives the handle of the writer. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_SIZE when the record size or the capacity is too large,
+ * or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_broadcast_create(ipm_memory* memory, size_t record_size, size_t capacity, ipm_broadcast** p_broadcast);
+
+/**
+ * Opens a broadcast channel which was created in the shared memory block with ipm_broadcast_create as a reader. The
+ * reader starts with the first record published after it was opened.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must map the whole block, but
+ * read-only access is enough unless the reader uses ipm_broadcast_wait.
+ * @param p_broadcast Pointer which receives the handle of the reader. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold a broadcast channel,
+ * IPM_RESULT_ERR_BAD_VERSION when the channel was made by an incompatible version of the library, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_broadcast_open(ipm_memory* memory, ipm_broadcast** p_broadcast);
+
+/**
+ * Closes the broadcast channel handle. The memory handle the channel was opened with is not closed.
+ * @param broadcast Handle obtained from ipm_broadcast_create or ipm_broadcast_open.
+ */
+void ipm_broadcast_close(ipm_broadcast* broadcast);
+
+/**
+ * Returns the largest size of a record, as it was given to ipm_broadcast_create.
+ * @param broadcast Handle obtained from ipm_broadcast_create or ipm_broadcast_open.
+ * @return Largest size of a record.
+ */
+size_t ipm_broadcast_record_size(const ipm_broadcast* broadcast);
+
+/**
+ * Publishes a record to every reader. The record replaces the oldest one the channel kept, regardless of whether all
+ * readers have read it, so the writer never waits for the readers.
+ * @param broadcast Handle obtained from ipm_broadcast_create.
+ * @param data Contents of the record.
+ * @param size Size of the record. Must not be larger than the size given to ipm_broadcast_create.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_SIZE when the record is too large, or
+ * IPM_RESULT_ERR_BAD_ACCESS when the handle is not that of the writer.
+ */
+ipm_result ipm_broadcast_publish(ipm_broadcast* broadcast, const void* data, size_t size);
+
+/**
+ * Copies the next record the reader has not read yet, without waiting and without writing to the shared memory. When
+ * the writer has overwritten that record before the reader could read it, the reader is moved on to the oldest record
+ * the channel still has, and the records in between are lost, which can be seen from the sequence numbers of the records
+ * read after that.
+ * @param broadcast Handle obtained from ipm_broadcast_open.
+ * @param buffer Buffer which receives the contents of the record.
+ * @param buffer_size Size of the buffer.
+ * @param p_size Pointer which receives the size of the record. May be null.
+ * @param p_sequence Pointer which receives the sequence number of the record, which counts the records published since
+ * the channel was created, starting at 0. May be null.
+ * @return IPM_RESULT_SUCCESS when the record was read, IPM_RESULT_ERR_EMPTY when there is no new record,
+ * IPM_RESULT_ERR_LAPPED when the record was overwritten, or IPM_RESULT_ERR_BAD_SIZE when the buffer is smaller than the
+ * record, in which case the size of the record is still written to p_size and the reader stays at the record.
+ */
+ipm_result ipm_broadcast_read(
+        ipm_broadcast* broadcast, void* buffer, size_t buffer_size, size_t* p_size, uint64_t* p_sequence);
+
+/**
+ * Sleeps until there is a record the reader has not read yet, or until the timeout runs out. The writer only makes the
+ * system call to wake the readers while one of them is waiting, for which the reader has to announce itself in the
+ * shared memory, so this needs a handle with read-write access.
+ * @param broadcast Handle obtained from ipm_broadcast_open.
+ * @param timeout_ms Longest time to wait in milliseconds.
+ * @return IPM_RESULT_SUCCESS when there is a record to read, IPM_RESULT_ERR_TIMED_OUT when the timeout ran out first,
+ * IPM_RESULT_INTERRUPTED when the wait was interrupted by a signal, or IPM_RESULT_ERR_BAD_ACCESS when the memory handle
+ * only has read-only access.
+ */
+ipm_result ipm_broadcast_wait(ipm_broadcast* broadcast, unsigned timeout_ms);
+
+#endif //IPM_IPM_BROADCAST_H
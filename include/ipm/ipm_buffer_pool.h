@@ -0,0 +1,146 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_BUFFER_POOL_H
+#define IPM_IPM_BUFFER_POOL_H
+#include "ipm_memory.h"
+
+typedef struct ipm_buffer_pool_T ipm_buffer_pool;
+
+enum
+{
+    IPM_BUFFER_POOL_MAX_HANDLES = 64,  //  Number of handles through which a pool can be open at the same time
+};
+
+/**
+ * Formats the shared memory block as a pool of buffers of the same size, which processes take from the pool, fill and
+ * hand off to named consumers, which release them back to the pool once they are done with them. Each buffer is owned by
+ * one pool handle at a time, which is recorded in the block, so the buffers need neither be copied nor claimed while
+ * they are used. The pool keeps its state at the start of the block, so the block must not be used for anything else and
+ * must not be resized, and it is grown if it is too small to hold the pool. Only one process should create the pool,
+ * while the others open it with ipm_buffer_pool_open.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param buffer_size Size of each buffer. Must be non-zero.
+ * @param buffer_count Number of buffers in the pool. Must be non-zero.
+ * @param consumer_names Names of the consumers buffers can be handed off to. Each must be at most IPM_MAX_NAME_LEN
+ * characters long.
+ * @param consumer_count Number of consumers.
+ * @param p_pool Pointer which receives the pool handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NAME_TOO_LONG when a consumer name is too long, or another
+ * value of ipm_result enum for other errors.
+ */
+ipm_result ipm_buffer_pool_create(
+        ipm_memory* memory, size_t buffer_size, unsigned buffer_count, const char* const* consumer_names,
+        unsigned consumer_count, ipm_buffer_pool** p_pool);
+
+/**
+ * Opens a buffer pool which was created in the shared memory block with ipm_buffer_pool_create.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_pool Pointer which receives the pool handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold a buffer pool,
+ * IPM_RESULT_ERR_BAD_VERSION when the pool was made by an incompatible version of the library, IPM_RESULT_ERR_FULL when
+ * the pool is already open through IPM_BUFFER_POOL_MAX_HANDLES handles, or another value of ipm_result enum for other
+ * errors.
+ */
+ipm_result ipm_buffer_pool_open(ipm_memory* memory, ipm_buffer_pool** p_pool);
+
+/**
+ * Closes the buffer pool handle. Buffers held through it are left as they are, but can then be returned to the pool by
+ * ipm_buffer_pool_reclaim. The memory handle the pool was opened with is not closed.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ */
+void ipm_buffer_pool_close(ipm_buffer_pool* pool);
+
+/**
+ * Returns the size of each buffer, as it was given to ipm_buffer_pool_create.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @return Size of each buffer.
+ */
+size_t ipm_buffer_pool_buffer_size(const ipm_buffer_pool* pool);
+
+/**
+ * Finds the consumer with the given name, as it was given to ipm_buffer_pool_create.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param name Name of the consumer.
+ * @param p_consumer Pointer which receives the index of the consumer. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_BAD_VALUE when the pool has no consumer of that name.
+ */
+ipm_result ipm_buffer_pool_find_consumer(const ipm_buffer_pool* pool, const char* name, unsigned* p_consumer);
+
+/**
+ * Returns the address of the buffer in the mapping of the block.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param buffer Index of the buffer.
+ * @return Address of the buffer.
+ */
+void* ipm_buffer_pool_pointer(const ipm_buffer_pool* pool, unsigned buffer);
+
+/**
+ * Takes a free buffer from the pool, which is then held through the pool handle.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param p_buffer Pointer which receives the index of the buffer. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_POOL_EMPTY when every buffer is taken.
+ */
+ipm_result ipm_buffer_pool_acquire(ipm_buffer_pool* pool, unsigned* p_buffer);
+
+/**
+ * Hands the buffer held through the pool handle off to a consumer, which receives it with ipm_buffer_pool_receive. The
+ * buffer must not be used afterwards. Buffers handed off to the same consumer are received in the order they were handed
+ * off in. Should the process die in the middle of a hand-off, the consumer receives no more buffers, since those handed
+ * off after it are queued behind a position which is never filled.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param buffer Index of the buffer.
+ * @param consumer Index of the consumer obtained from ipm_buffer_pool_find_consumer.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_BAD_VALUE when the buffer is not held through the handle
+ * or when the pool has no such consumer.
+ */
+ipm_result ipm_buffer_pool_hand_off(ipm_buffer_pool* pool, unsigned buffer, unsigned consumer);
+
+/**
+ * Receives the oldest buffer handed off to the consumer, which is then held through the pool handle, without waiting.
+ * Buffer is taken before it is removed from the queue, so it is never lost, even if the process dies while receiving it.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param consumer Index of the consumer obtained from ipm_buffer_pool_find_consumer.
+ * @param p_buffer Pointer which receives the index of the buffer. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_EMPTY when no buffer was handed off to the consumer, or
+ * IPM_RESULT_ERR_BAD_VALUE when the pool has no such consumer.
+ */
+ipm_result ipm_buffer_pool_receive(ipm_buffer_pool* pool, unsigned consumer, unsigned* p_buffer);
+
+/**
+ * Receives a buffer like ipm_buffer_pool_receive, but when none was handed off to the consumer, sleeps until one is or
+ * until the timeout runs out.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param consumer Index of the consumer obtained from ipm_buffer_pool_find_consumer.
+ * @param timeout_ms Longest time to wait in milliseconds.
+ * @param p_buffer Pointer which receives the index of the buffer. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_TIMED_OUT when the timeout ran out first, or
+ * IPM_RESULT_INTERRUPTED when the wait was interrupted by a signal, or IPM_RESULT_ERR_BAD_VALUE when the pool has no
+ * such consumer.
+ */
+ipm_result ipm_buffer_pool_receive_wait(
+        ipm_buffer_pool* pool, unsigned consumer, unsigned timeout_ms, unsigned* p_buffer);
+
+/**
+ * Returns the buffer held through the pool handle to the pool.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @param buffer Index of the buffer.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_BAD_VALUE when the buffer is not held through the handle.
+ */
+ipm_result ipm_buffer_pool_release(ipm_buffer_pool* pool, unsigned buffer);
+
+/**
+ * Returns the buffers held through pool handles which were closed to the pool, so that processes which crashed do not
+ * leak them. Buffers handed off to a consumer stay with it, so that they are received once the consumer is restarted.
+ * Each open handle keeps a lock on the shared memory object, which the system drops when the process ends in any way,
+ * so holders are told apart from the dead no matter the PID namespace they are in or whether their process ID was
+ * reused.
+ * @param pool Pool handle obtained from ipm_buffer_pool_create or ipm_buffer_pool_open.
+ * @return Number of reclaimed buffers.
+ */
+unsigned ipm_buffer_pool_reclaim(ipm_buffer_pool* pool);
+
+#endif //IPM_IPM_BUFFER_POOL_H
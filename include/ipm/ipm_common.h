@@ -12,9 +12,15 @@ typedef uint64_t ipm_id;
 enum
 {
     IPM_MAX_NAME_LEN = 256,
+    IPM_MAX_DIRECTORY_LEN = 1024,
     IPM_MEMORY_PAGE_SIZE = 4096,
     IPM_MEMORY_PAGE_SIZE_MASK = (4096 - 1),
     IPM_DEFAULT_CLAIM_CAPACITY = 64,
+    IPM_SEGMENT_BLOCK_CLAIM_CAPACITY = 16,
+    IPM_DEFAULT_OPEN_TIMEOUT_MS = 5000,
+    IPM_SEALED_CLAIM_ID = 0,
+    IPM_MEMORY_WINDOW_GRANULARITY = (1 << 21),
+    IPM_MEMORY_MAX_PROTECTED_RANGES = 16,
 };
 
 enum ipm_access_mode_T
@@ -24,6 +30,39 @@ enum ipm_access_mode_T
 };
 typedef enum ipm_access_mode_T ipm_access_mode;
 
+enum ipm_numa_policy_T
+{
+    IPM_NUMA_POLICY_DEFAULT = 0,    //  Pages are placed on the node of the thread which first touches them
+    IPM_NUMA_POLICY_BIND = 1,       //  Pages are only allocated on the nodes in the node mask
+    IPM_NUMA_POLICY_INTERLEAVE = 2, //  Pages are allocated round-robin on the nodes in the node mask
+    IPM_NUMA_POLICY_PREFERRED = 3,  //  Pages are allocated on the first node in the mask if possible, elsewhere if not
+};
+typedef enum ipm_numa_policy_T ipm_numa_policy;
+
+enum ipm_memory_hint_T
+{
+    IPM_MEMORY_HINT_NORMAL = 0,     //  Region has no particular access pattern
+    IPM_MEMORY_HINT_SEQUENTIAL = 1, //  Region will be accessed sequentially, so it can be read ahead aggressively
+    IPM_MEMORY_HINT_RANDOM = 2,     //  Region will be accessed randomly, so reading ahead is pointless
+    IPM_MEMORY_HINT_WILL_NEED = 3,  //  Region will be accessed soon, so its pages should be brought in
+    IPM_MEMORY_HINT_DONT_NEED = 4,  //  Region will not be accessed soon, so its pages can be unmapped from the process
+    IPM_MEMORY_HINT_COLD = 5,       //  Region will not be accessed soon, so its pages are the first to be reclaimed
+    IPM_MEMORY_HINT_PAGE_OUT = 6,   //  Region will not be accessed soon, so its pages should be reclaimed right away
+
+    IPM_MEMORY_HINT_SHARED = 0x100, //  Flag which records an access pattern hint, so that all openers of the block apply it
+};
+typedef enum ipm_memory_hint_T ipm_memory_hint;
+
+enum ipm_memory_event_T
+{
+    IPM_MEMORY_EVENT_RELEASED = 1 << 0, //  Claim on a region overlapping the watched range was released
+    IPM_MEMORY_EVENT_RESIZED = 1 << 1,  //  Block was resized, so ipm_memory_sync should be called
+    IPM_MEMORY_EVENT_DOORBELL = 1 << 2, //  Doorbell of the block was rung with ipm_memory_ring_doorbell
+
+    IPM_MEMORY_EVENT_ALL = IPM_MEMORY_EVENT_RELEASED | IPM_MEMORY_EVENT_RESIZED | IPM_MEMORY_EVENT_DOORBELL,
+};
+typedef enum ipm_memory_event_T ipm_memory_event;
+
 struct ipm_context_T
 {
     /**
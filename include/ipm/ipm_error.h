@@ -42,6 +42,19 @@ enum ipm_result_T
     IPM_RESULT_ERR_BAD_ACCESS,
     IPM_RESULT_ERR_DOES_NOT_EXIST,
 
+    IPM_RESULT_ERR_NOT_SUPPORTED,
+    IPM_RESULT_ERR_REGION_CLAIMED,
+    IPM_RESULT_ERR_SEGMENT_FULL,
+    IPM_RESULT_ERR_BAD_VERSION,
+    IPM_RESULT_ERR_TIMED_OUT,
+    IPM_RESULT_ERR_SEALED,
+    IPM_RESULT_ERR_NO_FREE_WINDOW,
+    IPM_RESULT_ERR_ADDRESS_IN_USE,
+    IPM_RESULT_ERR_POOL_EMPTY,
+    IPM_RESULT_ERR_FULL,
+    IPM_RESULT_ERR_EMPTY,
+    IPM_RESULT_ERR_LAPPED,
+
     IPM_RESULT_COUNT,
 };
 
@@ -9,6 +9,8 @@
 
 typedef struct ipm_memory_T ipm_memory;
 
+typedef struct ipm_snapshot_T ipm_snapshot;
+
 typedef struct ipm_memory_info_T ipm_memory_info;
 struct ipm_memory_info_T
 {
@@ -42,11 +44,111 @@ ipm_result ipm_memory_create(const ipm_context* context, size_t block_size, cons
  * @param access Desired access to the memory block mapping. Must be either IPM_ACCESS_MODE_READ_ONLY or
  * IPM_ACCESS_MODE_READ_WRITE.
  * @param p_memory Pointer which receives the created memory block info. Must be non-null.
- * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_ADDRESS_IN_USE when the block was created with
+ * ipm_memory_create_fixed and its address is already in use, or another value of ipm_result enum for other errors.
  */
 ipm_result ipm_memory_open(const ipm_context* context, const char* block_name,
                            ipm_access_mode access, ipm_memory** p_memory);
 
+/**
+ * Creates a new shared memory block the same way ipm_memory_create does, but every process which opens it maps it at
+ * the same address, so pointers into the block are valid in all of them. Since the block can never be moved, address
+ * space for its largest size is reserved up front, and it can not grow past it. Opening the block fails with
+ * IPM_RESULT_ERR_ADDRESS_IN_USE in a process which already has something else mapped at that address.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param address Page-aligned address at which to map the block, or NULL to use the one the system picks for the
+ * creator.
+ * @param block_size Size of the memory block to create.
+ * @param max_size Largest size the block can be grown to. Must not be less than block_size.
+ * @param block_name Identifier of the memory to block to create. Must not contain the '/' character.
+ * @param access Desired access to the memory block mapping. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param p_memory Pointer which receives the memory block handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_ADDRESS_IN_USE when the address is already in use, or
+ * another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_create_fixed(const ipm_context* context, void* address, size_t block_size, size_t max_size,
+                                   const char* block_name, ipm_access_mode access, ipm_memory** p_memory);
+
+/**
+ * Creates a new persistent shared memory block, which should not exist before. Unlike blocks created by
+ * ipm_memory_create, the block is backed by regular files in the specified directory, which are not removed when the
+ * last handle to the block is closed, so the block can be opened again with ipm_memory_open_persistent, even after the
+ * system was restarted. To remove the block, call ipm_memory_remove_persistent.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param directory Path to the directory where the files of the block are to be created. Must be at most
+ * IPM_MAX_DIRECTORY_LEN characters long.
+ * @param block_size Size of the shared memory block. Must be non-zero.
+ * @param block_name Identifier of the memory to block to create. Must not contain the '/' character.
+ * @param access Desired access to the memory block mapping. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param p_memory Pointer which receives the created memory block info. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_EXISTS when a block already exists, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_create_persistent(const ipm_context* context, const char* directory, size_t block_size,
+                                        const char* block_name, ipm_access_mode access, ipm_memory** p_memory);
+
+/**
+ * Opens an existing persistent shared memory block by mapping its files. If no other process has the block open, the
+ * block is recovered: any state left over in its headers by processes which previously had it open is reset, including
+ * the list of active claims. The contents of the memory block are left intact.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param directory Path to the directory where the file of the block was created. Must be at most
+ * IPM_MAX_DIRECTORY_LEN characters long.
+ * @param block_name Identifier of the memory to block to create. Must not contain the '/' character.
+ * @param access Desired access to the memory block mapping. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param p_memory Pointer which receives the created memory block info. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when creation of the block was never completed,
+ * or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_open_persistent(const ipm_context* context, const char* directory, const char* block_name,
+                                      ipm_access_mode access, ipm_memory** p_memory);
+
+/**
+ * Opens an existing shared memory block through a process-wide cache. If the block was already opened through the cache
+ * with the same access, the same handle is returned and its reference count is increased, otherwise the block is opened
+ * with ipm_memory_open and the handle is added to the cache. As all users of a cached handle share it, claims made
+ * through it do not exclude each other, and they are only released once the last reference to it is closed with
+ * ipm_memory_close. The context given by the first caller is the one used by the handle.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param block_name Identifier of the memory to block to open. Must not contain the '/' character.
+ * @param access Desired access to the memory block mapping. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param p_memory Pointer which receives the memory block handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_open_cached(const ipm_context* context, const char* block_name, ipm_access_mode access,
+                                  ipm_memory** p_memory);
+
+/**
+ * Opens an existing shared memory block without mapping its memory. Regions of it are instead mapped in windows with
+ * ipm_memory_map_window or ipm_memory_claim_window, at most max_windows at the same time, with the least recently used
+ * window being unmapped when another one is needed. Such a handle returns NULL from ipm_memory_pointer, must claim
+ * regions with ipm_memory_claim_window, and does not support operations which need the whole block mapped, such as
+ * taking snapshots.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param block_name Identifier of the memory to block to open. Must not contain the '/' character.
+ * @param access Desired access to the memory block mapping. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param max_windows Maximum number of windows mapped at the same time. Must be greater than zero.
+ * @param p_memory Pointer which receives the memory block handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_open_windowed(const ipm_context* context, const char* block_name, ipm_access_mode access,
+                                    unsigned max_windows, ipm_memory** p_memory);
+
+/**
+ * Removes the file of a persistent shared memory block. Processes which have the block open may keep using it.
+ * @param context Callbacks and associated state to use for error reporting.
+ * @param directory Path to the directory where the file of the block was created.
+ * @param block_name Identifier of the memory to block to remove. Must not contain the '/' character.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_DOES_NOT_EXIST if the block did not exist, or another value
+ * of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_remove_persistent(const ipm_context* context, const char* directory, const char* block_name);
+
 /**
  * Closes the shared memory block and performs all cleanup; removes memory claim associated with the memory object,
  * unmaps the shared memory, and destroys the shared memory block if it was the last reference to it.
@@ -91,8 +193,150 @@ ipm_result ipm_memory_sync(ipm_memory* memory);
 ipm_result ipm_memory_resize_grow(ipm_memory* memory, size_t new_size);
 
 /**
- * The function causes causes memory to be remapped to a proper access. Any pointers to the memory associated
- * with the memory handle may be invalidated by a call to this function and should be updated.
+ * Shrinks the shared memory that the handle is associated with and remaps it to the smaller size. The memory past the
+ * new size is returned to the operating system. Other processes which have the block open must call ipm_memory_sync
+ * before accessing the block again, which ipm_memory_needs_sync can be used to check for. Any pointers to the memory
+ * associated with the memory handle may be invalidated by a call to this function and should be updated.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param new_size New desired size of the memory. Must be non-zero.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_VALUE when the value of new_size is greater than the
+ * current size of the memory block, IPM_RESULT_ERR_REGION_CLAIMED when there is an active claim past the new size, or
+ * another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_resize_shrink(ipm_memory* memory, size_t new_size);
+
+/**
+ * Returns the pages of a region of the shared memory block to the operating system, without changing the size of the
+ * block. Discarded pages read as zero afterwards. Only pages which lie entirely within the region are discarded.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access.
+ * @param offset Offset of the region to discard.
+ * @param size Size of the region to discard.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_REGION_CLAIMED when a part of the region is claimed by
+ * another handle, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_discard(ipm_memory* memory, size_t offset, size_t size);
+
+/**
+ * Copies a region of one shared memory block into another without passing the data through the calling process. Pages
+ * which are aligned the same way in both blocks are copied by the kernel between the objects backing the blocks (which
+ * on filesystems supporting it only shares them), while the unaligned head and tail of the region are copied through the
+ * mappings. The caller is responsible for claiming the source region for reading and the destination region for writing.
+ * @param src Shared memory handle of the block to copy from.
+ * @param src_offset Offset of the region in the source block.
+ * @param dst Shared memory handle of the block to copy to. Must have read-write access. May be the same block as src, as
+ * long as the regions do not overlap.
+ * @param dst_offset Offset of the region in the destination block.
+ * @param size Size of the region to copy.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_VALUE when a region is not in its block or when the
+ * regions overlap, IPM_RESULT_ERR_SEALED when the destination block was sealed, IPM_RESULT_ERR_BAD_ACCESS when the
+ * destination region overlaps a range of dst protected with ipm_memory_protect_range, or another value of ipm_result
+ * enum for other errors.
+ */
+ipm_result ipm_memory_transfer(ipm_memory* src, size_t src_offset, ipm_memory* dst, size_t dst_offset, size_t size);
+
+/**
+ * Loads a region of a file into a region of the shared memory block. The kernel copies the data from the file directly
+ * into the object backing the block, so it does not pass through a buffer of the calling process, and it is told to read
+ * the file ahead of the copy. The caller is responsible for claiming the region of the block for writing.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access.
+ * @param fd File descriptor of the file, open for reading.
+ * @param file_offset Offset of the region in the file.
+ * @param offset Offset of the region in the block.
+ * @param size Size of the region to load.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_VALUE when the region is not in the block,
+ * IPM_RESULT_ERR_BAD_SIZE when the file ends before the region, IPM_RESULT_ERR_BAD_ACCESS when the region overlaps a
+ * range protected with ipm_memory_protect_range, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_load_file(ipm_memory* memory, int fd, uint64_t file_offset, size_t offset, size_t size);
+
+/**
+ * Loads a region of a file into a region of the shared memory block the same way as ipm_memory_load_file, but splits it
+ * into up to thread_count chunks of whole pages, which are loaded by separate threads at the same time. This helps when
+ * a single thread can not keep up with the storage the file is on.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access.
+ * @param fd File descriptor of the file, open for reading.
+ * @param file_offset Offset of the region in the file.
+ * @param offset Offset of the region in the block.
+ * @param size Size of the region to load.
+ * @param thread_count Largest number of threads to use, including the calling one.
+ * @return IPM_RESULT_SUCCESS when successful, or the first error from any of the chunks otherwise.
+ */
+ipm_result ipm_memory_load_file_parallel(
+        ipm_memory* memory, int fd, uint64_t file_offset, size_t offset, size_t size, unsigned thread_count);
+
+/**
+ * Writes a region of the shared memory block into a region of a file. Like with ipm_memory_load_file, the kernel copies
+ * the data directly from the object backing the block to the file. The caller is responsible for claiming the region of
+ * the block for reading.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param offset Offset of the region in the block.
+ * @param fd File descriptor of the file, open for writing.
+ * @param file_offset Offset of the region in the file.
+ * @param size Size of the region to write.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_VALUE when the region is not in the block, or another
+ * value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_dump_file(ipm_memory* memory, size_t offset, int fd, uint64_t file_offset, size_t size);
+
+/**
+ * Advises the operating system about how a region of the shared memory block will be used by the calling process. The
+ * region is extended to whole pages. Access pattern hints (IPM_MEMORY_HINT_NORMAL, IPM_MEMORY_HINT_SEQUENTIAL and
+ * IPM_MEMORY_HINT_RANDOM) are kept by the handle and applied again when the block is mapped anew. If they are combined
+ * with IPM_MEMORY_HINT_SHARED, they are also recorded in the block, so that processes which open it later or which
+ * remap it apply them as well. Other hints only act on the pages at the time of the call.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param offset Offset of the region the hint is about.
+ * @param size Size of the region the hint is about.
+ * @param hint One of the IPM_MEMORY_HINT_* values, optionally combined with IPM_MEMORY_HINT_SHARED.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NOT_SUPPORTED when the hint is not supported on the
+ * platform, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_advise(ipm_memory* memory, size_t offset, size_t size, unsigned hint);
+
+/**
+ * Checks whether the block was resized since the memory handle last updated its mapping, in which case ipm_memory_sync
+ * should be called.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @return Non-zero if the mapping of the handle is out of date, zero otherwise.
+ */
+int ipm_memory_needs_sync(const ipm_memory* memory);
+
+/**
+ * Seals the block, after which neither its contents nor its size can change. The handle's mapping becomes read-only,
+ * and other processes which have the block open should call ipm_memory_sync to have theirs made read-only as well,
+ * which ipm_memory_needs_sync can be used to check for. Claims for reading a sealed block are not added to the list of
+ * claims, so they are made without any locking.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create with read-write access.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_REGION_CLAIMED when any region of the block is claimed for
+ * writing, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_seal(ipm_memory* memory);
+
+/**
+ * Checks whether the block was sealed with ipm_memory_seal.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @return Non-zero if the block is sealed, zero otherwise.
+ */
+int ipm_memory_is_sealed(const ipm_memory* memory);
+
+/**
+ * Changes the protection of a region of the handle's mapping, without remapping it, so pointers into the block stay
+ * valid. The region is extended to whole pages. Read-only regions are kept when the block is resized, but are reset
+ * when the access of the whole handle is changed with ipm_memory_change_access. A handle keeps at most
+ * IPM_MEMORY_MAX_PROTECTED_RANGES separate read-only regions, with adjacent ones being merged.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param offset Offset of the region in the block.
+ * @param size Size of the region in bytes.
+ * @param access New access of the region. Must be either IPM_ACCESS_MODE_READ_ONLY of IPM_ACCESS_MODE_READ_WRITE, and
+ * can only be IPM_ACCESS_MODE_READ_WRITE if the handle has read-write access.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_ACCESS when making a region of a read-only handle
+ * writable, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_protect_range(ipm_memory* memory, size_t offset, size_t size, ipm_access_mode access);
+
+/**
+ * The function changes the protection of the handle's mapping to a proper access. The block is not remapped, so
+ * pointers to it stay valid, but protection of regions set with ipm_memory_protect_range is reset.
  * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
  * @param access_mode New desired access mode. Must be either IPM_ACCESS_MODE_READ_ONLY of IPM_ACCESS_MODE_READ_WRITE.
  * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
@@ -115,8 +359,10 @@ unsigned ipm_memory_ref_count(const ipm_memory* memory);
  * @param access Desired access mode. Must be either IPM_ACCESS_MODE_READ_ONLY of IPM_ACCESS_MODE_READ_WRITE.
  * @param offset Offset in the memory region where the claim is to be made.
  * @param count The number of bytes to claim from the offset.
- * @param p_claim_id Pointer that receives the ID associated with the claim. This is used to release the claim.
- * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ * @param p_claim_id Pointer that receives the ID associated with the claim. This is used to release the claim. Read
+ * claims of a sealed block receive IPM_SEALED_CLAIM_ID.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_SEALED when claiming a sealed block for writing, or
+ * another value of ipm_result enum for other errors.
  */
 ipm_result ipm_memory_claim_region(ipm_memory* memory, ipm_access_mode access, size_t offset, size_t count,
                                    ipm_id* p_claim_id);
@@ -131,6 +377,46 @@ ipm_result ipm_memory_claim_region(ipm_memory* memory, ipm_access_mode access, s
  */
 ipm_result ipm_memory_release_region(ipm_memory* memory, ipm_id claim_id);
 
+/**
+ * Maps the region of the block in a window and returns a pointer to it. The pointer is valid until the window is
+ * unmapped to make room for another one, which may happen on any later call to this function or to
+ * ipm_memory_claim_window, unless the window is used by a claim. For handles which map the whole block, this returns the
+ * pointer into that mapping.
+ * @param memory Shared memory handle obtained from ipm_memory_open_windowed or any other way.
+ * @param offset Offset of the region in the block.
+ * @param size Size of the region in bytes.
+ * @param p_ptr Pointer which receives the address of the start of the region.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NO_FREE_WINDOW when all windows are used by claims, or
+ * another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_map_window(ipm_memory* memory, size_t offset, size_t size, void** p_ptr);
+
+/**
+ * Claims the region the same way ipm_memory_claim_region does and maps it in a window, which stays mapped until the
+ * claim is released with ipm_memory_release_window.
+ * @param memory Shared memory handle obtained from ipm_memory_open_windowed or any other way.
+ * @param access Desired access mode. Must be either IPM_ACCESS_MODE_READ_ONLY of IPM_ACCESS_MODE_READ_WRITE.
+ * @param offset Offset in the memory region where the claim is to be made.
+ * @param size The number of bytes to claim from the offset.
+ * @param p_claim_id Pointer that receives the ID associated with the claim.
+ * @param p_ptr Pointer which receives the address of the start of the claimed region.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NO_FREE_WINDOW when all windows are used by claims, or
+ * another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_claim_window(ipm_memory* memory, ipm_access_mode access, size_t offset, size_t size,
+                                   ipm_id* p_claim_id, void** p_ptr);
+
+/**
+ * Releases a claim made with ipm_memory_claim_window, after which its window may be unmapped. Releasing the claim with
+ * ipm_memory_release_region has the same effect.
+ * @param memory Shared memory handle through which the claim was made.
+ * @param claim_id ID of the claim, returned from ipm_memory_claim_window.
+ * @param ptr Pointer to the claimed region, returned from ipm_memory_claim_window.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_INVALID_CLAIM when a claim_id is not valid, or another
+ * value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_release_window(ipm_memory* memory, ipm_id claim_id, const void* ptr);
+
 /**
  * Releases all active claims associated with the shared memory handle.
  * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
@@ -139,7 +425,9 @@ ipm_result ipm_memory_release_region(ipm_memory* memory, ipm_id claim_id);
 ipm_result ipm_memory_release_all(ipm_memory* memory);
 
 /**
- * Releases ALL active claims associated with the shared memory, not just this handle.
+ * Releases ALL active claims associated with the shared memory, not just this handle. Windows of this handle are no
+ * longer kept mapped by its claims, while windowed handles of other processes keep theirs until they call
+ * ipm_memory_release_all.
  * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
  * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
  */
@@ -152,5 +440,160 @@ ipm_result ipm_memory_remove_all_active_claims(ipm_memory* memory);
  */
 void* ipm_memory_pointer(ipm_memory* memory);
 
+/**
+ * Takes a point-in-time snapshot of the shared memory block. Contents of the block are copied into a separate read-only
+ * mapping, while writers keep working: once the snapshot was started, each write claim first preserves the pages it
+ * covers, if they were not yet copied, so writers only pay the cost of copying those pages. Write claims which were
+ * made before the snapshot was started have to be released before the snapshot can complete. The block can not be
+ * resized while a snapshot is being taken.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must not hold any write
+ * claims.
+ * @param p_snapshot Pointer which receives the snapshot. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_DEADLOCK if the handle itself holds a write claim, or
+ * another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_snapshot(ipm_memory* memory, ipm_snapshot** p_snapshot);
+
+/**
+ * Returns the pointer to the read-only contents of the snapshot.
+ * @param snapshot Snapshot obtained from ipm_memory_snapshot.
+ * @return Pointer to the contents of the block at the time the snapshot was taken.
+ */
+const void* ipm_snapshot_pointer(const ipm_snapshot* snapshot);
+
+/**
+ * Returns the size of the snapshot, which is the size of the block at the time the snapshot was taken.
+ * @param snapshot Snapshot obtained from ipm_memory_snapshot.
+ * @return Size of the snapshot in bytes.
+ */
+size_t ipm_snapshot_size(const ipm_snapshot* snapshot);
+
+/**
+ * Releases the snapshot and unmaps its contents.
+ * @param snapshot Snapshot obtained from ipm_memory_snapshot.
+ */
+void ipm_snapshot_release(ipm_snapshot* snapshot);
+
+/**
+ * Writes the modified pages of a region of a persistent shared memory block back to its file and waits for that to
+ * complete. The region is rounded out to page boundaries and written back with a single call. For blocks which are not
+ * persistent, this does nothing.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param offset Offset of the region to flush.
+ * @param size Size of the region to flush.
+ * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_flush(ipm_memory* memory, size_t offset, size_t size);
+
+/**
+ * Sets the NUMA placement policy for the whole shared memory block. The policy is recorded in the shared block header
+ * and kept by the shared memory object itself, so it applies to all processes which have the block mapped. Pages which
+ * were already touched are migrated where possible. When the block grows, the policy is also applied to the new part.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param policy Placement policy to use for pages of the block.
+ * @param node_mask Bit mask of NUMA nodes the policy refers to. Ignored for IPM_NUMA_POLICY_DEFAULT.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NOT_SUPPORTED if the platform does not support NUMA
+ * policies, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_set_numa_policy(ipm_memory* memory, ipm_numa_policy policy, uint64_t node_mask);
+
+/**
+ * Sets the NUMA placement policy for a region of the shared memory block. Like the policy of the whole block, it is
+ * kept by the shared memory object, but it is not recorded in the block header, so it does not carry over to the part of
+ * the block which is added by growing it.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param offset Offset of the region. It is rounded down to the page boundary.
+ * @param size Size of the region. The end of the region is rounded up to the page boundary.
+ * @param policy Placement policy to use for pages of the region.
+ * @param node_mask Bit mask of NUMA nodes the policy refers to. Ignored for IPM_NUMA_POLICY_DEFAULT.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NOT_SUPPORTED if the platform does not support NUMA
+ * policies, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_set_numa_policy_range(
+        ipm_memory* memory, size_t offset, size_t size, ipm_numa_policy policy, uint64_t node_mask);
+
+/**
+ * Reports on which NUMA nodes the pages of a region of the shared memory block currently reside.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param offset Offset of the region. It is rounded down to the page boundary.
+ * @param size Size of the region. The end of the region is rounded up to the page boundary.
+ * @param node_count Number of elements in the p_pages_per_node array.
+ * @param p_pages_per_node Array which receives the number of pages that reside on each node. Pages residing on nodes
+ * with index of node_count or greater are not counted.
+ * @param p_not_resident Pointer which receives the number of pages which are not resident in memory at all. May be
+ * null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_NOT_SUPPORTED if the platform does not support NUMA
+ * queries, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_numa_residency(
+        ipm_memory* memory, size_t offset, size_t size, unsigned node_count, size_t* p_pages_per_node,
+        size_t* p_not_resident);
+
+
+/**
+ * Sleeps until another thread or process calls ipm_memory_notify for the same 32-bit word of the block, unless the word
+ * no longer holds the expected value, in which case it returns right away. Checking the value and going to sleep happen
+ * atomically, so a notification sent after the word was changed is never missed. The wait may also end without a
+ * notification, so the caller should check the word again after it returns. While sleeping, no CPU time is used.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must map the whole block.
+ * @param offset Offset of the word in the block. Must be aligned to 4 bytes.
+ * @param expected Value the word must hold for the caller to sleep.
+ * @param timeout_ms Longest time to wait in milliseconds.
+ * @return IPM_RESULT_SUCCESS when woken or when the word did not hold the expected value, IPM_RESULT_ERR_TIMED_OUT when
+ * the timeout ran out first, IPM_RESULT_INTERRUPTED when the wait was interrupted by a signal, IPM_RESULT_ERR_BAD_VALUE
+ * when the offset is misaligned or not in the block, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_wait(ipm_memory* memory, size_t offset, uint32_t expected, unsigned timeout_ms);
+
+/**
+ * Wakes threads and processes sleeping in ipm_memory_wait on a 32-bit word of the block. The word should be changed
+ * before the call, so that those which did not go to sleep yet do not do so.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must map the whole block.
+ * @param offset Offset of the word in the block. Must be aligned to 4 bytes.
+ * @param count Largest number of sleepers to wake. UINT32_MAX wakes them all.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_VALUE when the offset is misaligned or not in the
+ * block, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_memory_notify(ipm_memory* memory, size_t offset, unsigned count);
+
+
+/**
+ * Makes the handle watch the block for events, which are reported through a file descriptor that becomes readable when
+ * any of them happens, so that it can be polled together with others, for example with poll, epoll or io_uring. Events
+ * which happened since the last call to ipm_memory_take_events are combined, and taking them makes the descriptor no
+ * longer readable. Events caused by this handle itself are also reported. Calling this again for a handle which already
+ * watches the block only changes which events it watches. A block can be watched by at most 32 handles at the same time.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @param events Combination of values of ipm_memory_event enum to watch for. Must be non-zero.
+ * @param offset Offset of the range in which released claims are reported by IPM_MEMORY_EVENT_RELEASED.
+ * @param size Size of the range in which released claims are reported, or 0 to report them in the whole block.
+ * @param p_fd Pointer which receives the file descriptor. It is owned by the handle, so it must not be closed, and
+ * stays valid until ipm_memory_unwatch or ipm_memory_close is called. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_FULL when the block is already watched by as many handles
+ * as it can be, IPM_RESULT_ERR_NOT_SUPPORTED if the platform has no abstract sockets, or another value of ipm_result
+ * enum for other errors.
+ */
+ipm_result ipm_memory_watch(ipm_memory* memory, unsigned events, size_t offset, size_t size, int* p_fd);
+
+/**
+ * Stops the handle from watching the block for events and closes its file descriptor. Does nothing if the handle is not
+ * watching the block.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ */
+void ipm_memory_unwatch(ipm_memory* memory);
+
+/**
+ * Takes the events which happened since the last call, without waiting for any.
+ * @param memory Shared memory handle which watches the block, after a call to ipm_memory_watch.
+ * @return Combination of values of ipm_memory_event enum which happened, or 0 if none did.
+ */
+unsigned ipm_memory_take_events(ipm_memory* memory);
+
+/**
+ * Reports IPM_MEMORY_EVENT_DOORBELL to all handles watching the block for it, in this and in other processes.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create.
+ * @return IPM_RESULT_SUCCESS when successful, or another value of ipm_result enum when the event could not be sent.
+ */
+ipm_result ipm_memory_ring_doorbell(ipm_memory* memory);
 
 #endif //IPM_IPM_MEMORY_H
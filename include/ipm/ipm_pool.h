@@ -0,0 +1,69 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_POOL_H
+#define IPM_IPM_POOL_H
+#include "ipm_memory.h"
+
+typedef struct ipm_pool_T ipm_pool;
+
+/**
+ * Formats the shared memory block as a pool of objects of the same size, which are allocated with ipm_pool_alloc. The
+ * pool keeps its state at the start of the block, so the block must not be used for anything else, and it is grown if
+ * it is too small to hold all the objects. Each process (or thread) using the pool needs its own pool handle, so only
+ * one should create the pool, while the others open it with ipm_pool_open.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param object_size Size of each object. Objects are aligned to 16 bytes. Must be non-zero.
+ * @param object_count Number of objects in the pool. Must be non-zero.
+ * @param p_pool Pointer which receives the pool handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_pool_create(ipm_memory* memory, size_t object_size, size_t object_count, ipm_pool** p_pool);
+
+/**
+ * Opens a pool which was created in the shared memory block with ipm_pool_create.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_pool Pointer which receives the pool handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold a pool,
+ * IPM_RESULT_ERR_BAD_VERSION when the pool was made by an incompatible version of the library, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_pool_open(ipm_memory* memory, ipm_pool** p_pool);
+
+/**
+ * Closes the pool handle, returning the objects it kept for later allocations to the pool. Objects allocated through
+ * the handle stay allocated. The memory handle the pool was opened with is not closed.
+ * @param pool Pool handle obtained from ipm_pool_create or ipm_pool_open.
+ */
+void ipm_pool_close(ipm_pool* pool);
+
+/**
+ * Returns the size of the objects of the pool, as it was given to ipm_pool_create.
+ * @param pool Pool handle obtained from ipm_pool_create or ipm_pool_open.
+ * @return Size of each object.
+ */
+size_t ipm_pool_object_size(const ipm_pool* pool);
+
+/**
+ * Allocates an object of the pool. Objects are first taken from those kept by the handle, and only when there are none
+ * left, a batch of them is taken from the lock-free list shared by all processes. The handle must not be used by
+ * several threads at once.
+ * @param pool Pool handle obtained from ipm_pool_create or ipm_pool_open.
+ * @param p_offset Pointer which receives the offset of the object from the start of the block. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_POOL_EMPTY when every object is allocated or kept by
+ * other handles.
+ */
+ipm_result ipm_pool_alloc(ipm_pool* pool, size_t* p_offset);
+
+/**
+ * Frees an object of the pool. The object may have been allocated by any process, through any pool handle.
+ * @param pool Pool handle obtained from ipm_pool_create or ipm_pool_open.
+ * @param offset Offset of the object obtained from ipm_pool_alloc.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_BAD_VALUE when the offset is not that of an object.
+ */
+ipm_result ipm_pool_free(ipm_pool* pool, size_t offset);
+
+#endif //IPM_IPM_POOL_H
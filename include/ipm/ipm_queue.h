@@ -0,0 +1,99 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_QUEUE_H
+#define IPM_IPM_QUEUE_H
+#include "ipm_memory.h"
+
+typedef struct ipm_queue_T ipm_queue;
+
+/**
+ * Formats the shared memory block as a bounded queue of elements of the same size, which any number of processes can
+ * push to and pop from. The queue keeps its state at the start of the block, so the block must not be used for anything
+ * else and must not be resized, and it is grown if it is too small to hold the queue. Only one process should create the
+ * queue, while the others open it with ipm_queue_open.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param element_size Size of each element. Must be non-zero and at most 2^32.
+ * @param capacity Number of elements the queue can hold. It is rounded up to a power of two. Must be non-zero and at
+ * most 2^32.
+ * @param p_queue Pointer which receives the queue handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_SIZE when the element size or the capacity is too
+ * large, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_queue_create(ipm_memory* memory, size_t element_size, size_t capacity, ipm_queue** p_queue);
+
+/**
+ * Opens a queue which was created in the shared memory block with ipm_queue_create.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_queue Pointer which receives the queue handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold a queue,
+ * IPM_RESULT_ERR_BAD_VERSION when the queue was made by an incompatible version of the library, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_queue_open(ipm_memory* memory, ipm_queue** p_queue);
+
+/**
+ * Closes the queue handle. The memory handle the queue was opened with is not closed.
+ * @param queue Queue handle obtained from ipm_queue_create or ipm_queue_open.
+ */
+void ipm_queue_close(ipm_queue* queue);
+
+/**
+ * Returns the size of the elements of the queue, as it was given to ipm_queue_create.
+ * @param queue Queue handle obtained from ipm_queue_create or ipm_queue_open.
+ * @return Size of each element.
+ */
+size_t ipm_queue_element_size(const ipm_queue* queue);
+
+/**
+ * Pushes as many of the elements to the queue as there is space for, without waiting. Elements pushed together are
+ * reserved with a single atomic operation, and consumers sleeping in ipm_queue_pop_wait are woken once for all of them.
+ * @param queue Queue handle obtained from ipm_queue_create or ipm_queue_open.
+ * @param elements Array of elements to push, in order.
+ * @param count Number of elements in the array. Must be non-zero.
+ * @param p_pushed Pointer which receives the number of the first elements which were pushed. May be null.
+ * @return IPM_RESULT_SUCCESS when at least one element was pushed, or IPM_RESULT_ERR_FULL when the queue was full.
+ */
+ipm_result ipm_queue_push(ipm_queue* queue, const void* elements, unsigned count, unsigned* p_pushed);
+
+/**
+ * Pops as many elements from the queue as are there, up to the given count, without waiting.
+ * @param queue Queue handle obtained from ipm_queue_create or ipm_queue_open.
+ * @param elements Array which receives the popped elements, in order.
+ * @param count Largest number of elements to pop. Must be non-zero.
+ * @param p_popped Pointer which receives the number of popped elements. May be null.
+ * @return IPM_RESULT_SUCCESS when at least one element was popped, or IPM_RESULT_ERR_EMPTY when the queue was empty.
+ */
+ipm_result ipm_queue_pop(ipm_queue* queue, void* elements, unsigned count, unsigned* p_popped);
+
+/**
+ * Pushes elements to the queue like ipm_queue_push, but when the queue is full, sleeps until at least one element can be
+ * pushed or until the timeout runs out.
+ * @param queue Queue handle obtained from ipm_queue_create or ipm_queue_open.
+ * @param elements Array of elements to push, in order.
+ * @param count Number of elements in the array. Must be non-zero.
+ * @param timeout_ms Longest time to wait in milliseconds.
+ * @param p_pushed Pointer which receives the number of the first elements which were pushed. May be null.
+ * @return IPM_RESULT_SUCCESS when at least one element was pushed, IPM_RESULT_ERR_TIMED_OUT when the timeout ran out
+ * first, or IPM_RESULT_INTERRUPTED when the wait was interrupted by a signal.
+ */
+ipm_result ipm_queue_push_wait(
+        ipm_queue* queue, const void* elements, unsigned count, unsigned timeout_ms, unsigned* p_pushed);
+
+/**
+ * Pops elements from the queue like ipm_queue_pop, but when the queue is empty, sleeps until at least one element can be
+ * popped or until the timeout runs out.
+ * @param queue Queue handle obtained from ipm_queue_create or ipm_queue_open.
+ * @param elements Array which receives the popped elements, in order.
+ * @param count Largest number of elements to pop. Must be non-zero.
+ * @param timeout_ms Longest time to wait in milliseconds.
+ * @param p_popped Pointer which receives the number of popped elements. May be null.
+ * @return IPM_RESULT_SUCCESS when at least one element was popped, IPM_RESULT_ERR_TIMED_OUT when the timeout ran out
+ * first, or IPM_RESULT_INTERRUPTED when the wait was interrupted by a signal.
+ */
+ipm_result ipm_queue_pop_wait(ipm_queue* queue, void* elements, unsigned count, unsigned timeout_ms, unsigned* p_popped);
+
+#endif //IPM_IPM_QUEUE_H
@@ -0,0 +1,108 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_RING_H
+#define IPM_IPM_RING_H
+#include "ipm_memory.h"
+
+typedef struct ipm_ring_T ipm_ring;
+
+/**
+ * Formats the shared memory block as a ring buffer of variable-sized records, which one process writes and one process
+ * reads. The ring keeps its state at the start of the block, so the block must not be used for anything else and must
+ * not be resized, and it is grown if it is too small to hold the ring. Only one process should create the ring, while
+ * the other one opens it with ipm_ring_open.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param capacity Number of bytes the ring can hold. It is rounded up to a power of two, which is a multiple of the page
+ * size. Each record takes up 8 bytes more than its size, rounded up to a multiple of 8.
+ * @param p_ring Pointer which receives the ring handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_ring_create(ipm_memory* memory, size_t capacity, ipm_ring** p_ring);
+
+/**
+ * Opens a ring which was created in the shared memory block with ipm_ring_create.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_ring Pointer which receives the ring handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold a ring,
+ * IPM_RESULT_ERR_BAD_VERSION when the ring was made by an incompatible version of the library, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_ring_open(ipm_memory* memory, ipm_ring** p_ring);
+
+/**
+ * Closes the ring handle. The memory handle the ring was opened with is not closed.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ */
+void ipm_ring_close(ipm_ring* ring);
+
+/**
+ * Reserves space for a record at the end of the ring, which can then be written in place. The record is only visible to
+ * the reader once it is committed with ipm_ring_commit. The space is contiguous even when it wraps around the end of
+ * the ring, since the ring is mapped twice in a row. Only the writer may call this.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ * @param size Size of the record. Must be non-zero.
+ * @param p_ptr Pointer which receives the address at which to write the record. It is aligned to 8 bytes. Must be
+ * non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_FULL when there is not enough free space in the ring at the
+ * moment, or IPM_RESULT_ERR_BAD_SIZE when the record could never fit.
+ */
+ipm_result ipm_ring_reserve(ipm_ring* ring, size_t size, void** p_ptr);
+
+/**
+ * Publishes the record written to the space reserved by ipm_ring_reserve, waking the reader if it waits for one.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ * @param size Final size of the record, which must not be more than the reserved size.
+ */
+void ipm_ring_commit(ipm_ring* ring, size_t size);
+
+/**
+ * Copies a record to the end of the ring, like ipm_ring_reserve followed by ipm_ring_commit.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ * @param data Contents of the record.
+ * @param size Size of the record. Must be non-zero.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_FULL when there is not enough free space in the ring at the
+ * moment, or IPM_RESULT_ERR_BAD_SIZE when the record could never fit.
+ */
+ipm_result ipm_ring_write(ipm_ring* ring, const void* data, size_t size);
+
+/**
+ * Gives the first record of the ring without taking it out, so that it can be read in place. Only the reader may call
+ * this.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ * @param p_ptr Pointer which receives the address of the record. Must be non-null.
+ * @param p_size Pointer which receives the size of the record. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_EMPTY when the ring holds no records.
+ */
+ipm_result ipm_ring_peek(ipm_ring* ring, const void** p_ptr, size_t* p_size);
+
+/**
+ * Takes the record given by the last call to ipm_ring_peek out of the ring, freeing its space for the writer.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ */
+void ipm_ring_consume(ipm_ring* ring);
+
+/**
+ * Copies the first record of the ring into a buffer and takes it out, like ipm_ring_peek followed by ipm_ring_consume.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ * @param buffer Buffer which receives the contents of the record.
+ * @param buffer_size Size of the buffer.
+ * @param p_size Pointer which receives the size of the record. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_EMPTY when the ring holds no records, or
+ * IPM_RESULT_ERR_BAD_SIZE when the record does not fit into the buffer, in which case it stays in the ring.
+ */
+ipm_result ipm_ring_read(ipm_ring* ring, void* buffer, size_t buffer_size, size_t* p_size);
+
+/**
+ * Sleeps until the ring holds a record or until the timeout runs out. Only the reader may call this.
+ * @param ring Ring handle obtained from ipm_ring_create or ipm_ring_open.
+ * @param timeout_ms Longest time to wait in milliseconds.
+ * @return IPM_RESULT_SUCCESS when the ring holds a record, IPM_RESULT_ERR_TIMED_OUT when the timeout ran out first, or
+ * IPM_RESULT_INTERRUPTED when the wait was interrupted by a signal.
+ */
+ipm_result ipm_ring_wait(ipm_ring* ring, unsigned timeout_ms);
+
+#endif //IPM_IPM_RING_H
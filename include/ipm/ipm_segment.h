@@ -0,0 +1,136 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_SEGMENT_H
+#define IPM_IPM_SEGMENT_H
+#include "ipm_common.h"
+#include "ipm_error.h"
+
+typedef struct ipm_segment_T ipm_segment;
+
+typedef struct ipm_segment_block_T ipm_segment_block;
+
+/**
+ * Creates a new shared memory segment, which should not exist before. A segment is a single shared memory object of
+ * fixed size, which holds many named logical blocks, each with its own region of the segment and its own list of
+ * claims. Creating and opening logical blocks is done within the already mapped segment, without any system calls.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param segment_size Total size of all logical blocks in the segment, including their claim lists. Must be non-zero.
+ * @param max_blocks Maximum number of logical blocks the segment can hold at the same time. Must be non-zero.
+ * @param segment_name Identifier of the segment to create. Must not contain the '/' character.
+ * @param p_segment Pointer which receives the created segment. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_EXISTS when a segment already exists, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_create(const ipm_context* context, size_t segment_size, unsigned max_blocks,
+                              const char* segment_name, ipm_segment** p_segment);
+
+/**
+ * Opens an existing shared memory segment.
+ * @param context Callbacks and associated state to use for memory allocation and error reporting.
+ * @param segment_name Identifier of the segment to open. Must not contain the '/' character.
+ * @param p_segment Pointer which receives the opened segment. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_open(const ipm_context* context, const char* segment_name, ipm_segment** p_segment);
+
+/**
+ * Closes the shared memory segment and destroys it if it was the last reference to it. All logical blocks opened
+ * through the segment handle must be closed before.
+ * @param segment Segment handle obtained from ipm_segment_open or ipm_segment_create.
+ */
+void ipm_segment_close(ipm_segment* segment);
+
+/**
+ * Closes the shared memory segment and performs minimal cleanup, like ipm_memory_clean does for memory blocks. Logical
+ * blocks opened through the segment handle should be cleaned with ipm_segment_block_clean before.
+ * @param segment Segment handle obtained from ipm_segment_open or ipm_segment_create.
+ */
+void ipm_segment_clean(ipm_segment* segment);
+
+/**
+ * Creates a new logical block within the segment, which should not exist before. Contents of the block are zeroed.
+ * @param segment Segment handle obtained from ipm_segment_open or ipm_segment_create.
+ * @param block_name Identifier of the logical block. Must be at most IPM_MAX_NAME_LEN characters long.
+ * @param block_size Size of the logical block. Must be non-zero.
+ * @param access Access used for claims of the block. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param p_block Pointer which receives the block handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_EXISTS when a block already exists,
+ * IPM_RESULT_ERR_SEGMENT_FULL when the segment has no space or entries left for the block, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_block_create(ipm_segment* segment, const char* block_name, size_t block_size,
+                                    ipm_access_mode access, ipm_segment_block** p_block);
+
+/**
+ * Opens an existing logical block within the segment.
+ * @param segment Segment handle obtained from ipm_segment_open or ipm_segment_create.
+ * @param block_name Identifier of the logical block. Must be at most IPM_MAX_NAME_LEN characters long.
+ * @param access Access used for claims of the block. Must be either IPM_ACCESS_MODE_READ_ONLY or
+ * IPM_ACCESS_MODE_READ_WRITE.
+ * @param p_block Pointer which receives the block handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_DOES_NOT_EXIST when there is no such block, or another
+ * value of ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_block_open(ipm_segment* segment, const char* block_name, ipm_access_mode access,
+                                  ipm_segment_block** p_block);
+
+/**
+ * Closes the logical block, releasing all of its claims, and frees its region of the segment if it was the last
+ * reference to it.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ */
+void ipm_segment_block_close(ipm_segment_block* block);
+
+/**
+ * Frees the logical block handle without releasing its claims or its reference to the block. Its purpose is the same
+ * as that of ipm_memory_clean.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ */
+void ipm_segment_block_clean(ipm_segment_block* block);
+
+/**
+ * Returns the pointer to the memory of the logical block.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ * @return Pointer to the memory of the logical block.
+ */
+void* ipm_segment_block_pointer(ipm_segment_block* block);
+
+/**
+ * Returns the size of the logical block.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ * @return Size of the logical block in bytes.
+ */
+size_t ipm_segment_block_size(const ipm_segment_block* block);
+
+/**
+ * Claims a region of the logical block, the same way ipm_memory_claim_region does for memory blocks.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ * @param access Desired access mode. Must be either IPM_ACCESS_MODE_READ_ONLY of IPM_ACCESS_MODE_READ_WRITE.
+ * @param offset Offset in the logical block where the claim is to be made.
+ * @param count The number of bytes to claim from the offset.
+ * @param p_claim_id Pointer that receives the ID associated with the claim. This is used to release the claim.
+ * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_block_claim_region(ipm_segment_block* block, ipm_access_mode access, size_t offset,
+                                          size_t count, ipm_id* p_claim_id);
+
+/**
+ * Releases a claim on a region of the logical block associated with the given claim_id.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ * @param claim_id ID of the claim, returned from a previous call to ipm_segment_block_claim_region.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_INVALID_CLAIM when a claim_id is not valid,
+ * or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_block_release_region(ipm_segment_block* block, ipm_id claim_id);
+
+/**
+ * Releases all active claims associated with the logical block handle.
+ * @param block Logical block handle obtained from ipm_segment_block_create or ipm_segment_block_open.
+ * @return IPM_RESULT_SUCCESS when successful or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_segment_block_release_all(ipm_segment_block* block);
+
+#endif //IPM_IPM_SEGMENT_H
@@ -0,0 +1,68 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_SHM_HEAP_H
+#define IPM_IPM_SHM_HEAP_H
+#include "ipm_memory.h"
+
+typedef struct ipm_shm_heap_T ipm_shm_heap;
+
+enum
+{
+    IPM_SHM_HEAP_MAX_SMALL_SIZE = (1 << 20),    //  Largest allocation served from a size class, larger ones use whole pages
+};
+
+/**
+ * Formats the shared memory block as a heap, from which regions of the block can be allocated with ipm_shm_alloc. The
+ * heap keeps its state at the start of the block, so the block must not be used for anything else. Contents of the block
+ * are overwritten. Each process (or thread) using the heap needs its own heap handle, so only one should create the heap,
+ * while the others open it with ipm_shm_heap_open.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_heap Pointer which receives the heap handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_shm_heap_create(ipm_memory* memory, ipm_shm_heap** p_heap);
+
+/**
+ * Opens a heap which was created in the shared memory block with ipm_shm_heap_create.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_heap Pointer which receives the heap handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold a heap,
+ * IPM_RESULT_ERR_BAD_VERSION when the heap was made by an incompatible version of the library, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_shm_heap_open(ipm_memory* memory, ipm_shm_heap** p_heap);
+
+/**
+ * Closes the heap handle, returning the regions it kept for later allocations to the heap. Regions allocated through
+ * the handle stay allocated. The memory handle the heap was opened with is not closed.
+ * @param heap Heap handle obtained from ipm_shm_heap_create or ipm_shm_heap_open.
+ */
+void ipm_shm_heap_close(ipm_shm_heap* heap);
+
+/**
+ * Allocates a region of the heap. Regions of up to IPM_SHM_HEAP_MAX_SMALL_SIZE bytes are taken from free lists of their
+ * size class, first from those kept by the handle, and only then from those shared by all processes, which are
+ * lock-free. When the heap runs out of space, the block is grown with ipm_memory_resize_grow, so the pointer from
+ * ipm_memory_pointer has to be obtained again after the call. The handle must not be used by several threads at once.
+ * @param heap Heap handle obtained from ipm_shm_heap_create or ipm_shm_heap_open.
+ * @param size Size of the region to allocate. Must be non-zero.
+ * @param p_offset Pointer which receives the offset of the region from the start of the block. The region is aligned to
+ * 16 bytes. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or another value of ipm_result enum when the block could not be grown.
+ */
+ipm_result ipm_shm_alloc(ipm_shm_heap* heap, size_t size, size_t* p_offset);
+
+/**
+ * Frees a region allocated from the heap. The region may have been allocated by any process, through any heap handle.
+ * @param heap Heap handle obtained from ipm_shm_heap_create or ipm_shm_heap_open.
+ * @param offset Offset of the region obtained from ipm_shm_alloc.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_VALUE when the offset is not that of an allocated
+ * region (for example because it was already freed), or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_shm_free(ipm_shm_heap* heap, size_t offset);
+
+#endif //IPM_IPM_SHM_HEAP_H
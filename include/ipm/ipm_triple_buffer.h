@@ -0,0 +1,89 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_IPM_TRIPLE_BUFFER_H
+#define IPM_IPM_TRIPLE_BUFFER_H
+#include "ipm_memory.h"
+
+typedef struct ipm_triple_buffer_T ipm_triple_buffer;
+
+/**
+ * Formats the shared memory block as a set of buffers through which a writer publishes its latest state to readers that
+ * only ever want the most recent one. The writer always writes into a buffer no reader is reading, and readers always get
+ * the last buffer that was published, so neither ever waits for the other. Besides the published buffer and the one
+ * being written, there is one buffer for each reader which may read at the same time, so with a single reader this is a
+ * triple buffer. The state is kept at the start of the block, so the block must not be used for anything else and must
+ * not be resized, and it is grown if it is too small. Only one process should create the buffers, while the others open
+ * them with ipm_triple_buffer_open. Until the first buffer is published, readers get one filled with zeros.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param size Size of each buffer. Must be non-zero.
+ * @param reader_count Largest number of readers which read at the same time. Must be non-zero. Readers whose process
+ * ended while reading are counted as well, since they keep their buffer until the buffers are created again.
+ * @param p_buffer Pointer which receives the handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or another value of ipm_result enum for other errors.
+ */
+ipm_result ipm_triple_buffer_create(ipm_memory* memory, size_t size, unsigned reader_count, ipm_triple_buffer** p_buffer);
+
+/**
+ * Opens the buffers which were created in the shared memory block with ipm_triple_buffer_create.
+ * @param memory Shared memory handle obtained from ipm_memory_open of ipm_memory_create. Must have read-write access and
+ * must map the whole block.
+ * @param p_buffer Pointer which receives the handle. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, IPM_RESULT_ERR_BAD_INIT when the block does not hold the buffers,
+ * IPM_RESULT_ERR_BAD_VERSION when they were made by an incompatible version of the library, or another value of
+ * ipm_result enum for other errors.
+ */
+ipm_result ipm_triple_buffer_open(ipm_memory* memory, ipm_triple_buffer** p_buffer);
+
+/**
+ * Closes the handle, ending any read or write that was begun through it without publishing. The memory handle the
+ * buffers were opened with is not closed.
+ * @param buffer Handle obtained from ipm_triple_buffer_create or ipm_triple_buffer_open.
+ */
+void ipm_triple_buffer_close(ipm_triple_buffer* buffer);
+
+/**
+ * Returns the size of each buffer, as it was given to ipm_triple_buffer_create.
+ * @param buffer Handle obtained from ipm_triple_buffer_create or ipm_triple_buffer_open.
+ * @return Size of each buffer.
+ */
+size_t ipm_triple_buffer_size(const ipm_triple_buffer* buffer);
+
+/**
+ * Begins writing the next state into a buffer which is neither published nor read by anyone. The buffer does not hold
+ * any particular state, so the whole state has to be written to it. Only one process may write at a time.
+ * @param buffer Handle obtained from ipm_triple_buffer_create or ipm_triple_buffer_open.
+ * @param p_data Pointer which receives the address of the buffer to write to. Must be non-null.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_REGION_CLAIMED when every other buffer is being read,
+ * which only happens when more readers read at the same time than were given to ipm_triple_buffer_create.
+ */
+ipm_result ipm_triple_buffer_write_begin(ipm_triple_buffer* buffer, void** p_data);
+
+/**
+ * Publishes the buffer written since the call to ipm_triple_buffer_write_begin, so that readers which begin reading
+ * after this get it.
+ * @param buffer Handle obtained from ipm_triple_buffer_create or ipm_triple_buffer_open.
+ * @return Version of the published state, which counts the states published since the buffers were created.
+ */
+uint64_t ipm_triple_buffer_publish(ipm_triple_buffer* buffer);
+
+/**
+ * Begins reading the latest published state. The buffer stays unchanged until ipm_triple_buffer_read_end is called,
+ * even when newer states are published meanwhile. A handle can only read one buffer at a time. Readers of a buffer are
+ * only counted, not recorded, so when the process ends before calling ipm_triple_buffer_read_end, the buffer stays
+ * taken and the writer can not use it again. Each time that happens, one less reader can read at the same time.
+ * @param buffer Handle obtained from ipm_triple_buffer_create or ipm_triple_buffer_open.
+ * @param p_data Pointer which receives the address of the buffer to read from. Must be non-null.
+ * @return Version of the state being read, which is 0 when none was published yet.
+ */
+uint64_t ipm_triple_buffer_read_begin(ipm_triple_buffer* buffer, const void** p_data);
+
+/**
+ * Ends reading the buffer obtained from ipm_triple_buffer_read_begin, after which the writer may reuse it.
+ * @param buffer Handle obtained from ipm_triple_buffer_create or ipm_triple_buffer_open.
+ */
+void ipm_triple_buffer_read_end(ipm_triple_buffer* buffer);
+
+#endif //IPM_IPM_TRIPLE_BUFFER_H
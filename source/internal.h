@@ -27,6 +27,8 @@ IPM_INTERNAL_FUNCTION void* ipm_alloc_real(const ipm_context* context, size_t si
 
 IPM_INTERNAL_FUNCTION void ipm_free(const ipm_context* context, void* ptr);
 
+IPM_INTERNAL_FUNCTION uint64_t ipm_hash_name(const char* name);
+
 #define ipm_alloc(callbacks, size) ipm_alloc_real((callbacks), (size), __FILE__, __LINE__, __func__)
 
 #ifdef __GNUC__
@@ -0,0 +1,256 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_broadcast_internal.h"
+#include "ipm_structure.h"
+
+static inline ipm_broadcast_slot* broadcast_slot(const ipm_broadcast* broadcast, uint64_t number)
+{
+    return (ipm_broadcast_slot*)(broadcast->slots + (number & broadcast->mask) * broadcast->stride);
+}
+
+static inline uint32_t* published_futex_word(ipm_broadcast_header* header)
+{
+    //  Lower half of the count changes with every record, which is enough for the readers to notice one was published
+    return (uint32_t*)&header->published + (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__);
+}
+
+static ipm_result broadcast_handle_create(ipm_memory* memory, ipm_bool writer, ipm_broadcast** p_broadcast)
+{
+    ipm_broadcast_header* const header = memory->real_memory.memory;
+    ipm_broadcast* const broadcast = internal_ipm_structure_alloc_handle(memory, "a broadcast channel", sizeof(*broadcast));
+    if (!broadcast)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    broadcast->memory = memory;
+    broadcast->header = header;
+    broadcast->slots = (uint8_t*)header + header->slots_offset;
+    broadcast->mask = header->capacity - 1;
+    broadcast->stride = header->stride;
+    broadcast->record_size = header->record_size;
+    broadcast->writer = writer;
+    broadcast->cursor = atomic_load_explicit(&header->published, memory_order_acquire);
+    *p_broadcast = broadcast;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_broadcast_create(ipm_memory* memory, size_t record_size, size_t capacity, ipm_broadcast** p_broadcast)
+{
+    assert(record_size > 0);
+    assert(capacity > 0);
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "a broadcast channel");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (memory->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&memory->ctx, "Broadcast channel can only be created through a handle with read-write access");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (capacity > ((size_t)1 << 32) || record_size > ((size_t)1 << 32))
+    {
+        IPM_ERROR(&memory->ctx, "Broadcast channel can hold at most %zu records of at most %zu bytes, but %zu of %zu bytes were requested", (size_t)1 << 32, (size_t)1 << 32, capacity, record_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    size_t real_capacity = 1;
+    while (real_capacity < capacity)
+    {
+        real_capacity <<= 1;
+    }
+    const uint64_t stride = align_line(IPM_BROADCAST_RECORD_OFFSET + record_size);
+    const uint64_t slots_offset = align_line(sizeof(ipm_broadcast_header));
+    if (stride > (SIZE_MAX - IPM_MEMORY_PAGE_SIZE - slots_offset) / real_capacity)
+    {
+        IPM_ERROR(&memory->ctx, "Broadcast channel of %zu records of %zu bytes does not fit into memory", capacity, record_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    const size_t needed_size = round_size(slots_offset + real_capacity * stride);
+    if (memory->real_memory.size < needed_size)
+    {
+        res = ipm_memory_resize_grow(memory, needed_size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the broadcast channel, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_broadcast_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    header->layout_version = IPM_BROADCAST_LAYOUT_VERSION;
+    header->capacity = real_capacity;
+    header->record_size = record_size;
+    header->stride = stride;
+    header->slots_offset = slots_offset;
+    atomic_init(&header->published, 0);
+    atomic_init(&header->waiters, 0);
+    for (uint64_t i = 0; i < real_capacity; ++i)
+    {
+        //  No slot holds a record yet, which sequence 0 tells apart from any published one
+        ipm_broadcast_slot* const slot = (ipm_broadcast_slot*)((uint8_t*)header + slots_offset + i * stride);
+        atomic_init(&slot->sequence, 0);
+        slot->size = 0;
+    }
+    //  Magic is written last, so that the channel is not opened before it is ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_BROADCAST_MAGIC, memory_order_release);
+
+    res = broadcast_handle_create(memory, 1, p_broadcast);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+    }
+    return res;
+}
+
+ipm_result ipm_broadcast_open(ipm_memory* memory, ipm_broadcast** p_broadcast)
+{
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "a broadcast channel");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a broadcast channel", IPM_BROADCAST_MAGIC, IPM_BROADCAST_LAYOUT_VERSION, sizeof(ipm_broadcast_header));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const ipm_broadcast_header* const header = memory->real_memory.memory;
+    res = internal_ipm_structure_map(memory, "a broadcast channel", header->slots_offset + header->capacity * header->stride);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return broadcast_handle_create(memory, 0, p_broadcast);
+}
+
+void ipm_broadcast_close(ipm_broadcast* broadcast)
+{
+    ipm_free(&broadcast->memory->ctx, broadcast);
+}
+
+size_t ipm_broadcast_record_size(const ipm_broadcast* broadcast)
+{
+    return broadcast->record_size;
+}
+
+ipm_result ipm_broadcast_publish(ipm_broadcast* broadcast, const void* data, size_t size)
+{
+    if (!broadcast->writer)
+    {
+        IPM_ERROR(&broadcast->memory->ctx, "Records can only be published through the handle which created the broadcast channel");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (size > broadcast->record_size)
+    {
+        IPM_ERROR(&broadcast->memory->ctx, "Record of %zu bytes is larger than the largest record of the channel (%zu bytes)", size, broadcast->record_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    ipm_broadcast_header* const header = broadcast->header;
+    const uint64_t number = broadcast->cursor;
+    ipm_broadcast_slot* const slot = broadcast_slot(broadcast, number);
+    //  Odd sequence makes readers which are copying the old record from the slot discard what they copied
+    atomic_store_explicit(&slot->sequence, 2 * number + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->size = size;
+    memcpy((uint8_t*)slot + IPM_BROADCAST_RECORD_OFFSET, data, size);
+    atomic_store_explicit(&slot->sequence, 2 * number + 2, memory_order_release);
+    atomic_store_explicit(&header->published, number + 1, memory_order_release);
+    broadcast->cursor = number + 1;
+
+    //  Waiting reader announces itself before checking the count for the last time, so one of them sees the other's change
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&header->waiters, memory_order_relaxed))
+    {
+        ipm_futex_wake(published_futex_word(header), UINT32_MAX);
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_broadcast_read(
+        ipm_broadcast* broadcast, void* buffer, size_t buffer_size, size_t* p_size, uint64_t* p_sequence)
+{
+    const uint64_t number = broadcast->cursor;
+    const ipm_broadcast_slot* const slot = broadcast_slot(broadcast, number);
+    const uint64_t expected = 2 * number + 2;
+    const uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence < expected)
+    {
+        //  Slot still holds the record one lap before, or the writer is just writing the wanted one
+        return IPM_RESULT_ERR_EMPTY;
+    }
+    if (sequence == expected)
+    {
+        //  Size may be garbage when the writer is changing the slot, so it is never trusted to stay within the slot
+        const size_t size = slot->size;
+        size_t copied = size < buffer_size ? size : buffer_size;
+        if (copied > broadcast->record_size)
+        {
+            copied = broadcast->record_size;
+        }
+        memcpy(buffer, (const uint8_t*)slot + IPM_BROADCAST_RECORD_OFFSET, copied);
+        //  Copy is only valid if the writer did not start on the slot meanwhile
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == expected)
+        {
+            if (p_size)
+            {
+                *p_size = size;
+            }
+            if (size > buffer_size)
+            {
+                return IPM_RESULT_ERR_BAD_SIZE;
+            }
+            if (p_sequence)
+            {
+                *p_sequence = number;
+            }
+            broadcast->cursor = number + 1;
+            return IPM_RESULT_SUCCESS;
+        }
+    }
+    //  Writer is at least a lap ahead, so skip to the oldest record it is not about to overwrite
+    const uint64_t published = atomic_load_explicit(&broadcast->header->published, memory_order_acquire);
+    const uint64_t oldest = published - broadcast->mask;
+    broadcast->cursor = oldest > number ? oldest : number + 1;
+    return IPM_RESULT_ERR_LAPPED;
+}
+
+ipm_result ipm_broadcast_wait(ipm_broadcast* broadcast, unsigned timeout_ms)
+{
+    ipm_broadcast_header* const header = broadcast->header;
+    //  Writer usually publishes again soon, which is much cheaper to wait for without a system call
+    for (unsigned i = 0; i < IPM_BROADCAST_SPIN_COUNT; ++i)
+    {
+        if (atomic_load_explicit(&header->published, memory_order_acquire) > broadcast->cursor)
+        {
+            return IPM_RESULT_SUCCESS;
+        }
+    }
+    if (broadcast->memory->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&broadcast->memory->ctx, "Waiting for a broadcast record needs a handle with read-write access");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    const uint64_t deadline = monotonic_time_ms() + timeout_ms;
+    for (;;)
+    {
+        atomic_fetch_add_explicit(&header->waiters, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        const uint64_t published = atomic_load_explicit(&header->published, memory_order_acquire);
+        if (published > broadcast->cursor)
+        {
+            atomic_fetch_sub_explicit(&header->waiters, 1, memory_order_relaxed);
+            return IPM_RESULT_SUCCESS;
+        }
+        const uint64_t now = monotonic_time_ms();
+        const ipm_result res = now < deadline ? ipm_futex_wait(published_futex_word(header), (uint32_t)published, (unsigned)(deadline - now)) : IPM_RESULT_ERR_TIMED_OUT;
+        atomic_fetch_sub_explicit(&header->waiters, 1, memory_order_relaxed);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+}
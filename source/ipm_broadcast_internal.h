@@ -0,0 +1,54 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_BROADCAST_INTERNAL_H
+#define IPM_BROADCAST_INTERNAL_H
+#include "../include/ipm/ipm_broadcast.h"
+#include "ipm_memory_internal.h"
+
+enum
+{
+    IPM_BROADCAST_MAGIC = 0x54534342,       //  Reads as "BCST" on little-endian
+    IPM_BROADCAST_LAYOUT_VERSION = 1,
+    IPM_BROADCAST_RECORD_OFFSET = 16,       //  Offset of the contents of the record from the start of its slot
+    IPM_BROADCAST_SPIN_COUNT = 1024,        //  Times the reader checks for a new record before it goes to sleep
+};
+
+//  Slots are padded to whole cache lines, so that readers of one record do not slow down the writer of the next one
+struct ipm_broadcast_slot_T
+{
+    //  Twice the number of the record plus one while the writer changes the slot, plus two once the record is published
+    _Atomic uint64_t sequence;
+    uint64_t size;
+};
+typedef struct ipm_broadcast_slot_T ipm_broadcast_slot;
+
+//  Placed at the start of the block
+struct ipm_broadcast_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t capacity;
+    uint64_t record_size;
+    uint64_t stride;            //  Distance between the starts of two neighbouring slots
+    uint64_t slots_offset;      //  Offset of the first slot from the start of the block
+
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t published;   //  Number of published records
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint32_t waiters;     //  Readers sleep on the lower half of the count
+};
+typedef struct ipm_broadcast_header_T ipm_broadcast_header;
+
+struct ipm_broadcast_T
+{
+    ipm_memory* memory;
+    ipm_broadcast_header* header;
+    uint8_t* slots;
+    uint64_t mask;              //  Capacity less one
+    uint64_t stride;
+    size_t record_size;
+    ipm_bool writer;
+    uint64_t cursor;            //  Number of the next record to publish or to read
+};
+
+#endif //IPM_BROADCAST_INTERNAL_H
@@ -0,0 +1,462 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_buffer_pool_internal.h"
+#include "ipm_structure.h"
+
+static inline uint64_t make_owner(uint32_t state, uint32_t value)
+{
+    return (uint64_t)state << 32 | value;
+}
+
+static inline ipm_buffer_slot* consumer_slot(const ipm_buffer_pool* pool, const ipm_buffer_consumer* consumer, uint64_t position)
+{
+    ipm_buffer_slot* const slots = (ipm_buffer_slot*)((uint8_t*)pool->header + consumer->slots_offset);
+    return slots + (position & (pool->header->queue_capacity - 1));
+}
+
+static inline uint64_t descriptor_offset(const ipm_buffer_pool* pool, unsigned buffer)
+{
+    return pool->header->descriptors_offset + (uint64_t)buffer * sizeof(ipm_buffer_descriptor);
+}
+
+static inline unsigned holder_lock_byte(unsigned slot)
+{
+    return IPM_SHARED_MEMORY_LOCK_USERS + slot;
+}
+
+static inline uint32_t holder_id(unsigned slot, uint32_t generation)
+{
+    return generation << IPM_BUFFER_POOL_HOLDER_BITS | slot;
+}
+
+static ipm_result holder_register(ipm_buffer_pool* pool)
+{
+    const ipm_shared_memory_block* const block = &pool->memory->real_memory;
+    const uint64_t access_id = block->access_id;
+    for (unsigned i = 0; i < IPM_BUFFER_POOL_MAX_HOLDERS; ++i)
+    {
+        ipm_buffer_holder* const holder = pool->header->holders + i;
+        //  Slot of another pool handle opened through the same memory handle shares its lock, so it is told apart by the
+        //  ID, and the lock is never released here, since that would release that handle's lock
+        if (atomic_load(&holder->access_id) == access_id || !shared_memory_block_lock_byte(block, holder_lock_byte(i)))
+        {
+            continue;
+        }
+        uint64_t previous = atomic_load(&holder->access_id);
+        if (previous == access_id || !atomic_compare_exchange_strong(&holder->access_id, &previous, access_id))
+        {
+            continue;
+        }
+        const uint32_t generation = atomic_fetch_add(&holder->generation, 1) + 1;
+        pool->holder_slot = i;
+        pool->holder_id = holder_id(i, generation);
+        return IPM_RESULT_SUCCESS;
+    }
+    IPM_ERROR(&pool->memory->ctx, "Buffer pool in block \"%s\" is already open through %u handles", pool->memory->block_name, (unsigned)IPM_BUFFER_POOL_MAX_HOLDERS);
+    return IPM_RESULT_ERR_FULL;
+}
+
+static ipm_bool holder_is_alive(const ipm_buffer_pool* pool, uint32_t id)
+{
+    const unsigned slot = id & ((1u << IPM_BUFFER_POOL_HOLDER_BITS) - 1);
+    const ipm_buffer_holder* const holder = pool->header->holders + slot;
+    const uint64_t access_id = atomic_load(&holder->access_id);
+    if (access_id == 0 || holder_id(slot, atomic_load(&holder->generation)) != id)
+    {
+        //  Holder closed its handle, or its slot was taken by another since
+        return 0;
+    }
+    //  Handle opened through the same memory handle shares its lock, which can not be tested, but it is open as well
+    return access_id == pool->memory->real_memory.access_id ||
+           shared_memory_block_byte_is_locked(&pool->memory->real_memory, holder_lock_byte(slot));
+}
+
+static ipm_result check_consumer(const ipm_buffer_pool* pool, unsigned consumer_index)
+{
+    if (consumer_index >= pool->header->consumer_count)
+    {
+        IPM_ERROR(&pool->memory->ctx, "Buffer pool has no consumer %u", consumer_index);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+static void slot_free(const ipm_buffer_pool* pool, ipm_buffer_consumer* consumer, ipm_buffer_slot* slot, uint64_t position)
+{
+    //  Either the receiver or whoever finishes for it after it died frees the slot for the position one lap later, and
+    //  only then moves the consumer past it
+    uint64_t expected = position + 1;
+    atomic_compare_exchange_strong_explicit(&slot->sequence, &expected, position + pool->header->queue_capacity, memory_order_release, memory_order_relaxed);
+    expected = position;
+    atomic_compare_exchange_strong_explicit(&consumer->dequeue_position, &expected, position + 1, memory_order_relaxed, memory_order_relaxed);
+}
+
+static ipm_result buffer_pool_handle_create(ipm_memory* memory, ipm_buffer_pool** p_pool)
+{
+    ipm_buffer_pool_header* const header = memory->real_memory.memory;
+    ipm_buffer_pool* const pool = internal_ipm_structure_alloc_handle(memory, "a buffer pool", sizeof(*pool));
+    if (!pool)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    pool->memory = memory;
+    pool->header = header;
+    pool->consumers = (ipm_buffer_consumer*)((uint8_t*)header + align_line(sizeof(*header)));
+    pool->descriptors = (ipm_buffer_descriptor*)((uint8_t*)header + header->descriptors_offset);
+    const ipm_result res = holder_register(pool);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        ipm_free(&memory->ctx, pool);
+        return res;
+    }
+    *p_pool = pool;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_buffer_pool_create(
+        ipm_memory* memory, size_t buffer_size, unsigned buffer_count, const char* const* consumer_names,
+        unsigned consumer_count, ipm_buffer_pool** p_pool)
+{
+    assert(buffer_size > 0);
+    assert(buffer_count > 0);
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a buffer pool");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    for (unsigned i = 0; i < consumer_count; ++i)
+    {
+        if (strlen(consumer_names[i]) > IPM_MAX_NAME_LEN)
+        {
+            IPM_ERROR(&memory->ctx, "Consumer name \"%s\" is longer than %u characters", consumer_names[i], (unsigned)IPM_MAX_NAME_LEN);
+            return IPM_RESULT_ERR_NAME_TOO_LONG;
+        }
+    }
+    uint64_t queue_capacity = 1;
+    while (queue_capacity < buffer_count)
+    {
+        queue_capacity <<= 1;
+    }
+    const uint64_t consumers_offset = align_line(sizeof(ipm_buffer_pool_header));
+    const uint64_t descriptors_offset = consumers_offset + (uint64_t)consumer_count * sizeof(ipm_buffer_consumer);
+    const uint64_t queues_offset = align_line(descriptors_offset + (uint64_t)buffer_count * sizeof(ipm_buffer_descriptor));
+    const uint64_t buffers_offset = round_size(queues_offset + (uint64_t)consumer_count * queue_capacity * sizeof(ipm_buffer_slot));
+    const uint64_t buffer_stride = align_line(buffer_size);
+    const size_t needed_size = round_size(buffers_offset + (uint64_t)buffer_count * buffer_stride);
+    if (memory->real_memory.size < needed_size)
+    {
+        res = ipm_memory_resize_grow(memory, needed_size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the buffer pool, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_buffer_pool_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    header->layout_version = IPM_BUFFER_POOL_LAYOUT_VERSION;
+    header->buffer_size = buffer_size;
+    header->buffer_count = buffer_count;
+    header->buffer_stride = buffer_stride;
+    header->buffers_offset = buffers_offset;
+    header->descriptors_offset = descriptors_offset;
+    header->queue_capacity = queue_capacity;
+    header->consumer_count = consumer_count;
+    lockfree_stack_init(&header->free_list);
+    for (unsigned i = 0; i < consumer_count; ++i)
+    {
+        ipm_buffer_consumer* const consumer = (ipm_buffer_consumer*)((uint8_t*)header + consumers_offset) + i;
+        memset(consumer, 0, sizeof(*consumer));
+        strcpy(consumer->name, consumer_names[i]);
+        consumer->slots_offset = queues_offset + (uint64_t)i * queue_capacity * sizeof(ipm_buffer_slot);
+        atomic_init(&consumer->enqueue_position, 0);
+        atomic_init(&consumer->dequeue_position, 0);
+        atomic_init(&consumer->not_empty, 0);
+        atomic_init(&consumer->waiters, 0);
+        ipm_buffer_slot* const slots = (ipm_buffer_slot*)((uint8_t*)header + consumer->slots_offset);
+        for (uint64_t j = 0; j < queue_capacity; ++j)
+        {
+            atomic_init(&slots[j].sequence, j);
+            slots[j].buffer = 0;
+        }
+    }
+    for (unsigned i = buffer_count; i > 0; --i)
+    {
+        //  Pushed in reverse, so that the buffers are handed out from the lowest index up
+        const uint64_t offset = descriptors_offset + (uint64_t)(i - 1) * sizeof(ipm_buffer_descriptor);
+        ipm_buffer_descriptor* const descriptor = (ipm_buffer_descriptor*)((uint8_t*)header + offset);
+        atomic_init(&descriptor->owner, make_owner(IPM_BUFFER_STATE_FREE, 0));
+        lockfree_stack_push(&header->free_list, header, offset);
+    }
+    //  Magic is written last, so that the pool is not opened before it is ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_BUFFER_POOL_MAGIC, memory_order_release);
+
+    res = buffer_pool_handle_create(memory, p_pool);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+    }
+    return res;
+}
+
+ipm_result ipm_buffer_pool_open(ipm_memory* memory, ipm_buffer_pool** p_pool)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a buffer pool");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a buffer pool", IPM_BUFFER_POOL_MAGIC, IPM_BUFFER_POOL_LAYOUT_VERSION, sizeof(ipm_buffer_pool_header));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const ipm_buffer_pool_header* const header = memory->real_memory.memory;
+    res = internal_ipm_structure_map(memory, "a buffer pool", header->buffers_offset + header->buffer_count * header->buffer_stride);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return buffer_pool_handle_create(memory, p_pool);
+}
+
+void ipm_buffer_pool_close(ipm_buffer_pool* pool)
+{
+    atomic_store(&pool->header->holders[pool->holder_slot].access_id, 0);
+    shared_memory_block_unlock_byte(&pool->memory->real_memory, holder_lock_byte(pool->holder_slot));
+    ipm_free(&pool->memory->ctx, pool);
+}
+
+size_t ipm_buffer_pool_buffer_size(const ipm_buffer_pool* pool)
+{
+    return pool->header->buffer_size;
+}
+
+ipm_result ipm_buffer_pool_find_consumer(const ipm_buffer_pool* pool, const char* name, unsigned* p_consumer)
+{
+    for (unsigned i = 0; i < pool->header->consumer_count; ++i)
+    {
+        if (strcmp(pool->consumers[i].name, name) == 0)
+        {
+            *p_consumer = i;
+            return IPM_RESULT_SUCCESS;
+        }
+    }
+    IPM_ERROR(&pool->memory->ctx, "Buffer pool has no consumer named \"%s\"", name);
+    return IPM_RESULT_ERR_BAD_VALUE;
+}
+
+void* ipm_buffer_pool_pointer(const ipm_buffer_pool* pool, unsigned buffer)
+{
+    assert(buffer < pool->header->buffer_count);
+    return (uint8_t*)pool->header + pool->header->buffers_offset + (uint64_t)buffer * pool->header->buffer_stride;
+}
+
+ipm_result ipm_buffer_pool_acquire(ipm_buffer_pool* pool, unsigned* p_buffer)
+{
+    ipm_buffer_pool_header* const header = pool->header;
+    const uint64_t offset = lockfree_stack_pop(&header->free_list, header, IPM_LOCKFREE_OFFSET_MASK);
+    if (!offset)
+    {
+        return IPM_RESULT_ERR_POOL_EMPTY;
+    }
+    const unsigned buffer = (unsigned)((offset - header->descriptors_offset) / sizeof(ipm_buffer_descriptor));
+    atomic_store_explicit(&pool->descriptors[buffer].owner, make_owner(IPM_BUFFER_STATE_HELD, pool->holder_id), memory_order_relaxed);
+    *p_buffer = buffer;
+    return IPM_RESULT_SUCCESS;
+}
+
+/**
+ * Changes the owner of the buffer, but only from the expected one.
+ * @return IPM_RESULT_SUCCESS when successful, or IPM_RESULT_ERR_BAD_VALUE when the buffer had a different owner.
+ */
+static ipm_result buffer_change_owner(ipm_buffer_pool* pool, unsigned buffer, uint64_t expected, uint64_t owner)
+{
+    if (buffer >= pool->header->buffer_count)
+    {
+        IPM_ERROR(&pool->memory->ctx, "Buffer pool has no buffer %u", buffer);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&pool->descriptors[buffer].owner, &expected, owner, memory_order_acq_rel, memory_order_relaxed))
+    {
+        IPM_ERROR(&pool->memory->ctx, "Buffer %u is not held by this process", buffer);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_buffer_pool_hand_off(ipm_buffer_pool* pool, unsigned buffer, unsigned consumer_index)
+{
+    ipm_result res = check_consumer(pool, consumer_index);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (buffer >= pool->header->buffer_count)
+    {
+        IPM_ERROR(&pool->memory->ctx, "Buffer pool has no buffer %u", buffer);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    //  Only the holder itself changes the owner of a buffer it holds, or others once it is no longer open
+    if (atomic_load_explicit(&pool->descriptors[buffer].owner, memory_order_relaxed) != make_owner(IPM_BUFFER_STATE_HELD, pool->holder_id))
+    {
+        IPM_ERROR(&pool->memory->ctx, "Buffer %u is not held by this handle", buffer);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    ipm_buffer_consumer* const consumer = pool->consumers + consumer_index;
+    const uint64_t capacity = pool->header->queue_capacity;
+    uint64_t position = atomic_load_explicit(&consumer->enqueue_position, memory_order_relaxed);
+    ipm_buffer_slot* slot;
+    for (;;)
+    {
+        //  Queue can hold every buffer, so a slot which is not free is only still being emptied by a receiver
+        slot = consumer_slot(pool, consumer, position);
+        const uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == position)
+        {
+            if (atomic_compare_exchange_weak_explicit(&consumer->enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+            continue;
+        }
+        if (sequence == position - capacity + 1 &&
+            atomic_load_explicit(&pool->descriptors[slot->buffer].owner, memory_order_acquire) != make_owner(IPM_BUFFER_STATE_QUEUED, (uint32_t)(position - capacity)))
+        {
+            //  Buffer was taken by a receiver which died before freeing its slot
+            slot_free(pool, consumer, slot, position - capacity);
+        }
+        position = atomic_load_explicit(&consumer->enqueue_position, memory_order_relaxed);
+    }
+    //  Owner is the position, so that a receiver which read the slot of an earlier lap can not take the buffer
+    atomic_store_explicit(&pool->descriptors[buffer].owner, make_owner(IPM_BUFFER_STATE_QUEUED, (uint32_t)position), memory_order_relaxed);
+    slot->buffer = buffer;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+    //  Waiter announces itself before checking the queue for the last time, so one of them sees the other's change
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&consumer->waiters, memory_order_relaxed))
+    {
+        atomic_fetch_add_explicit(&consumer->not_empty, 1, memory_order_relaxed);
+        ipm_futex_wake((uint32_t*)&consumer->not_empty, 1);
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_buffer_pool_receive(ipm_buffer_pool* pool, unsigned consumer_index, unsigned* p_buffer)
+{
+    const ipm_result res = check_consumer(pool, consumer_index);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    ipm_buffer_consumer* const consumer = pool->consumers + consumer_index;
+    const uint64_t capacity = pool->header->queue_capacity;
+    uint64_t position = atomic_load_explicit(&consumer->dequeue_position, memory_order_relaxed);
+    for (;;)
+    {
+        ipm_buffer_slot* const slot = consumer_slot(pool, consumer, position);
+        const uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == position + 1)
+        {
+            //  Buffer is taken before its slot is freed, so that it is never left queued with no slot holding it
+            const unsigned buffer = (unsigned)slot->buffer;
+            uint64_t owner = make_owner(IPM_BUFFER_STATE_QUEUED, (uint32_t)position);
+            const ipm_bool taken = atomic_compare_exchange_strong_explicit(
+                    &pool->descriptors[buffer].owner, &owner, make_owner(IPM_BUFFER_STATE_HELD, pool->holder_id),
+                    memory_order_acq_rel, memory_order_relaxed);
+            //  When another receiver took it, it is helped along, in case it died before it could free the slot
+            slot_free(pool, consumer, slot, position);
+            if (taken)
+            {
+                *p_buffer = buffer;
+                return IPM_RESULT_SUCCESS;
+            }
+            position = atomic_load_explicit(&consumer->dequeue_position, memory_order_relaxed);
+            continue;
+        }
+        if ((int64_t)(sequence - (position + capacity)) >= 0)
+        {
+            //  Slot was freed, but the receiver did not move past it before it died
+            atomic_compare_exchange_strong_explicit(&consumer->dequeue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed);
+            position = atomic_load_explicit(&consumer->dequeue_position, memory_order_relaxed);
+            continue;
+        }
+        const uint64_t current = atomic_load_explicit(&consumer->dequeue_position, memory_order_relaxed);
+        if (current == position)
+        {
+            return IPM_RESULT_ERR_EMPTY;
+        }
+        position = current;
+    }
+}
+
+ipm_result ipm_buffer_pool_receive_wait(
+        ipm_buffer_pool* pool, unsigned consumer_index, unsigned timeout_ms, unsigned* p_buffer)
+{
+    //  Producer usually hands off another buffer soon, which is much cheaper to wait for without a system call
+    for (unsigned i = 0; i < IPM_BUFFER_POOL_SPIN_COUNT; ++i)
+    {
+        const ipm_result res = ipm_buffer_pool_receive(pool, consumer_index, p_buffer);
+        if (res != IPM_RESULT_ERR_EMPTY)
+        {
+            return res;
+        }
+    }
+    ipm_buffer_consumer* const consumer = pool->consumers + consumer_index;
+    const uint64_t deadline = monotonic_time_ms() + timeout_ms;
+    for (;;)
+    {
+        atomic_fetch_add_explicit(&consumer->waiters, 1, memory_order_relaxed);
+        const uint32_t expected = atomic_load_explicit(&consumer->not_empty, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        ipm_result res = ipm_buffer_pool_receive(pool, consumer_index, p_buffer);
+        if (res != IPM_RESULT_ERR_EMPTY)
+        {
+            atomic_fetch_sub_explicit(&consumer->waiters, 1, memory_order_relaxed);
+            return res;
+        }
+        const uint64_t now = monotonic_time_ms();
+        res = now < deadline ? ipm_futex_wait((uint32_t*)&consumer->not_empty, expected, (unsigned)(deadline - now)) : IPM_RESULT_ERR_TIMED_OUT;
+        atomic_fetch_sub_explicit(&consumer->waiters, 1, memory_order_relaxed);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+}
+
+ipm_result ipm_buffer_pool_release(ipm_buffer_pool* pool, unsigned buffer)
+{
+    const ipm_result res = buffer_change_owner(
+            pool, buffer, make_owner(IPM_BUFFER_STATE_HELD, pool->holder_id), make_owner(IPM_BUFFER_STATE_FREE, 0));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    lockfree_stack_push(&pool->header->free_list, pool->header, descriptor_offset(pool, buffer));
+    return IPM_RESULT_SUCCESS;
+}
+
+unsigned ipm_buffer_pool_reclaim(ipm_buffer_pool* pool)
+{
+    unsigned reclaimed = 0;
+    for (unsigned i = 0; i < pool->header->buffer_count; ++i)
+    {
+        uint64_t owner = atomic_load_explicit(&pool->descriptors[i].owner, memory_order_acquire);
+        if (owner >> 32 != IPM_BUFFER_STATE_HELD || holder_is_alive(pool, (uint32_t)owner))
+        {
+            continue;
+        }
+        //  Only one process may reclaim the buffer, and only if its owner did not change meanwhile
+        if (atomic_compare_exchange_strong_explicit(&pool->descriptors[i].owner, &owner, make_owner(IPM_BUFFER_STATE_FREE, 0), memory_order_acq_rel, memory_order_relaxed))
+        {
+            lockfree_stack_push(&pool->header->free_list, pool->header, descriptor_offset(pool, i));
+            reclaimed += 1;
+        }
+    }
+    return reclaimed;
+}
@@ -0,0 +1,94 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_BUFFER_POOL_INTERNAL_H
+#define IPM_BUFFER_POOL_INTERNAL_H
+#include "../include/ipm/ipm_buffer_pool.h"
+#include "ipm_memory_internal.h"
+#include "lockfree.h"
+
+enum
+{
+    IPM_BUFFER_POOL_MAGIC = 0x46465542,     //  Reads as "BUFF" on little-endian
+    IPM_BUFFER_POOL_LAYOUT_VERSION = 2,
+    IPM_BUFFER_POOL_SPIN_COUNT = 1024,      //  Times a consumer checks for a buffer before it goes to sleep
+    IPM_BUFFER_POOL_MAX_HOLDERS = IPM_BUFFER_POOL_MAX_HANDLES,
+    IPM_BUFFER_POOL_HOLDER_BITS = 8,        //  Bits of the holder ID which are the index of its slot
+};
+
+//  Owner of a buffer is its state in the upper half and the holder or queue position it belongs to in the lower half
+enum ipm_buffer_state_T
+{
+    IPM_BUFFER_STATE_FREE = 0,      //  On the free list
+    IPM_BUFFER_STATE_HELD = 1,      //  Held by the pool handle with the holder ID in the lower half
+    IPM_BUFFER_STATE_QUEUED = 2,    //  Handed off to a consumer, with the lower half of the queue position it is at
+};
+
+//  Pool handle which may hold buffers. It keeps a byte of the block's object locked while it is open, so that its
+//  buffers are reclaimed once it is not, no matter how its process ended.
+struct ipm_buffer_holder_T
+{
+    _Atomic uint64_t access_id; //  Access ID of the memory handle the pool handle was opened through
+    _Atomic uint32_t generation;//  Incremented each time the slot is taken, so the buffers of earlier holders are told apart
+};
+typedef struct ipm_buffer_holder_T ipm_buffer_holder;
+
+//  Describes one buffer, and is also the node of the free list
+struct ipm_buffer_descriptor_T
+{
+    _Atomic uint64_t next;      //  Used by the free list
+    _Atomic uint64_t owner;
+};
+typedef struct ipm_buffer_descriptor_T ipm_buffer_descriptor;
+
+//  Queue of buffers handed off to a consumer, which can hold every buffer, so handing off never has to wait for space
+struct ipm_buffer_slot_T
+{
+    _Atomic uint64_t sequence;  //  Equal to the position when the slot is free, and to the position plus one when full
+    uint64_t buffer;
+};
+typedef struct ipm_buffer_slot_T ipm_buffer_slot;
+
+struct ipm_buffer_consumer_T
+{
+    char name[IPM_MAX_NAME_LEN + 1];
+    uint64_t slots_offset;      //  Offset of the slots of the queue from the start of the block
+
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t enqueue_position;
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t dequeue_position;
+    //  Futex word is only changed when the consumer waits on it
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint32_t not_empty;
+    _Atomic uint32_t waiters;
+};
+typedef struct ipm_buffer_consumer_T ipm_buffer_consumer;
+
+//  Placed at the start of the block, followed by the consumers, the descriptors, the queues and the buffers
+struct ipm_buffer_pool_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t buffer_size;
+    uint64_t buffer_count;
+    uint64_t buffer_stride;     //  Distance between the starts of two neighbouring buffers
+    uint64_t buffers_offset;    //  Offset of the first buffer from the start of the block
+    uint64_t descriptors_offset;
+    uint64_t queue_capacity;    //  Number of slots in the queue of each consumer
+    uint64_t consumer_count;
+
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_lockfree_stack free_list;   //  Offsets of descriptors of free buffers
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_buffer_holder holders[IPM_BUFFER_POOL_MAX_HOLDERS];
+};
+typedef struct ipm_buffer_pool_header_T ipm_buffer_pool_header;
+
+struct ipm_buffer_pool_T
+{
+    ipm_memory* memory;
+    ipm_buffer_pool_header* header;
+    ipm_buffer_consumer* consumers;
+    ipm_buffer_descriptor* descriptors;
+    unsigned holder_slot;
+    uint32_t holder_id;         //  Index of the holder's slot in the lower bits and its generation in the rest
+};
+
+#endif //IPM_BUFFER_POOL_INTERNAL_H
@@ -33,6 +33,18 @@ void ipm_free(const ipm_context* context, void* ptr)
     context->free_callback(context->free_param, ptr);
 }
 
+uint64_t ipm_hash_name(const char* name)
+{
+    //  FNV-1a
+    uint64_t hash = 0xCBF29CE484222325;
+    for (const unsigned char* c = (const unsigned char*)name; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
 void
 ipm_report_error(const ipm_context* context, const char* msg, const char* file, int line, const char* function, ...)
 {
@@ -42,6 +42,19 @@ static const struct
 
         [IPM_RESULT_ERR_BAD_ACCESS] = {.str = "IPM_RESULT_ERR_BAD_ACCESS", .msg = "Desire access is incompatible with the memory block"},
         [IPM_RESULT_ERR_DOES_NOT_EXIST] = {.str = "IPM_RESULT_ERR_DOES_NOT_EXIST", .msg = "Memory block does not exist"},
+
+        [IPM_RESULT_ERR_NOT_SUPPORTED] = {.str = "IPM_RESULT_ERR_NOT_SUPPORTED", .msg = "Operation is not supported on this platform"},
+        [IPM_RESULT_ERR_REGION_CLAIMED] = {.str = "IPM_RESULT_ERR_REGION_CLAIMED", .msg = "Region of the memory block is claimed"},
+        [IPM_RESULT_ERR_SEGMENT_FULL] = {.str = "IPM_RESULT_ERR_SEGMENT_FULL", .msg = "Segment has no space left for the block"},
+        [IPM_RESULT_ERR_BAD_VERSION] = {.str = "IPM_RESULT_ERR_BAD_VERSION", .msg = "Shared memory object has an incompatible layout version"},
+        [IPM_RESULT_ERR_TIMED_OUT] = {.str = "IPM_RESULT_ERR_TIMED_OUT", .msg = "Timed out while waiting"},
+        [IPM_RESULT_ERR_SEALED] = {.str = "IPM_RESULT_ERR_SEALED", .msg = "Memory block was sealed and can no longer be modified"},
+        [IPM_RESULT_ERR_NO_FREE_WINDOW] = {.str = "IPM_RESULT_ERR_NO_FREE_WINDOW", .msg = "Every window of the memory block is used by a claim"},
+        [IPM_RESULT_ERR_ADDRESS_IN_USE] = {.str = "IPM_RESULT_ERR_ADDRESS_IN_USE", .msg = "Address at which the memory block must be mapped is already in use"},
+        [IPM_RESULT_ERR_POOL_EMPTY] = {.str = "IPM_RESULT_ERR_POOL_EMPTY", .msg = "Every object of the pool is allocated"},
+        [IPM_RESULT_ERR_FULL] = {.str = "IPM_RESULT_ERR_FULL", .msg = "There is no space left for the record"},
+        [IPM_RESULT_ERR_EMPTY] = {.str = "IPM_RESULT_ERR_EMPTY", .msg = "There are no records to take"},
+        [IPM_RESULT_ERR_LAPPED] = {.str = "IPM_RESULT_ERR_LAPPED", .msg = "Record was overwritten before it could be read"},
         };
 
 const char* ipm_result_to_str(ipm_result res)
@@ -17,9 +17,17 @@ static inline size_t round_size(size_t size)
     return size;
 }
 
-ipm_result ipm_memory_create(
-        const ipm_context* context, size_t block_size, const char* block_name, ipm_access_mode access,
-        ipm_memory** p_memory)
+static ipm_result claim_list_initialize(ipm_shared_memory_block* block, void* param)
+{
+    (void) param;
+    const size_t claim_size = block->data_offset - IPM_MEMORY_PAGE_SIZE;
+    const size_t real_claim_capacity = (claim_size - sizeof(ipm_claim_list)) / sizeof(ipm_memory_claim);
+    return claim_list_init(block->metadata, real_claim_capacity);
+}
+
+static ipm_result memory_create(
+        const ipm_context* context, const char* directory, size_t block_size, const char* block_name,
+        ipm_access_mode access, const ipm_shared_memory_placement* placement, ipm_memory** p_memory)
 {
     //  Check parameters
     assert(context);
@@ -35,50 +43,77 @@ ipm_result ipm_memory_create(
     }
 
     this->ctx = *context;
+    this->snapshot_id = 0;
+    this->snapshot_size = 0;
+    this->is_cached = 0;
+    this->cache_refs = 0;
+    this->cache_next = NULL;
+    this->windows = NULL;
+    this->window_capacity = 0;
+    this->window_clock = 0;
+    this->event_fd = -1;
+    this->event_sender_fd = -1;
+    this->event_slot = 0;
+    this->event_state = 0;
     const size_t proper_size = round_size(block_size);
     assert(proper_size > 0);
     assert((proper_size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
     strncpy(this->block_name, block_name, sizeof(this->block_name) - 1);
 
+    //  Claim list is placed in the metadata section of the same object as the memory itself
     const size_t claim_size = round_size(sizeof(ipm_claim_list) + IPM_DEFAULT_CLAIM_CAPACITY * sizeof(ipm_memory_claim));
-    ipm_result res = shared_memory_block_create(
-            context, block_name, IPM_MEMORY_BLOCK_ACTIVE_CALIMS, claim_size, IPM_ACCESS_MODE_READ_WRITE, &this->active_claims);
+    const ipm_result res = shared_memory_block_create(
+            context, directory, block_name, IPM_MEMORY_BLOCK_REAL_MEMORY, claim_size, proper_size, access,
+            claim_list_initialize, NULL, placement, &this->real_memory);
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(context, "Could not create the shared memory block claim list %s, reason: %s (%s)", block_name,
+        IPM_ERROR(context, "Could not create the shared memory block %s, reason: %s (%s)", block_name,
                   ipm_result_to_str(res), ipm_result_to_msg(res));
         ipm_free(context, this);
         return res;
     }
-    const size_t real_claim_capacity = (claim_size - sizeof(ipm_claim_list)) / sizeof(ipm_memory_claim);
-    res = claim_list_init(this->active_claims.memory, real_claim_capacity);
-    if (res != IPM_RESULT_SUCCESS)
+
+    *p_memory = this;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_memory_create(
+        const ipm_context* context, size_t block_size, const char* block_name, ipm_access_mode access,
+        ipm_memory** p_memory)
+{
+    return memory_create(context, NULL, block_size, block_name, access, NULL, p_memory);
+}
+
+ipm_result ipm_memory_create_fixed(
+        const ipm_context* context, void* address, size_t block_size, size_t max_size, const char* block_name,
+        ipm_access_mode access, ipm_memory** p_memory)
+{
+    assert(((uintptr_t)address & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    if (max_size < block_size)
     {
-        IPM_ERROR(context, "Could not initialize the claims list for the memory block %s, reason: %s (%s)", block_name,
-                  ipm_result_to_str(res), ipm_result_to_msg(res));
-        shared_memory_block_close(context, &this->active_claims, 0, NULL);
-        ipm_free(context, this);
-        return res;
+        IPM_ERROR(context, "Maximum size of the block (%zu) is less than its size (%zu)", max_size, block_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
     }
+    const ipm_shared_memory_placement placement = {.address = address, .max_size = round_size(max_size)};
+    return memory_create(context, NULL, block_size, block_name, access, &placement, p_memory);
+}
 
-    res = shared_memory_block_create(
-            context, block_name, IPM_MEMORY_BLOCK_REAL_MEMORY, proper_size, access, &this->real_memory);
-    if (res != IPM_RESULT_SUCCESS)
+ipm_result ipm_memory_create_persistent(
+        const ipm_context* context, const char* directory, size_t block_size, const char* block_name,
+        ipm_access_mode access, ipm_memory** p_memory)
+{
+    assert(directory);
+    if (strlen(directory) > IPM_MAX_DIRECTORY_LEN)
     {
-        IPM_ERROR(context, "Could not create the shared memory block %s, reason: %s (%s)", block_name,
-                  ipm_result_to_str(res), ipm_result_to_msg(res));
-        claim_list_uninit(this->active_claims.memory);
-        shared_memory_block_close(context, &this->active_claims, 0, NULL);
-        ipm_free(context, this);
-        return res;
+        IPM_ERROR(context, "Directory path is longer than %u characters", (unsigned)IPM_MAX_DIRECTORY_LEN);
+        return IPM_RESULT_ERR_NAME_TOO_LONG;
     }
-
-    *p_memory = this;
-    return IPM_RESULT_SUCCESS;
+    return memory_create(context, directory, block_size, block_name, access, NULL, p_memory);
 }
 
-ipm_result
-ipm_memory_open(const ipm_context* context, const char* block_name, ipm_access_mode access, ipm_memory** p_memory)
+static ipm_result memory_open(
+        const ipm_context* context, const char* directory, const char* block_name, ipm_access_mode access,
+        unsigned max_windows, ipm_memory** p_memory)
 {
     //  Check parameters
     assert(context);
@@ -93,32 +128,108 @@ ipm_memory_open(const ipm_context* context, const char* block_name, ipm_access_m
     }
 
     this->ctx = *context;
+    this->snapshot_id = 0;
+    this->snapshot_size = 0;
+    this->is_cached = 0;
+    this->cache_refs = 0;
+    this->cache_next = NULL;
+    this->windows = NULL;
+    this->window_capacity = 0;
+    this->window_clock = 0;
+    this->event_fd = -1;
+    this->event_sender_fd = -1;
+    this->event_slot = 0;
+    this->event_state = 0;
     strncpy(this->block_name, block_name, sizeof(this->block_name) - 1);
+    if (max_windows)
+    {
+        this->windows = ipm_alloc(context, sizeof(*this->windows) * max_windows);
+        if (!this->windows)
+        {
+            ipm_free(context, this);
+            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        }
+        memset(this->windows, 0, sizeof(*this->windows) * max_windows);
+        this->window_capacity = max_windows;
+    }
 
     ipm_result res = shared_memory_block_open(
-            context, block_name, IPM_MEMORY_BLOCK_REAL_MEMORY, access, &this->real_memory);
+            context, directory, block_name, IPM_MEMORY_BLOCK_REAL_MEMORY, access, max_windows != 0, &this->real_memory);
     if (res != IPM_RESULT_SUCCESS)
     {
         IPM_ERROR(context, "Could not open the shared memory block %s, reason: %s (%s)", block_name,
                   ipm_result_to_str(res), ipm_result_to_msg(res));
+        if (this->windows)
+        {
+            ipm_free(context, this->windows);
+        }
         ipm_free(context, this);
         return res;
     }
 
-    res = shared_memory_block_open(
-            context, block_name, IPM_MEMORY_BLOCK_ACTIVE_CALIMS, IPM_ACCESS_MODE_READ_WRITE, &this->active_claims);
-    if (res != IPM_RESULT_SUCCESS)
+    if (this->real_memory.was_recovered)
     {
-        IPM_ERROR(context, "Could not open the shared memory block claim list %s, reason: %s (%s)", block_name,
-                  ipm_result_to_str(res), ipm_result_to_msg(res));
-        shared_memory_block_close(context, &this->real_memory, 0, NULL);
-        ipm_free(context, this);
-        return res;
+        //  Claims in the list were made by processes which no longer have the block open, so the list is reset
+        ipm_claim_list* const list = this->real_memory.metadata;
+        res = claim_list_init(list, list->capacity);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(context, "Could not reset the claims list for the memory block %s, reason: %s (%s)", block_name,
+                      ipm_result_to_str(res), ipm_result_to_msg(res));
+            shared_memory_block_close(context, &this->real_memory, 0, NULL);
+            if (this->windows)
+            {
+                ipm_free(context, this->windows);
+            }
+            ipm_free(context, this);
+            return res;
+        }
     }
     *p_memory = this;
     return IPM_RESULT_SUCCESS;
 }
 
+ipm_result
+ipm_memory_open(const ipm_context* context, const char* block_name, ipm_access_mode access, ipm_memory** p_memory)
+{
+    return memory_open(context, NULL, block_name, access, 0, p_memory);
+}
+
+ipm_result ipm_memory_open_windowed(
+        const ipm_context* context, const char* block_name, ipm_access_mode access, unsigned max_windows,
+        ipm_memory** p_memory)
+{
+    assert(max_windows > 0);
+    return memory_open(context, NULL, block_name, access, max_windows, p_memory);
+}
+
+ipm_result ipm_memory_open_persistent(
+        const ipm_context* context, const char* directory, const char* block_name, ipm_access_mode access,
+        ipm_memory** p_memory)
+{
+    assert(directory);
+    if (strlen(directory) > IPM_MAX_DIRECTORY_LEN)
+    {
+        IPM_ERROR(context, "Directory path is longer than %u characters", (unsigned)IPM_MAX_DIRECTORY_LEN);
+        return IPM_RESULT_ERR_NAME_TOO_LONG;
+    }
+    return memory_open(context, directory, block_name, access, 0, p_memory);
+}
+
+ipm_result ipm_memory_remove_persistent(const ipm_context* context, const char* directory, const char* block_name)
+{
+    assert(context);
+    assert(directory);
+    assert(strchr(block_name, '/') == NULL);
+    assert(strlen(block_name) <= IPM_MAX_NAME_LEN);
+    if (strlen(directory) > IPM_MAX_DIRECTORY_LEN)
+    {
+        IPM_ERROR(context, "Directory path is longer than %u characters", (unsigned)IPM_MAX_DIRECTORY_LEN);
+        return IPM_RESULT_ERR_NAME_TOO_LONG;
+    }
+    return shared_memory_block_remove(context, directory, block_name, IPM_MEMORY_BLOCK_REAL_MEMORY);
+}
+
 static void claim_list_dtor_wrapper(void* ptr)
 {
     ipm_claim_list* const list = ptr;
@@ -127,15 +238,29 @@ static void claim_list_dtor_wrapper(void* ptr)
 
 void ipm_memory_close(ipm_memory* memory)
 {
+    if (!internal_ipm_memory_cache_release(memory))
+    {
+        //  Handle is still used by others who opened it through the cache
+        return;
+    }
     ipm_memory_release_all(memory);
-    shared_memory_block_close(&memory->ctx, &memory->active_claims, claim_list_dtor_wrapper, memory->active_claims.memory);
-    shared_memory_block_close(&memory->ctx, &memory->real_memory, 0, NULL);
+    internal_ipm_memory_events_close(memory, 1);
+    internal_ipm_snapshot_drop_shadow(memory);
+    internal_ipm_memory_windows_unmap(memory);
+    shared_memory_block_close(&memory->ctx, &memory->real_memory, claim_list_dtor_wrapper, memory->real_memory.metadata);
     ipm_free(&memory->ctx, memory);
 }
 
 void ipm_memory_clean(ipm_memory* memory)
 {
-    shared_memory_block_clean(&memory->active_claims);
+    if (!internal_ipm_memory_cache_release(memory))
+    {
+        return;
+    }
+    //  Watcher is left in the block, since it may belong to the process this one was forked from
+    internal_ipm_memory_events_close(memory, 0);
+    internal_ipm_snapshot_drop_shadow(memory);
+    internal_ipm_memory_windows_unmap(memory);
     shared_memory_block_clean(&memory->real_memory);
     ipm_free(&memory->ctx, memory);
 }
@@ -144,7 +269,7 @@ ipm_memory_info ipm_memory_get_info(ipm_memory* memory)
 {
     const ipm_memory_info result =
             {
-            .active_claims = ((ipm_claim_list*)memory->active_claims.memory)->count,
+            .active_claims = ((ipm_claim_list*)memory->real_memory.metadata)->count,
             .block_size = memory->real_memory.size,
             .mapping_address = memory->real_memory.memory,
             .access_id = memory->real_memory.access_id,
@@ -162,6 +287,7 @@ ipm_result ipm_memory_sync(ipm_memory* memory)
     {
         IPM_ERROR(&memory->ctx, "Memory sync for block \"%s\" failed, reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
     }
+    internal_ipm_memory_windows_update(memory);
     return res;
 }
 
@@ -183,146 +309,453 @@ ipm_result ipm_memory_resize_grow(ipm_memory* memory, size_t new_size)
         }
         return res;
     }
+    (void)internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_RESIZED, 0, SIZE_MAX);
     return IPM_RESULT_SUCCESS;
 }
 
-ipm_result ipm_memory_change_access(ipm_memory* memory, ipm_access_mode access_mode)
+ipm_result internal_ipm_memory_grow_unmapped(ipm_memory* memory, size_t new_size)
 {
-    ipm_result res = shared_memory_block_update_mapping(&memory->ctx, &memory->real_memory, access_mode);
+    new_size = round_size(new_size);
+    if (new_size < memory->real_memory.header->block_size)
+    {
+        IPM_ERROR(&memory->ctx, "Can not decrease the size of the memory block from %zu to %zu", memory->real_memory.header->block_size, new_size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    const ipm_result res = shared_memory_block_truncate(&memory->ctx, &memory->real_memory, new_size);
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(&memory->ctx, "Memory access change for block \"%s\" failed, reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+        IPM_ERROR(&memory->ctx, "Memory resizing to %zu bytes for block \"%s\" failed, reason: %s (%s)", new_size, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
     }
-    return res;
+    (void)internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_RESIZED, 0, SIZE_MAX);
+    return IPM_RESULT_SUCCESS;
 }
 
-unsigned ipm_memory_ref_count(const ipm_memory* memory)
+ipm_result ipm_memory_resize_shrink(ipm_memory* memory, size_t new_size)
 {
-    return memory->real_memory.header->refcount;
+    assert(new_size > 0);
+    new_size = round_size(new_size);
+    if (new_size > memory->real_memory.size)
+    {
+        IPM_ERROR(&memory->ctx, "Can not increase the size of the memory block from %zu to %zu", memory->real_memory.size, new_size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+
+    //  Segment is locked before the claim list, so that no claims can be made past the new size until it is truncated
+    ipm_result res = acquire_memory_block_whole(&memory->ctx, &memory->real_memory);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not lock the memory segment, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    res = ipm_mutex_lock(&list->list_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        release_memory_block_whole(&memory->ctx, &memory->real_memory);
+        return res;
+    }
+    for (unsigned i = 0; i < list->count; ++i)
+    {
+        const ipm_memory_claim* const claim = list->claims + i;
+        if (claim->offset + claim->size > new_size)
+        {
+            IPM_ERROR(&memory->ctx, "Can not shrink the memory block to %zu bytes, since region [%zu, %zu) is claimed", new_size, claim->offset, claim->offset + claim->size);
+            res = IPM_RESULT_ERR_REGION_CLAIMED;
+            break;
+        }
+    }
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        res = shared_memory_block_resize(&memory->ctx, &memory->real_memory, new_size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Memory resizing to %zu bytes for block \"%s\" failed, reason: %s (%s)", new_size, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+        }
+    }
+    ipm_mutex_unlock(&list->list_mutex);
+    release_memory_block_whole(&memory->ctx, &memory->real_memory);
+    internal_ipm_memory_windows_update(memory);
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        (void)internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_RESIZED, 0, SIZE_MAX);
+    }
+    return res;
 }
 
-ipm_result ipm_memory_claim_region(ipm_memory* memory, ipm_access_mode access, size_t offset, size_t count, ipm_id* p_claim_id)
+ipm_result ipm_memory_discard(ipm_memory* memory, size_t offset, size_t size)
 {
-    assert(access == IPM_ACCESS_MODE_READ_WRITE || access == IPM_ACCESS_MODE_READ_ONLY);
-    assert(count > 0);
-    assert(p_claim_id);
-    if (memory->real_memory.access_mode == IPM_ACCESS_MODE_READ_ONLY && access == IPM_ACCESS_MODE_READ_WRITE)
+    assert(size > 0);
+    if (memory->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
     {
-        IPM_ERROR(&memory->ctx, "Memory block was opened as read-only and can not be claimed for read only access");
+        IPM_ERROR(&memory->ctx, "Memory block was opened as read-only, so its pages can not be discarded");
         return IPM_RESULT_ERR_BAD_ACCESS;
     }
-    if (memory->real_memory.size < offset + count)
+    if (memory->real_memory.size < offset + size)
     {
-        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) can not be claimed", memory->real_memory.size, offset, offset + count);
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
         return IPM_RESULT_ERR_BAD_VALUE;
     }
+    //  Only pages which are entirely within the region are discarded
+    const size_t begin = round_size(offset);
+    const size_t end = (offset + size) & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    if (end <= begin)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
 
-    //  Lock access list
-    ipm_claim_list* const list = memory->active_claims.memory;
-    assert(list);
+    //  Region must not be claimed by anyone else, which is kept so until the pages are discarded
+    ipm_claim_list* const list = memory->real_memory.metadata;
     ipm_result res = ipm_mutex_lock(&list->list_mutex);
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(&memory->ctx, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res),
-                  ipm_result_to_msg(res));
+        IPM_ERROR(&memory->ctx, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
         return res;
     }
-
-    //  Check if there are any conflicting claims currently active
-    ipm_id id = atomic_fetch_add(&list->claim_counter, 1);
     const ipm_memory_claim claim =
             {
-            .offset = offset,
-            .size = count,
-            .access = access,
-            .claim_id = id,
+            .offset = begin,
+            .size = end - begin,
+            .access = IPM_ACCESS_MODE_READ_WRITE,
             .proc_id = memory->real_memory.access_id,
             };
-    for (;;)
+    if (atomic_load(&memory->real_memory.header->sealed))
     {
-        unsigned i;
-        for (i = 0; i < list->count; ++i)
-        {
-            if (claims_conflict(&claim, list->claims + i))
-            {
-                break;
-            }
-        }
-        if (i == list->count && list->count != list->capacity)
+        IPM_ERROR(&memory->ctx, "Memory block was sealed, so its pages can not be discarded");
+        res = IPM_RESULT_ERR_SEALED;
+    }
+    for (unsigned i = 0; res == IPM_RESULT_SUCCESS && i < list->count; ++i)
+    {
+        if (claims_conflict(&claim, list->claims + i))
         {
-            //  No claims conflict and there's enough space
+            IPM_ERROR(&memory->ctx, "Can not discard region [%zu, %zu), since it is claimed by another handle", begin, end);
+            res = IPM_RESULT_ERR_REGION_CLAIMED;
             break;
         }
-        res = ipm_condition_wait(&list->list_cnd, &list->list_mutex);
+    }
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        res = shared_memory_block_discard(&memory->ctx, &memory->real_memory, begin, end - begin);
         if (res != IPM_RESULT_SUCCESS)
         {
-            IPM_ERROR(&memory->ctx, "Could not wait on condition variable, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
-            ipm_mutex_unlock(&list->list_mutex);
-            return IPM_RESULT_SUCCESS;
+            IPM_ERROR(&memory->ctx, "Discarding region [%zu, %zu) of block \"%s\" failed, reason: %s (%s)", begin, end, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
         }
     }
-
-    res = claim_add_to_list(&claim, list);
     ipm_mutex_unlock(&list->list_mutex);
+    return res;
+}
 
+ipm_result ipm_memory_advise(ipm_memory* memory, size_t offset, size_t size, unsigned hint)
+{
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "the operation");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    assert(size > 0);
+    const ipm_memory_hint kind = hint & ~(unsigned)IPM_MEMORY_HINT_SHARED;
+    assert(kind <= IPM_MEMORY_HINT_PAGE_OUT);
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    const size_t begin = offset & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const size_t end = round_size(offset + size);
+    res = shared_memory_block_advise(&memory->ctx, &memory->real_memory, begin, end - begin, kind, (hint & IPM_MEMORY_HINT_SHARED) != 0);
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(&memory->ctx, "Could not add memory claim to list, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        IPM_ERROR(&memory->ctx, "Advising about region [%zu, %zu) of block \"%s\" failed, reason: %s (%s)", begin, end, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
+
+ipm_result ipm_memory_transfer(
+        ipm_memory* src, size_t src_offset, ipm_memory* dst, size_t dst_offset, size_t size)
+{
+    assert(size > 0);
+    if (src->real_memory.size < src_offset + size)
+    {
+        IPM_ERROR(&src->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", src->real_memory.size, src_offset, src_offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (dst->real_memory.size < dst_offset + size)
+    {
+        IPM_ERROR(&dst->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", dst->real_memory.size, dst_offset, dst_offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (dst->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&dst->ctx, "Memory block \"%s\" is not writable", dst->block_name);
+        return atomic_load(&dst->real_memory.header->sealed) ? IPM_RESULT_ERR_SEALED : IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (shared_memory_block_is_protected(&dst->real_memory, dst_offset, size))
+    {
+        //  Copying through the mapping would fault, while the kernel would write to memory the caller made read-only
+        IPM_ERROR(&dst->ctx, "Region [%zu, %zu) of block \"%s\" overlaps a range protected for read-only access", dst_offset, dst_offset + size, dst->block_name);
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if ((src_offset < dst_offset + size && dst_offset < src_offset + size) && shared_memory_block_same_object(&src->real_memory, &dst->real_memory))
+    {
+        IPM_ERROR(&dst->ctx, "Regions [%zu, %zu) and [%zu, %zu) of block \"%s\" overlap", src_offset, src_offset + size, dst_offset, dst_offset + size, dst->block_name);
+        return IPM_RESULT_ERR_BAD_VALUE;
     }
-    *p_claim_id = claim.claim_id;
 
+    //  Only pages which are aligned in both blocks can be moved without copying, the rest is copied through the mappings
+    size_t head = 0;
+    size_t middle = 0;
+    if ((src_offset & IPM_MEMORY_PAGE_SIZE_MASK) == (dst_offset & IPM_MEMORY_PAGE_SIZE_MASK))
+    {
+        head = round_size(src_offset) - src_offset;
+        if (head > size)
+        {
+            head = size;
+        }
+        middle = (size - head) & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    }
+    const ipm_bool mapped = src->windows == NULL && dst->windows == NULL;
+    if (!mapped)
+    {
+        //  Windowed handles do not map the whole block, so all of the range is left to the kernel
+        head = 0;
+        middle = size;
+    }
+    if (middle)
+    {
+        const ipm_result res = shared_memory_block_copy_range(&dst->ctx, &src->real_memory, src_offset + head, &dst->real_memory, dst_offset + head, middle);
+        if (res == IPM_RESULT_ERR_NOT_SUPPORTED && mapped)
+        {
+            //  Filesystem can not copy it, so it is copied through the mappings
+            head = 0;
+            middle = 0;
+        }
+        else if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&dst->ctx, "Could not transfer %zu bytes from block \"%s\" to block \"%s\", reason: %s (%s)", middle, src->block_name, dst->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+    if (mapped)
+    {
+        const uint8_t* const src_ptr = (const uint8_t*)src->real_memory.memory + src_offset;
+        uint8_t* const dst_ptr = (uint8_t*)dst->real_memory.memory + dst_offset;
+        memcpy(dst_ptr, src_ptr, head);
+        memcpy(dst_ptr + head + middle, src_ptr + head + middle, size - head - middle);
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+int ipm_memory_needs_sync(const ipm_memory* memory)
+{
+    return memory->real_memory.generation != atomic_load(&memory->real_memory.header->generation);
+}
+
+ipm_result ipm_memory_change_access(ipm_memory* memory, ipm_access_mode access_mode)
+{
+    if (access_mode == IPM_ACCESS_MODE_READ_WRITE && atomic_load(&memory->real_memory.header->sealed))
+    {
+        IPM_ERROR(&memory->ctx, "Memory block \"%s\" was sealed and can not be made writable", memory->block_name);
+        return IPM_RESULT_ERR_SEALED;
+    }
+    ipm_result res = shared_memory_block_update_mapping(&memory->ctx, &memory->real_memory, access_mode);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Memory access change for block \"%s\" failed, reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    internal_ipm_memory_windows_update(memory);
     return res;
 }
 
-ipm_result ipm_memory_release_region(ipm_memory* memory, ipm_id claim_id)
+ipm_result ipm_memory_protect_range(ipm_memory* memory, size_t offset, size_t size, ipm_access_mode access)
 {
-    //  Lock access list
-    ipm_claim_list* const list = memory->active_claims.memory;
-    assert(list);
-    ipm_result res = ipm_mutex_lock(&list->list_mutex);
+    assert(access == IPM_ACCESS_MODE_READ_WRITE || access == IPM_ACCESS_MODE_READ_ONLY);
+    assert(size > 0);
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "the operation");
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(&memory->ctx, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res),
-                  ipm_result_to_msg(res));
         return res;
     }
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (memory->real_memory.access_mode == IPM_ACCESS_MODE_READ_ONLY)
+    {
+        if (access == IPM_ACCESS_MODE_READ_ONLY)
+        {
+            //  Whole block is already read-only
+            return IPM_RESULT_SUCCESS;
+        }
+        IPM_ERROR(&memory->ctx, "Memory block was opened as read-only, so its regions can not be made writable");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (access == IPM_ACCESS_MODE_READ_WRITE && atomic_load(&memory->real_memory.header->sealed))
+    {
+        IPM_ERROR(&memory->ctx, "Memory block \"%s\" was sealed and can not be made writable", memory->block_name);
+        return IPM_RESULT_ERR_SEALED;
+    }
+    const size_t begin = offset & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const size_t end = round_size(offset + size);
+    res = shared_memory_block_protect_range(&memory->ctx, &memory->real_memory, begin, end - begin, access);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Changing protection of region [%zu, %zu) of block \"%s\" failed, reason: %s (%s)", begin, end, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
 
-    //  Check if there are any conflicting claims currently active
-    res = claim_remove_from_list(claim_id, list);
-    ipm_mutex_unlock(&list->list_mutex);
+ipm_result ipm_memory_seal(ipm_memory* memory)
+{
+    if (memory->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block was opened as read-only, so it can not be sealed");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+
+    //  Claim list stays locked while the flag is set, so no write claim can be made in between
+    ipm_result res = acquire_memory_block_whole(&memory->ctx, &memory->real_memory);
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(&memory->ctx, "Could not add memory claim to list, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        IPM_ERROR(&memory->ctx, "Could not lock the memory segment, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
     }
-    else
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    res = ipm_mutex_lock(&list->list_mutex);
+    if (res != IPM_RESULT_SUCCESS)
     {
-        //  Signal that a claim was removed from the list, so threads should check if they can now add any of their claims
-        ipm_condition_signal(&list->list_cnd);
+        IPM_ERROR(&memory->ctx, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        release_memory_block_whole(&memory->ctx, &memory->real_memory);
+        return res;
+    }
+    for (unsigned i = 0; i < list->count; ++i)
+    {
+        const ipm_memory_claim* const claim = list->claims + i;
+        if (claim->access == IPM_ACCESS_MODE_READ_WRITE)
+        {
+            IPM_ERROR(&memory->ctx, "Can not seal the memory block, since region [%zu, %zu) is claimed for writing", claim->offset, claim->offset + claim->size);
+            res = IPM_RESULT_ERR_REGION_CLAIMED;
+            break;
+        }
+    }
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        res = shared_memory_block_seal(&memory->ctx, &memory->real_memory);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Sealing block \"%s\" failed, reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+        }
+    }
+    ipm_mutex_unlock(&list->list_mutex);
+    release_memory_block_whole(&memory->ctx, &memory->real_memory);
+    internal_ipm_memory_windows_update(memory);
+    return res;
+}
+
+int ipm_memory_is_sealed(const ipm_memory* memory)
+{
+    return atomic_load(&memory->real_memory.header->sealed) != 0;
+}
+
+unsigned ipm_memory_ref_count(const ipm_memory* memory)
+{
+    return memory->real_memory.header->refcount;
+}
+
+ipm_result internal_ipm_memory_claim(
+        ipm_memory* memory, ipm_access_mode access, size_t offset, size_t count, const void* region, ipm_id* p_claim_id)
+{
+    assert(access == IPM_ACCESS_MODE_READ_WRITE || access == IPM_ACCESS_MODE_READ_ONLY);
+    assert(count > 0);
+    assert(p_claim_id);
+    if (atomic_load(&memory->real_memory.header->sealed))
+    {
+        if (access == IPM_ACCESS_MODE_READ_WRITE)
+        {
+            IPM_ERROR(&memory->ctx, "Memory block \"%s\" was sealed and can not be claimed for writing", memory->block_name);
+            return IPM_RESULT_ERR_SEALED;
+        }
+        //  There can be no writers to a sealed block, so reading it does not need to go through the list
+        *p_claim_id = IPM_SEALED_CLAIM_ID;
+        return IPM_RESULT_SUCCESS;
+    }
+
+    if (memory->real_memory.access_mode == IPM_ACCESS_MODE_READ_ONLY && access == IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block was opened as read-only and can not be claimed for read only access");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (memory->real_memory.size < offset + count)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) can not be claimed", memory->real_memory.size, offset, offset + count);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+
+    //  Size in the header is checked as well, in case the block was shrunk by another process
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    assert(list);
+    ipm_result res = claim_list_acquire(
+            &memory->ctx, list, access, offset, count, memory->real_memory.access_id,
+            &memory->real_memory.header->block_size, p_claim_id);
+    if (res == IPM_RESULT_SUCCESS && access == IPM_ACCESS_MODE_READ_WRITE && atomic_load(&memory->real_memory.header->sealed))
+    {
+        //  Block was sealed while the claim was waiting, which is only seen once it is in the list
+        (void)claim_list_release(&memory->ctx, list, *p_claim_id, NULL);
+        IPM_ERROR(&memory->ctx, "Memory block \"%s\" was sealed and can not be claimed for writing", memory->block_name);
+        return IPM_RESULT_ERR_SEALED;
+    }
+    if (res == IPM_RESULT_SUCCESS && access == IPM_ACCESS_MODE_READ_WRITE && (memory->snapshot_id != 0 || atomic_load(&memory->real_memory.header->snapshot_id) != 0))
+    {
+        //  A snapshot is being taken, so contents of the region must be preserved before they can be modified
+        internal_ipm_snapshot_preserve(memory, region, offset, count);
     }
 
     return res;
 }
 
-ipm_result ipm_memory_release_all(ipm_memory* memory)
+ipm_result ipm_memory_claim_region(ipm_memory* memory, ipm_access_mode access, size_t offset, size_t count, ipm_id* p_claim_id)
 {
-    ipm_claim_list* const list = memory->active_claims.memory;
-    ipm_result res = ipm_mutex_lock(&list->list_mutex);
-    if (res != IPM_RESULT_SUCCESS)
+    if (memory->windows)
     {
-        IPM_ERROR(&memory->ctx, "Could not lock the claim list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
-        return res;
+        IPM_ERROR(&memory->ctx, "Regions of a windowed handle are claimed with ipm_memory_claim_window");
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
     }
+    return internal_ipm_memory_claim(memory, access, offset, count, (uint8_t*)memory->real_memory.memory + offset, p_claim_id);
+}
 
-    for (int i = 0; i < (int)list->count; ++i)
+ipm_result ipm_memory_release_region(ipm_memory* memory, ipm_id claim_id)
+{
+    if (claim_id == IPM_SEALED_CLAIM_ID)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    assert(list);
+    ipm_memory_claim released;
+    const ipm_result res = claim_list_release(&memory->ctx, list, claim_id, &released);
+    if (res == IPM_RESULT_SUCCESS)
     {
-        if (list->claims[i].proc_id == memory->real_memory.access_id)
+        if (released.proc_id == memory->real_memory.access_id)
         {
-            (void)claim_remove_from_list(list->claims[i].claim_id, list);
-            i -= 1;
+            //  Claims of a windowed handle all pin their window, however they are released
+            internal_ipm_memory_windows_unpin(memory, released.offset, released.size);
         }
+        (void)internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_RELEASED, released.offset, released.size);
     }
+    return res;
+}
 
-    ipm_mutex_unlock(&list->list_mutex);
+ipm_result ipm_memory_release_all(ipm_memory* memory)
+{
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    internal_ipm_memory_windows_unpin_all(memory);
+    ipm_bool released = 0;
+    const ipm_result res = claim_list_release_all(&memory->ctx, list, memory->real_memory.access_id, &released);
+    if (released)
+    {
+        (void)internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_RELEASED, 0, SIZE_MAX);
+    }
     return res;
 }
 
@@ -333,24 +766,155 @@ void* ipm_memory_pointer(ipm_memory* memory)
 
 ipm_result ipm_memory_remove_all_active_claims(ipm_memory* memory)
 {
-    ipm_claim_list* const list = memory->active_claims.memory;
-    ipm_result res = ipm_mutex_lock(&list->list_mutex);
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    internal_ipm_memory_windows_unpin_all(memory);
+    //  Access IDs are never zero, so this matches the claims of all handles
+    ipm_bool released = 0;
+    const ipm_result res = claim_list_release_all(&memory->ctx, list, 0, &released);
+    if (released)
+    {
+        (void)internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_RELEASED, 0, SIZE_MAX);
+    }
+    return res;
+}
+
+ipm_result ipm_memory_flush(ipm_memory* memory, size_t offset, size_t size)
+{
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "the operation");
     if (res != IPM_RESULT_SUCCESS)
     {
-        IPM_ERROR(&memory->ctx, "Could not lock the claim list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
         return res;
     }
+    assert(size > 0);
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    const size_t begin = offset & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const size_t end = round_size(offset + size);
+    res = shared_memory_block_flush(&memory->ctx, &memory->real_memory, begin, end - begin);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Flushing region [%zu, %zu) of block \"%s\" failed, reason: %s (%s)", begin, end, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
 
-    while (list->count)
+ipm_result ipm_memory_set_numa_policy(ipm_memory* memory, ipm_numa_policy policy, uint64_t node_mask)
+{
+    assert(policy >= IPM_NUMA_POLICY_DEFAULT && policy <= IPM_NUMA_POLICY_PREFERRED);
+    const ipm_result res = shared_memory_block_set_numa_policy(&memory->ctx, &memory->real_memory, policy, node_mask);
+    if (res != IPM_RESULT_SUCCESS)
     {
-        (void)claim_remove_from_list(list->claims[list->count - 1].claim_id, list);
+        IPM_ERROR(&memory->ctx, "Setting NUMA policy for block \"%s\" failed, reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
     }
+    return res;
+}
 
-    ipm_mutex_unlock(&list->list_mutex);
+ipm_result ipm_memory_set_numa_policy_range(
+        ipm_memory* memory, size_t offset, size_t size, ipm_numa_policy policy, uint64_t node_mask)
+{
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "the operation");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    assert(policy >= IPM_NUMA_POLICY_DEFAULT && policy <= IPM_NUMA_POLICY_PREFERRED);
+    assert(size > 0);
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    const size_t begin = offset & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const size_t end = round_size(offset + size);
+    res = ipm_numa_bind((uint8_t*)memory->real_memory.memory + begin, end - begin, policy, node_mask, 1);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Setting NUMA policy for region [%zu, %zu) of block \"%s\" failed, reason: %s (%s)", begin, end, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
+
+ipm_result ipm_memory_numa_residency(
+        ipm_memory* memory, size_t offset, size_t size, unsigned node_count, size_t* p_pages_per_node,
+        size_t* p_not_resident)
+{
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "the operation");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    assert(size > 0);
+    assert(p_pages_per_node || node_count == 0);
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    const size_t begin = offset & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const size_t end = round_size(offset + size);
+    res = ipm_numa_residency((uint8_t*)memory->real_memory.memory + begin, end - begin, node_count, p_pages_per_node, p_not_resident);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Querying NUMA residency for region [%zu, %zu) of block \"%s\" failed, reason: %s (%s)", begin, end, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
     return res;
 }
 
+static ipm_result check_futex_word(ipm_memory* memory, size_t offset)
+{
+    ipm_result res = internal_ipm_memory_check_whole_mapping(memory, "the operation");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (offset % sizeof(uint32_t) != 0)
+    {
+        IPM_ERROR(&memory->ctx, "Offset %zu is not aligned to %zu bytes", offset, sizeof(uint32_t));
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (memory->real_memory.size < offset + sizeof(uint32_t))
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + sizeof(uint32_t));
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_memory_wait(ipm_memory* memory, size_t offset, uint32_t expected, unsigned timeout_ms)
+{
+    const ipm_result res = check_futex_word(memory, offset);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return ipm_futex_wait((uint32_t*)((uint8_t*)memory->real_memory.memory + offset), expected, timeout_ms);
+}
+
+ipm_result ipm_memory_notify(ipm_memory* memory, size_t offset, unsigned count)
+{
+    const ipm_result res = check_futex_word(memory, offset);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    ipm_futex_wake((uint32_t*)((uint8_t*)memory->real_memory.memory + offset), count);
+    return IPM_RESULT_SUCCESS;
+}
+
 ipm_claim_list* internal_ipm_memory_clam_list(ipm_memory* memory)
 {
-    return memory->active_claims.memory;
+    return memory->real_memory.metadata;
+}
+
+ipm_result internal_ipm_memory_check_whole_mapping(const ipm_memory* memory, const char* what)
+{
+    if (memory->windows)
+    {
+        IPM_ERROR(&memory->ctx, "Handle maps block \"%s\" in windows, but %s needs the whole block to be mapped", memory->block_name, what);
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    }
+    return IPM_RESULT_SUCCESS;
 }
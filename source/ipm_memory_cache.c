@@ -0,0 +1,144 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_memory_internal.h"
+
+enum
+{
+    IPM_MEMORY_CACHE_BUCKETS = 64,
+};
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static ipm_memory* cache_buckets[IPM_MEMORY_CACHE_BUCKETS];
+
+static void cache_fork_prepare(void)
+{
+    pthread_mutex_lock(&cache_mutex);
+}
+
+static void cache_fork_parent(void)
+{
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+static void cache_fork_child(void)
+{
+    //  Handles of the parent should be cleaned by the child, so they are not handed out again. Each is cleaned with a
+    //  single call, no matter how many times the parent opened it, so only that one reference is left.
+    for (unsigned i = 0; i < IPM_MEMORY_CACHE_BUCKETS; ++i)
+    {
+        for (ipm_memory* memory = cache_buckets[i]; memory; memory = memory->cache_next)
+        {
+            memory->cache_refs = 1;
+        }
+    }
+    memset(cache_buckets, 0, sizeof(cache_buckets));
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+static void cache_register_fork_handlers(void)
+{
+    (void)pthread_atfork(cache_fork_prepare, cache_fork_parent, cache_fork_child);
+}
+
+static inline ipm_memory** cache_bucket(const char* block_name, ipm_access_mode access)
+{
+    return cache_buckets + (ipm_hash_name(block_name) + access) % IPM_MEMORY_CACHE_BUCKETS;
+}
+
+static ipm_memory* cache_find(ipm_memory* const* bucket, const char* block_name, ipm_access_mode access)
+{
+    //  Cache must be locked by the caller
+    for (ipm_memory* memory = *bucket; memory; memory = memory->cache_next)
+    {
+        if (memory->cache_access == access && strcmp(memory->block_name, block_name) == 0)
+        {
+            return memory;
+        }
+    }
+    return NULL;
+}
+
+ipm_result ipm_memory_open_cached(
+        const ipm_context* context, const char* block_name, ipm_access_mode access, ipm_memory** p_memory)
+{
+    assert(context);
+    assert(strchr(block_name, '/') == NULL);
+    assert(access == IPM_ACCESS_MODE_READ_ONLY || access == IPM_ACCESS_MODE_READ_WRITE);
+    assert(p_memory);
+    (void)pthread_once(&cache_once, cache_register_fork_handlers);
+    ipm_memory** const bucket = cache_bucket(block_name, access);
+
+    pthread_mutex_lock(&cache_mutex);
+    ipm_memory* memory = cache_find(bucket, block_name, access);
+    if (memory)
+    {
+        memory->cache_refs += 1;
+        pthread_mutex_unlock(&cache_mutex);
+        *p_memory = memory;
+        return IPM_RESULT_SUCCESS;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    //  Cache is not locked while the block is opened, since that may wait for its creator
+    ipm_memory* opened;
+    const ipm_result res = ipm_memory_open(context, block_name, access, &opened);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    memory = cache_find(bucket, block_name, access);
+    if (memory)
+    {
+        //  Another thread opened the block in the meantime
+        memory->cache_refs += 1;
+    }
+    else
+    {
+        memory = opened;
+        memory->is_cached = 1;
+        memory->cache_refs = 1;
+        memory->cache_access = access;
+        memory->cache_next = *bucket;
+        *bucket = memory;
+        opened = NULL;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    if (opened)
+    {
+        ipm_memory_close(opened);
+    }
+
+    *p_memory = memory;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_bool internal_ipm_memory_cache_release(ipm_memory* memory)
+{
+    if (!memory->is_cached)
+    {
+        //  Handle was not opened through the cache
+        return 1;
+    }
+    pthread_mutex_lock(&cache_mutex);
+    memory->cache_refs -= 1;
+    const ipm_bool last = memory->cache_refs == 0;
+    if (last)
+    {
+        //  Handle may be missing from the cache, if it was inherited through a fork
+        for (ipm_memory** p = cache_bucket(memory->block_name, memory->cache_access); *p; p = &(*p)->cache_next)
+        {
+            if (*p == memory)
+            {
+                *p = memory->cache_next;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return last;
+}
@@ -0,0 +1,233 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_memory_internal.h"
+
+enum
+{
+    EVENT_STATE_EVENT_BITS = 8,
+    EVENT_STATE_EVENT_MASK = (1 << EVENT_STATE_EVENT_BITS) - 1,
+    EVENT_STATE_SERIAL_MASK = (1 << 24) - 1,
+    EVENT_NAME_ATTEMPTS = 16,       //  Names tried before giving up, in case one is still bound by an earlier socket
+};
+
+//  Tells apart the sockets of the same process, which may watch many blocks, or the same one through several handles
+static _Atomic uint32_t event_serial = 0;
+
+static inline uint64_t watcher_name(uint64_t state)
+{
+    return state & ~(uint64_t)EVENT_STATE_EVENT_MASK;
+}
+
+static inline unsigned watcher_lock_byte(unsigned slot)
+{
+    return IPM_SHARED_MEMORY_LOCK_WATCHERS + slot;
+}
+
+static void watcher_remove(ipm_shared_memory_header* header, unsigned slot, uint64_t state)
+{
+    //  Only the one who removes the watcher changes the count, in case another process removes it at the same time
+    if (atomic_compare_exchange_strong(&header->watchers[slot].state, &state, 0))
+    {
+        atomic_fetch_sub(&header->watcher_count, 1);
+    }
+}
+
+static ipm_bool watcher_is_alive(const ipm_memory* memory, unsigned slot)
+{
+    //  Handle sharing the lock with this one can not be tested, but it is alive as long as this one is
+    return memory->real_memory.header->watchers[slot].access_id == memory->real_memory.access_id ||
+           shared_memory_block_byte_is_locked(&memory->real_memory, watcher_lock_byte(slot));
+}
+
+static ipm_result watcher_add(ipm_memory* memory, uint64_t name, unsigned events, size_t offset, size_t size)
+{
+    ipm_shared_memory_header* const header = memory->real_memory.header;
+    for (unsigned i = 0; i < IPM_SHARED_MEMORY_MAX_WATCHERS; ++i)
+    {
+        ipm_shared_memory_watcher* const watcher = header->watchers + i;
+        uint64_t expected = 0;
+        //  Watcher with no events is reserved, but not yet reported to
+        if (!atomic_compare_exchange_strong(&watcher->state, &expected, name))
+        {
+            continue;
+        }
+        //  Byte stays locked while the handle is open, so that senders only remove the watcher once it is not
+        if (!shared_memory_block_lock_byte(&memory->real_memory, watcher_lock_byte(i)))
+        {
+            //  Earlier watcher of the slot is still between unlocking the byte and removing itself
+            atomic_store(&watcher->state, 0);
+            continue;
+        }
+        watcher->pending = 0;
+        watcher->access_id = memory->real_memory.access_id;
+        watcher->offset = offset;
+        watcher->size = size;
+        atomic_fetch_add(&header->watcher_count, 1);
+        atomic_store(&watcher->state, name | events);
+        memory->event_slot = i;
+        memory->event_state = name | events;
+        return IPM_RESULT_SUCCESS;
+    }
+    IPM_ERROR(&memory->ctx, "Block \"%s\" is already watched by %u handles", memory->block_name, (unsigned)IPM_SHARED_MEMORY_MAX_WATCHERS);
+    return IPM_RESULT_ERR_FULL;
+}
+
+static void watcher_unlock_and_remove(ipm_memory* memory)
+{
+    //  Byte is unlocked first, so that a handle which finds the slot free can always lock it. Should a sender remove the
+    //  watcher in between, only one of the two removes it.
+    shared_memory_block_unlock_byte(&memory->real_memory, watcher_lock_byte(memory->event_slot));
+    watcher_remove(memory->real_memory.header, memory->event_slot, memory->event_state);
+}
+
+ipm_result ipm_memory_watch(ipm_memory* memory, unsigned events, size_t offset, size_t size, int* p_fd)
+{
+    assert(events != 0 && (events & ~(unsigned)IPM_MEMORY_EVENT_ALL) == 0);
+    ipm_shared_memory_header* const header = memory->real_memory.header;
+    ipm_result res;
+    if (memory->event_fd >= 0)
+    {
+        //  Handle already watches the block, so only what it watches changes
+        ipm_shared_memory_watcher* const watcher = header->watchers + memory->event_slot;
+        const uint64_t name = watcher_name(memory->event_state);
+        uint64_t expected = memory->event_state;
+        if (atomic_compare_exchange_strong(&watcher->state, &expected, name | events))
+        {
+            watcher->offset = offset;
+            watcher->size = size;
+            memory->event_state = name | events;
+            *p_fd = memory->event_fd;
+            return IPM_RESULT_SUCCESS;
+        }
+        //  Watcher was removed, so it is added again with the same socket, in whichever slot is free
+        shared_memory_block_unlock_byte(&memory->real_memory, watcher_lock_byte(memory->event_slot));
+        res = watcher_add(memory, name, events, offset, size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            ipm_event_socket_close(memory->event_fd);
+            memory->event_fd = -1;
+            return res;
+        }
+        *p_fd = memory->event_fd;
+        return IPM_RESULT_SUCCESS;
+    }
+
+    //  Socket is bound before the watcher is added, so that whoever finds the watcher can also send to it
+    res = IPM_RESULT_ERR_EXISTS;
+    uint64_t name = 0;
+    int fd = -1;
+    for (unsigned i = 0; i < EVENT_NAME_ATTEMPTS && res == IPM_RESULT_ERR_EXISTS; ++i)
+    {
+        const uint32_t serial = (atomic_fetch_add(&event_serial, 1) & EVENT_STATE_SERIAL_MASK) + 1;
+        name = (uint64_t)ipm_process_id() << 32 | (uint64_t)serial << EVENT_STATE_EVENT_BITS;
+        res = ipm_event_socket_open(name, &fd);
+    }
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not create a socket for events of block \"%s\", reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    res = watcher_add(memory, name, events, offset, size);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        ipm_event_socket_close(fd);
+        return res;
+    }
+    memory->event_fd = fd;
+    *p_fd = fd;
+    return IPM_RESULT_SUCCESS;
+}
+
+void ipm_memory_unwatch(ipm_memory* memory)
+{
+    internal_ipm_memory_events_close(memory, 1);
+}
+
+unsigned ipm_memory_take_events(ipm_memory* memory)
+{
+    if (memory->event_fd < 0)
+    {
+        return 0;
+    }
+    //  Socket is drained first, so that events sent after the pending ones are taken make it readable again
+    const uint32_t received = ipm_event_socket_drain(memory->event_fd);
+    ipm_shared_memory_watcher* const watcher = memory->real_memory.header->watchers + memory->event_slot;
+    return (received | atomic_exchange(&watcher->pending, 0)) & EVENT_STATE_EVENT_MASK;
+}
+
+ipm_result ipm_memory_ring_doorbell(ipm_memory* memory)
+{
+    return internal_ipm_memory_events_post(memory, IPM_MEMORY_EVENT_DOORBELL, 0, SIZE_MAX);
+}
+
+ipm_result internal_ipm_memory_events_post(ipm_memory* memory, uint32_t events, size_t offset, size_t size)
+{
+    ipm_shared_memory_header* const header = memory->real_memory.header;
+    if (atomic_load_explicit((_Atomic uint32_t*)&header->watcher_count, memory_order_relaxed) == 0)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    ipm_result res;
+    if (memory->event_sender_fd < 0)
+    {
+        res = ipm_event_socket_sender(&memory->event_sender_fd);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not create a socket for sending events of block \"%s\", reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+            memory->event_sender_fd = -1;
+            return res;
+        }
+    }
+    res = IPM_RESULT_SUCCESS;
+    for (unsigned i = 0; i < IPM_SHARED_MEMORY_MAX_WATCHERS; ++i)
+    {
+        ipm_shared_memory_watcher* const watcher = header->watchers + i;
+        const uint64_t state = atomic_load(&watcher->state);
+        uint32_t matched = (uint32_t)state & events;
+        if ((matched & IPM_MEMORY_EVENT_RELEASED) && watcher->size != 0 &&
+            (offset >= watcher->offset + watcher->size || watcher->offset >= offset + (size < SIZE_MAX - offset ? size : SIZE_MAX - offset)))
+        {
+            matched &= ~(uint32_t)IPM_MEMORY_EVENT_RELEASED;
+        }
+        if (!matched)
+        {
+            continue;
+        }
+        atomic_fetch_or(&watcher->pending, matched);
+        const ipm_result send_res = ipm_event_socket_send(memory->event_sender_fd, watcher_name(state), matched);
+        if (send_res == IPM_RESULT_ERR_DOES_NOT_EXIST)
+        {
+            //  Socket can also be out of reach when the watcher is in another network namespace, so the watcher is only
+            //  removed once its handle is no longer open, which means its process exited without removing it
+            if (!watcher_is_alive(memory, i))
+            {
+                watcher_remove(header, i, state);
+            }
+        }
+        else if (send_res != IPM_RESULT_SUCCESS)
+        {
+            res = send_res;
+        }
+    }
+    return res;
+}
+
+void internal_ipm_memory_events_close(ipm_memory* memory, ipm_bool unwatch)
+{
+    if (memory->event_fd >= 0)
+    {
+        if (unwatch)
+        {
+            watcher_unlock_and_remove(memory);
+        }
+        ipm_event_socket_close(memory->event_fd);
+        memory->event_fd = -1;
+    }
+    if (memory->event_sender_fd >= 0)
+    {
+        ipm_event_socket_close(memory->event_sender_fd);
+        memory->event_sender_fd = -1;
+    }
+}
@@ -0,0 +1,191 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_memory_internal.h"
+#include "ipm_platform.h"
+#include <inttypes.h>
+
+struct file_chunk_T
+{
+    ipm_memory* memory;
+    int fd;
+    off_t file_offset;
+    size_t block_offset;
+    size_t size;
+    ipm_result result;
+};
+typedef struct file_chunk_T file_chunk;
+
+static ipm_result check_file_range(ipm_memory* memory, uint64_t file_offset, size_t offset, size_t size, ipm_bool load)
+{
+    assert(size > 0);
+    if (file_offset > (uint64_t)INT64_MAX - size)
+    {
+        IPM_ERROR(&memory->ctx, "File region [%"PRIu64", %"PRIu64" + %zu) is past the largest file offset", file_offset, file_offset, size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (load && memory->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block \"%s\" is not writable", memory->block_name);
+        return atomic_load(&memory->real_memory.header->sealed) ? IPM_RESULT_ERR_SEALED : IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (load && shared_memory_block_is_protected(&memory->real_memory, offset, size))
+    {
+        //  Copying through the mapping would fault, while the kernel would write to memory the caller made read-only
+        IPM_ERROR(&memory->ctx, "Region [%zu, %zu) of block \"%s\" overlaps a range protected for read-only access", offset, offset + size, memory->block_name);
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_result copy_through_mapping(ipm_memory* memory, int fd, off_t file_offset, size_t offset, size_t size, ipm_bool load)
+{
+    if (memory->windows)
+    {
+        IPM_ERROR(&memory->ctx, "File can not be copied by the kernel, and a windowed handle has no mapping to copy it through");
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    }
+    //  Still only one copy, since the kernel copies straight between its page cache and the block's mapping
+    uint8_t* ptr = (uint8_t*)memory->real_memory.memory + offset;
+    while (size > 0)
+    {
+        const ssize_t done = load ? pread(fd, ptr, size, file_offset) : pwrite(fd, ptr, size, file_offset);
+        if (done <= 0)
+        {
+            if (done < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (done == 0)
+            {
+                IPM_ERROR(&memory->ctx, "File ended before the region was copied");
+                return IPM_RESULT_ERR_BAD_SIZE;
+            }
+            IPM_ERROR(&memory->ctx, "Could not copy between the file and the block, reason: %s", strerror(errno));
+            return errno == EBADF ? IPM_RESULT_ERR_ACCESS : IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+        ptr += done;
+        file_offset += done;
+        size -= (size_t)done;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_result copy_file(ipm_memory* memory, int fd, off_t file_offset, size_t offset, size_t size, ipm_bool load)
+{
+    ipm_result res = shared_memory_block_copy_file(&memory->ctx, &memory->real_memory, offset, fd, file_offset, size, !load);
+    if (res == IPM_RESULT_ERR_NOT_SUPPORTED)
+    {
+        res = copy_through_mapping(memory, fd, file_offset, offset, size, load);
+    }
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not %s region [%zu, %zu) of block \"%s\", reason: %s (%s)", load ? "load" : "dump", offset, offset + size, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
+
+static void* load_chunk(void* param)
+{
+    file_chunk* const chunk = param;
+    chunk->result = copy_file(chunk->memory, chunk->fd, chunk->file_offset, chunk->block_offset, chunk->size, 1);
+    return NULL;
+}
+
+ipm_result ipm_memory_load_file(ipm_memory* memory, int fd, uint64_t file_offset, size_t offset, size_t size)
+{
+    const ipm_result res = check_file_range(memory, file_offset, offset, size, 1);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return copy_file(memory, fd, (off_t)file_offset, offset, size, 1);
+}
+
+ipm_result ipm_memory_load_file_parallel(
+        ipm_memory* memory, int fd, uint64_t file_offset, size_t offset, size_t size, unsigned thread_count)
+{
+    assert(thread_count > 0);
+    ipm_result res = check_file_range(memory, file_offset, offset, size, 1);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    //  Chunks end on pages of the block, so that no two threads write to the same page of it even when the region does
+    //  not start on one. First chunk ends on the page after it would otherwise end, and the rest are whole pages.
+    const size_t end = offset + size;
+    size_t chunk_size = (size + thread_count - 1) / thread_count;
+    chunk_size = (chunk_size + IPM_MEMORY_PAGE_SIZE_MASK) & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const size_t first_end = (offset + chunk_size + IPM_MEMORY_PAGE_SIZE_MASK) & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+    const unsigned chunk_count = first_end >= end ? 1 : 1 + (unsigned)((end - first_end + chunk_size - 1) / chunk_size);
+    if (chunk_count == 1)
+    {
+        return copy_file(memory, fd, (off_t)file_offset, offset, size, 1);
+    }
+
+    file_chunk* const chunks = ipm_alloc(&memory->ctx, sizeof(*chunks) * chunk_count);
+    pthread_t* const threads = ipm_alloc(&memory->ctx, sizeof(*threads) * chunk_count);
+    if (!chunks || !threads)
+    {
+        ipm_free(&memory->ctx, threads);
+        ipm_free(&memory->ctx, chunks);
+        IPM_ERROR(&memory->ctx, "Could not allocate memory for %u chunks of the file", chunk_count);
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    unsigned started_count = 0;
+    for (unsigned i = 0; i < chunk_count; ++i)
+    {
+        const size_t chunk_begin = i == 0 ? offset : first_end + (i - 1) * chunk_size;
+        const size_t chunk_end = end - first_end < (size_t)i * chunk_size ? end : first_end + i * chunk_size;
+        chunks[i] = (file_chunk){
+                .memory = memory,
+                .fd = fd,
+                .file_offset = (off_t)(file_offset + (chunk_begin - offset)),
+                .block_offset = chunk_begin,
+                .size = chunk_end - chunk_begin,
+                .result = IPM_RESULT_SUCCESS,
+                };
+    }
+    //  First chunk is loaded by the calling thread, as are the chunks which a thread could not be started for
+    for (unsigned i = 1; i < chunk_count; ++i)
+    {
+        if (pthread_create(threads + started_count, NULL, load_chunk, chunks + i) != 0)
+        {
+            break;
+        }
+        started_count += 1;
+    }
+    for (unsigned i = started_count + 1; i < chunk_count; ++i)
+    {
+        load_chunk(chunks + i);
+    }
+    load_chunk(chunks + 0);
+    for (unsigned i = 0; i < started_count; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (unsigned i = 0; i < chunk_count && res == IPM_RESULT_SUCCESS; ++i)
+    {
+        res = chunks[i].result;
+    }
+    ipm_free(&memory->ctx, threads);
+    ipm_free(&memory->ctx, chunks);
+    return res;
+}
+
+ipm_result ipm_memory_dump_file(ipm_memory* memory, size_t offset, int fd, uint64_t file_offset, size_t size)
+{
+    const ipm_result res = check_file_range(memory, file_offset, offset, size, 0);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return copy_file(memory, fd, (off_t)file_offset, offset, size, 0);
+}
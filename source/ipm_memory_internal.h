@@ -9,24 +9,97 @@
 #include "memory_claim.h"
 #include "internal.h"
 
+struct ipm_memory_window_T
+{
+    void* base;                 //  Start of the window's mapping, or NULL if the window is not mapped
+    size_t offset;              //  Offset of the window from the start of the block's data
+    size_t size;
+    unsigned pins;              //  Number of claims made through the window, which keep it from being unmapped
+    uint64_t last_used;         //  Value of the handle's window clock when the window was last used
+};
+typedef struct ipm_memory_window_T ipm_memory_window;
+
 struct ipm_memory_T
 {
     ipm_context ctx;
     char block_name[IPM_MAX_NAME_LEN + 1];
-    ipm_shared_memory_block real_memory;
-    ipm_shared_memory_block active_claims;
+    ipm_shared_memory_block real_memory;        //  Block holding the memory, with the claim list as its metadata
 //    ipm_shared_memory_block queued_claims;
+    ipm_shared_memory_block snapshot_shadow;    //  Shadow of the snapshot being taken, opened by the first write claim
+    ipm_id snapshot_id;                         //  ID of the snapshot the shadow belongs to, or 0 if none is open
+    size_t snapshot_size;                       //  Size of the data copied by the snapshot the shadow belongs to
+    ipm_bool is_cached;                         //  Handle was opened through the cache, which never changes afterwards
+    unsigned cache_refs;                        //  Number of references to the handle from the cache, or 0 if uncached
+    ipm_access_mode cache_access;               //  Access the handle was opened with through the cache
+    ipm_memory* cache_next;                     //  Next handle in the same bucket of the cache
+    ipm_memory_window* windows;                 //  Windows of a windowed handle, or NULL if the whole block is mapped
+    unsigned window_capacity;                   //  Maximum number of windows mapped at the same time
+    uint64_t window_clock;                      //  Counts uses of the windows, so the least recently used is known
+    int event_fd;                               //  Socket which receives the watched events, or -1 if not watching
+    int event_sender_fd;                        //  Socket which sends events to watchers, or -1 if not yet needed
+    unsigned event_slot;                        //  Index of the handle's watcher in the block header
+    uint64_t event_state;                       //  State of the handle's watcher, as written to the block header
+};
+
+struct ipm_snapshot_T
+{
+    ipm_context ctx;
+    ipm_shared_memory_block shadow;
+    const void* data;
+    size_t size;
 };
 
 enum ipm_memory_block_T
 {
     IPM_MEMORY_BLOCK_REAL_MEMORY = 1,
-    IPM_MEMORY_BLOCK_ACTIVE_CALIMS = 2,
+//    IPM_MEMORY_BLOCK_ACTIVE_CALIMS = 2,   //  Claim list is now the metadata section of the memory block
 //    IPM_MEMORY_BLOCK_QUEUD_CLAIMS = 3,
+    IPM_MEMORY_BLOCK_SEGMENT = 3,
+    IPM_MEMORY_BLOCK_SNAPSHOT = 4,      //  Lowest bits of the ID of a snapshot shadow, the rest is the snapshot counter
 };
 typedef enum ipm_memory_block_T ipm_memory_block;
 
 IPM_INTERNAL_FUNCTION
 ipm_claim_list* internal_ipm_memory_clam_list(ipm_memory* memory);
 
+//  Grows the block without mapping the new size, so that it can be done while holding a mutex within the block. Mapping
+//  is updated by calling ipm_memory_sync once the mutex is unlocked.
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_memory_grow_unmapped(ipm_memory* memory, size_t new_size);
+
+//  Reports that what needs the block to be mapped, such as "a queue", is not supported by a handle mapping it in windows
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_memory_check_whole_mapping(const ipm_memory* memory, const char* what);
+
+IPM_INTERNAL_FUNCTION
+ipm_bool internal_ipm_memory_cache_release(ipm_memory* memory);
+
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_memory_claim(
+        ipm_memory* memory, ipm_access_mode access, size_t offset, size_t count, const void* region, ipm_id* p_claim_id);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_memory_windows_update(ipm_memory* memory);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_memory_windows_unpin(ipm_memory* memory, size_t offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_memory_windows_unpin_all(ipm_memory* memory);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_memory_windows_unmap(ipm_memory* memory);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_snapshot_preserve(ipm_memory* memory, const void* region, size_t offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_snapshot_drop_shadow(ipm_memory* memory);
+
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_memory_events_post(ipm_memory* memory, uint32_t events, size_t offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+void internal_ipm_memory_events_close(ipm_memory* memory, ipm_bool unwatch);
+
 #endif //IPM_MEMORY_INTERNAL_H
@@ -0,0 +1,197 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_memory_internal.h"
+
+static ipm_memory_window* window_containing(ipm_memory* memory, size_t offset, size_t size)
+{
+    for (unsigned i = 0; i < memory->window_capacity; ++i)
+    {
+        ipm_memory_window* const window = memory->windows + i;
+        if (window->base && window->offset <= offset && offset + size <= window->offset + window->size)
+        {
+            return window;
+        }
+    }
+    return NULL;
+}
+
+static ipm_result window_acquire(ipm_memory* memory, size_t offset, size_t size, ipm_bool pin, void** p_ptr)
+{
+    if (memory->real_memory.size < offset + size)
+    {
+        IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+
+    ipm_memory_window* window = window_containing(memory, offset, size);
+    if (!window)
+    {
+        //  Window is unused, or it is the least recently used one which is not pinned by a claim
+        for (unsigned i = 0; i < memory->window_capacity; ++i)
+        {
+            ipm_memory_window* const candidate = memory->windows + i;
+            if (!candidate->base)
+            {
+                window = candidate;
+                break;
+            }
+            if (candidate->pins == 0 && (!window || candidate->last_used < window->last_used))
+            {
+                window = candidate;
+            }
+        }
+        if (!window)
+        {
+            IPM_ERROR(&memory->ctx, "All %u windows of block \"%s\" are used by claims", memory->window_capacity, memory->block_name);
+            return IPM_RESULT_ERR_NO_FREE_WINDOW;
+        }
+        if (window->base)
+        {
+            shared_memory_block_unmap_window(window->base, window->size);
+            window->base = NULL;
+        }
+
+        //  Windows are made larger than needed, so that nearby regions are likely to fall into the same one
+        const size_t begin = offset & ~((size_t)IPM_MEMORY_WINDOW_GRANULARITY - 1);
+        size_t end = (offset + size + IPM_MEMORY_WINDOW_GRANULARITY - 1) & ~((size_t)IPM_MEMORY_WINDOW_GRANULARITY - 1);
+        if (end > memory->real_memory.size)
+        {
+            end = memory->real_memory.size;
+        }
+        void* base;
+        const ipm_result res = shared_memory_block_map_window(&memory->ctx, &memory->real_memory, begin, end - begin, &base);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not map a window of block \"%s\", reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+        window->base = base;
+        window->offset = begin;
+        window->size = end - begin;
+        window->pins = 0;
+    }
+
+    window->last_used = ++memory->window_clock;
+    window->pins += pin;
+    *p_ptr = (uint8_t*)window->base + (offset - window->offset);
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_memory_map_window(ipm_memory* memory, size_t offset, size_t size, void** p_ptr)
+{
+    assert(size > 0);
+    assert(p_ptr);
+    if (!memory->windows)
+    {
+        //  Whole block is mapped already
+        if (memory->real_memory.size < offset + size)
+        {
+            IPM_ERROR(&memory->ctx, "Memory block has the size of %zu, so region [%zu, %zu) is not in the block", memory->real_memory.size, offset, offset + size);
+            return IPM_RESULT_ERR_BAD_VALUE;
+        }
+        *p_ptr = (uint8_t*)memory->real_memory.memory + offset;
+        return IPM_RESULT_SUCCESS;
+    }
+    return window_acquire(memory, offset, size, 0, p_ptr);
+}
+
+ipm_result ipm_memory_claim_window(
+        ipm_memory* memory, ipm_access_mode access, size_t offset, size_t size, ipm_id* p_claim_id, void** p_ptr)
+{
+    assert(size > 0);
+    assert(p_claim_id);
+    assert(p_ptr);
+    if (!memory->windows)
+    {
+        const ipm_result res = ipm_memory_claim_region(memory, access, offset, size, p_claim_id);
+        if (res == IPM_RESULT_SUCCESS)
+        {
+            *p_ptr = (uint8_t*)memory->real_memory.memory + offset;
+        }
+        return res;
+    }
+
+    //  Window is pinned before the region is claimed, since the claim may need it to preserve the region for a snapshot
+    void* ptr;
+    ipm_result res = window_acquire(memory, offset, size, 1, &ptr);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_memory_claim(memory, access, offset, size, ptr, p_claim_id);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        window_containing(memory, offset, size)->pins -= 1;
+        return res;
+    }
+    *p_ptr = ptr;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_memory_release_window(ipm_memory* memory, ipm_id claim_id, const void* ptr)
+{
+    //  Window is unpinned by releasing the claim, which knows the region it was made for
+    (void)ptr;
+    return ipm_memory_release_region(memory, claim_id);
+}
+
+void internal_ipm_memory_windows_unpin(ipm_memory* memory, size_t offset, size_t size)
+{
+    if (!memory->windows)
+    {
+        return;
+    }
+    //  Pinned window is never unmapped, and no other is mapped for a region it contains, so it is the one found
+    ipm_memory_window* const window = window_containing(memory, offset, size);
+    assert(window && window->pins > 0);
+    window->pins -= 1;
+}
+
+void internal_ipm_memory_windows_update(ipm_memory* memory)
+{
+    //  Windows past the end of a shrunk block are dropped, while the rest get the current access of the handle
+    for (unsigned i = 0; i < memory->window_capacity; ++i)
+    {
+        ipm_memory_window* const window = memory->windows + i;
+        if (!window->base)
+        {
+            continue;
+        }
+        if (window->offset + window->size > memory->real_memory.size && window->pins == 0)
+        {
+            shared_memory_block_unmap_window(window->base, window->size);
+            window->base = NULL;
+            continue;
+        }
+        (void)shared_memory_block_protect_window(&memory->ctx, &memory->real_memory, window->base, window->size);
+    }
+}
+
+void internal_ipm_memory_windows_unpin_all(ipm_memory* memory)
+{
+    for (unsigned i = 0; i < memory->window_capacity; ++i)
+    {
+        memory->windows[i].pins = 0;
+    }
+}
+
+void internal_ipm_memory_windows_unmap(ipm_memory* memory)
+{
+    if (!memory->windows)
+    {
+        return;
+    }
+    for (unsigned i = 0; i < memory->window_capacity; ++i)
+    {
+        ipm_memory_window* const window = memory->windows + i;
+        if (window->base)
+        {
+            shared_memory_block_unmap_window(window->base, window->size);
+        }
+    }
+    ipm_free(&memory->ctx, memory->windows);
+    memory->windows = NULL;
+    memory->window_capacity = 0;
+}
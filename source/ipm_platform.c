@@ -7,6 +7,17 @@
 
 #ifdef IPM_PLATFORM_POSIX
 
+#include <time.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <linux/futex.h>
+#endif
+
 
 ipm_result ipm_semaphore_init(ipm_sem* p_sem, unsigned val)
 {
@@ -278,6 +289,314 @@ ipm_result ipm_condition_destroy(ipm_cnd* p_cnd)
     return IPM_RESULT_SUCCESS;
 }
 
+ipm_result ipm_futex_wait(uint32_t* address, uint32_t expected, unsigned timeout_ms)
+{
+#ifdef __linux__
+    const struct timespec timeout = {.tv_sec = timeout_ms / 1000, .tv_nsec = (long) (timeout_ms % 1000) * 1000000};
+    //  Futex is not private, since the word is shared between processes
+    if (syscall(SYS_futex, address, FUTEX_WAIT, expected, &timeout, NULL, 0) == 0)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    switch (errno)
+    {
+    case EAGAIN:
+        //  Value was already changed
+        return IPM_RESULT_SUCCESS;
+    case ETIMEDOUT:
+        return IPM_RESULT_ERR_TIMED_OUT;
+    case EINTR:
+        return IPM_RESULT_INTERRUPTED;
+    case EFAULT:
+    case EINVAL:
+        return IPM_RESULT_ERR_BAD_VALUE;
+    default:
+        return IPM_RESULT_ERR_OS_UNEXPECTED;
+    }
+#else
+    //  Without futexes, the value is polled with short sleeps
+    const struct timespec interval = {.tv_sec = 0, .tv_nsec = 1000000};
+    for (unsigned waited = 0; atomic_load(address) == expected; ++waited)
+    {
+        if (waited >= timeout_ms)
+        {
+            return IPM_RESULT_ERR_TIMED_OUT;
+        }
+        (void) nanosleep(&interval, NULL);
+    }
+    return IPM_RESULT_SUCCESS;
+#endif
+}
+
+void ipm_futex_wake(uint32_t* address, unsigned count)
+{
+#ifdef __linux__
+    (void) syscall(SYS_futex, address, FUTEX_WAKE, count > INT_MAX ? INT_MAX : (int) count, NULL, NULL, 0);
+#else
+    (void) address;
+    (void) count;
+#endif
+}
+
+ipm_result ipm_numa_bind(void* address, size_t size, ipm_numa_policy policy, uint64_t node_mask, ipm_bool move)
+{
+#ifdef __linux__
+    static const int POLICY_MODES[] =
+            {
+            [IPM_NUMA_POLICY_DEFAULT] = MPOL_DEFAULT,
+            [IPM_NUMA_POLICY_BIND] = MPOL_BIND,
+            [IPM_NUMA_POLICY_INTERLEAVE] = MPOL_INTERLEAVE,
+            [IPM_NUMA_POLICY_PREFERRED] = MPOL_PREFERRED,
+            };
+    assert(policy >= IPM_NUMA_POLICY_DEFAULT && policy <= IPM_NUMA_POLICY_PREFERRED);
+    unsigned long mask[64 / (8 * sizeof(unsigned long))];
+    for (unsigned i = 0; i < sizeof(mask) / sizeof(*mask); ++i)
+    {
+        mask[i] = (unsigned long) (node_mask >> (i * 8 * sizeof(unsigned long)));
+    }
+    //  The kernel treats maxnode as one more than the number of bits in the mask
+    const int is_default = policy == IPM_NUMA_POLICY_DEFAULT;
+    const long res = syscall(SYS_mbind, address, size, POLICY_MODES[policy], is_default ? NULL : mask,
+                             is_default ? 0 : 8 * sizeof(mask) + 1, move ? MPOL_MF_MOVE : 0);
+    if (res < 0)
+    {
+        switch (errno)
+        {
+        case EFAULT:
+        case EINVAL:
+            return IPM_RESULT_ERR_BAD_VALUE;
+        case ENOMEM:
+            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        case EPERM:
+            return IPM_RESULT_ERR_ACCESS;
+        case ENOSYS:
+            return IPM_RESULT_ERR_NOT_SUPPORTED;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+    return IPM_RESULT_SUCCESS;
+#else
+    (void) address;
+    (void) size;
+    (void) node_mask;
+    (void) move;
+    return policy == IPM_NUMA_POLICY_DEFAULT ? IPM_RESULT_SUCCESS : IPM_RESULT_ERR_NOT_SUPPORTED;
+#endif
+}
+
+ipm_result ipm_numa_residency(
+        void* address, size_t size, unsigned node_count, size_t* p_pages_per_node, size_t* p_not_resident)
+{
+#ifdef __linux__
+    enum {BATCH_SIZE = 256};
+    unsigned char in_core[BATCH_SIZE];
+    void* pages[BATCH_SIZE];
+    int status[BATCH_SIZE];
+    const size_t page_count = size / IPM_MEMORY_PAGE_SIZE;
+    size_t not_resident = 0;
+    for (unsigned i = 0; i < node_count; ++i)
+    {
+        p_pages_per_node[i] = 0;
+    }
+
+    for (size_t base = 0; base < page_count; base += BATCH_SIZE)
+    {
+        const size_t batch = page_count - base < BATCH_SIZE ? page_count - base : BATCH_SIZE;
+        uint8_t* const batch_address = (uint8_t*) address + base * IPM_MEMORY_PAGE_SIZE;
+        if (mincore(batch_address, batch * IPM_MEMORY_PAGE_SIZE, in_core) < 0)
+        {
+            switch (errno)
+            {
+            case EAGAIN:
+                return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+            case EFAULT:
+            case EINVAL:
+            case ENOMEM:
+                return IPM_RESULT_ERR_BAD_VALUE;
+            default:
+                return IPM_RESULT_ERR_OS_UNEXPECTED;
+            }
+        }
+        unsigned count = 0;
+        for (unsigned i = 0; i < batch; ++i)
+        {
+            if ((in_core[i] & 1) == 0)
+            {
+                not_resident += 1;
+                continue;
+            }
+            //  The page exists, but it may have been touched only by another process. Reading it maps it into this
+            //  process without allocating anything, so that its node can be queried.
+            volatile const uint8_t* const page = batch_address + (size_t) i * IPM_MEMORY_PAGE_SIZE;
+            (void) *page;
+            pages[count++] = (void*) page;
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+        if (syscall(SYS_move_pages, 0, (unsigned long) count, pages, NULL, status, 0) < 0)
+        {
+            switch (errno)
+            {
+            case ENOMEM:
+                return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+            case EPERM:
+                return IPM_RESULT_ERR_ACCESS;
+            case ENOSYS:
+                return IPM_RESULT_ERR_NOT_SUPPORTED;
+            default:
+                return IPM_RESULT_ERR_OS_UNEXPECTED;
+            }
+        }
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (status[i] < 0)
+            {
+                not_resident += 1;
+            }
+            else if ((unsigned) status[i] < node_count)
+            {
+                p_pages_per_node[status[i]] += 1;
+            }
+        }
+    }
+
+    if (p_not_resident)
+    {
+        *p_not_resident = not_resident;
+    }
+    return IPM_RESULT_SUCCESS;
+#else
+    (void) address;
+    (void) size;
+    (void) node_count;
+    (void) p_pages_per_node;
+    (void) p_not_resident;
+    return IPM_RESULT_ERR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t ipm_process_id(void)
+{
+    return (uint32_t) getpid();
+}
+
+#ifdef __linux__
+static socklen_t event_socket_address(uint64_t name, struct sockaddr_un* address)
+{
+    //  Abstract names are not files, so they disappear with the last socket bound to them, even when a process crashes
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    const int length = snprintf(address->sun_path + 1, sizeof(address->sun_path) - 1, "ipm-event-%016llx", (unsigned long long) name);
+    return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+
+static ipm_result event_socket_error(int error)
+{
+    switch (error)
+    {
+    case EMFILE:
+        return IPM_RESULT_ERR_MAX_FDS;
+    case ENFILE:
+        return IPM_RESULT_ERR_MAX_FDS_SYS;
+    case ENOMEM:
+    case ENOBUFS:
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    case EADDRINUSE:
+        return IPM_RESULT_ERR_EXISTS;
+    case ECONNREFUSED:
+    case ENOENT:
+        return IPM_RESULT_ERR_DOES_NOT_EXIST;
+    default:
+        return IPM_RESULT_ERR_OS_UNEXPECTED;
+    }
+}
+#endif
+
+ipm_result ipm_event_socket_open(uint64_t name, int* p_fd)
+{
+#ifdef __linux__
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return event_socket_error(errno);
+    }
+    struct sockaddr_un address;
+    const socklen_t length = event_socket_address(name, &address);
+    if (bind(fd, (const struct sockaddr*) &address, length) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        return event_socket_error(error);
+    }
+    *p_fd = fd;
+    return IPM_RESULT_SUCCESS;
+#else
+    (void) name;
+    (void) p_fd;
+    return IPM_RESULT_ERR_NOT_SUPPORTED;
+#endif
+}
+
+ipm_result ipm_event_socket_sender(int* p_fd)
+{
+#ifdef __linux__
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return event_socket_error(errno);
+    }
+    *p_fd = fd;
+    return IPM_RESULT_SUCCESS;
+#else
+    (void) p_fd;
+    return IPM_RESULT_ERR_NOT_SUPPORTED;
+#endif
+}
 
+ipm_result ipm_event_socket_send(int fd, uint64_t name, uint32_t events)
+{
+#ifdef __linux__
+    struct sockaddr_un address;
+    const socklen_t length = event_socket_address(name, &address);
+    if (sendto(fd, &events, sizeof(events), MSG_DONTWAIT | MSG_NOSIGNAL, (const struct sockaddr*) &address, length) == sizeof(events))
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    if (errno == EAGAIN)
+    {
+        //  Receiver has not taken the earlier events yet, so its socket is readable already
+        return IPM_RESULT_SUCCESS;
+    }
+    return event_socket_error(errno);
+#else
+    (void) fd;
+    (void) name;
+    (void) events;
+    return IPM_RESULT_ERR_NOT_SUPPORTED;
 #endif
+}
 
+uint32_t ipm_event_socket_drain(int fd)
+{
+    uint32_t all = 0;
+#ifdef __linux__
+    uint32_t events;
+    while (recv(fd, &events, sizeof(events), MSG_DONTWAIT) == sizeof(events))
+    {
+        all |= events;
+    }
+#else
+    (void) fd;
+#endif
+    return all;
+}
+
+void ipm_event_socket_close(int fd)
+{
+    (void) close(fd);
+}
+
+#endif
@@ -26,6 +26,13 @@ typedef pthread_cond_t ipm_cnd;
     #define IPM_PLATFORM_WINDOWS
 #endif
 
+enum
+{
+    //  Fields written by different processes are kept this far apart. It spans two 64-byte cache lines, since many
+    //  processors fetch adjacent lines in pairs.
+    IPM_CACHE_LINE_SIZE = 128,
+};
+
 IPM_INTERNAL_FUNCTION
 ipm_result ipm_semaphore_init(ipm_sem* p_sem, unsigned val);
 
@@ -68,5 +75,36 @@ ipm_result ipm_condition_signal(ipm_cnd* cnd);
 IPM_INTERNAL_FUNCTION
 ipm_result ipm_condition_destroy(ipm_cnd* p_cnd);
 
+IPM_INTERNAL_FUNCTION
+ipm_result ipm_futex_wait(uint32_t* address, uint32_t expected, unsigned timeout_ms);
+
+IPM_INTERNAL_FUNCTION
+void ipm_futex_wake(uint32_t* address, unsigned count);
+
+IPM_INTERNAL_FUNCTION
+ipm_result ipm_numa_bind(void* address, size_t size, ipm_numa_policy policy, uint64_t node_mask, ipm_bool move);
+
+IPM_INTERNAL_FUNCTION
+ipm_result ipm_numa_residency(
+        void* address, size_t size, unsigned node_count, size_t* p_pages_per_node, size_t* p_not_resident);
+
+IPM_INTERNAL_FUNCTION
+uint32_t ipm_process_id(void);
+
+IPM_INTERNAL_FUNCTION
+ipm_result ipm_event_socket_open(uint64_t name, int* p_fd);
+
+IPM_INTERNAL_FUNCTION
+ipm_result ipm_event_socket_sender(int* p_fd);
+
+IPM_INTERNAL_FUNCTION
+ipm_result ipm_event_socket_send(int fd, uint64_t name, uint32_t events);
+
+IPM_INTERNAL_FUNCTION
+uint32_t ipm_event_socket_drain(int fd);
+
+IPM_INTERNAL_FUNCTION
+void ipm_event_socket_close(int fd);
+
 
 #endif //IPM_IPM_PLATFORM_H
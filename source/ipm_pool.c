@@ -0,0 +1,183 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_pool_internal.h"
+#include "ipm_structure.h"
+
+static inline uint64_t align_object(uint64_t size)
+{
+    return (size + (IPM_POOL_ALIGNMENT - 1)) & ~(uint64_t)(IPM_POOL_ALIGNMENT - 1);
+}
+
+static inline ipm_pool_header* pool_header(const ipm_pool* pool)
+{
+    return pool->memory->real_memory.memory;
+}
+
+static ipm_result pool_handle_create(ipm_memory* memory, ipm_pool** p_pool)
+{
+    ipm_pool* const pool = internal_ipm_structure_alloc_handle(memory, "a pool", sizeof(*pool));
+    if (!pool)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    pool->memory = memory;
+    pool->count = 0;
+    *p_pool = pool;
+    return IPM_RESULT_SUCCESS;
+}
+
+static uint32_t pool_take_fresh(ipm_pool* pool)
+{
+    //  Objects which were never used are taken in order, so they need not be put on the free list when it is created
+    ipm_pool_header* const header = pool_header(pool);
+    uint64_t fresh = atomic_load_explicit(&header->fresh, memory_order_relaxed);
+    uint64_t count;
+    do
+    {
+        if (fresh >= header->object_count)
+        {
+            return 0;
+        }
+        count = header->object_count - fresh;
+        if (count > IPM_POOL_BATCH_SIZE)
+        {
+            count = IPM_POOL_BATCH_SIZE;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&header->fresh, &fresh, fresh + count, memory_order_relaxed, memory_order_relaxed));
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        //  Taken in reverse, so that the objects are handed out from the lowest offset up
+        pool->magazine[pool->count++] = header->objects_offset + (fresh + count - 1 - i) * header->stride;
+    }
+    return (uint32_t)count;
+}
+
+ipm_result ipm_pool_create(ipm_memory* memory, size_t object_size, size_t object_count, ipm_pool** p_pool)
+{
+    assert(object_size > 0);
+    assert(object_count > 0);
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a pool");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    //  Each free object holds the offset of the next one on the free list
+    const uint64_t stride = align_object(object_size < sizeof(uint64_t) ? sizeof(uint64_t) : object_size);
+    const uint64_t objects_offset = align_object(sizeof(ipm_pool_header));
+    if (object_count > (IPM_LOCKFREE_OFFSET_MASK - objects_offset) / stride)
+    {
+        IPM_ERROR(&memory->ctx, "Pool of %zu objects of %zu bytes is too large", object_count, object_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    const size_t needed_size = round_size(objects_offset + object_count * stride);
+    if (memory->real_memory.size < needed_size)
+    {
+        res = ipm_memory_resize_grow(memory, needed_size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the pool, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_pool_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    header->layout_version = IPM_POOL_LAYOUT_VERSION;
+    header->object_size = object_size;
+    header->stride = stride;
+    header->object_count = object_count;
+    header->objects_offset = objects_offset;
+    lockfree_stack_init(&header->free_list);
+    atomic_init(&header->fresh, 0);
+    //  Magic is written last, so that the pool is not opened before it is ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_POOL_MAGIC, memory_order_release);
+
+    res = pool_handle_create(memory, p_pool);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+    }
+    return res;
+}
+
+ipm_result ipm_pool_open(ipm_memory* memory, ipm_pool** p_pool)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a pool");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a pool", IPM_POOL_MAGIC, IPM_POOL_LAYOUT_VERSION, sizeof(ipm_pool_header));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const ipm_pool_header* header = memory->real_memory.memory;
+    res = internal_ipm_structure_map(memory, "a pool", header->objects_offset + header->object_count * header->stride);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return pool_handle_create(memory, p_pool);
+}
+
+void ipm_pool_close(ipm_pool* pool)
+{
+    while (pool->count)
+    {
+        lockfree_stack_push(&pool_header(pool)->free_list, pool->memory->real_memory.memory, pool->magazine[--pool->count]);
+    }
+    ipm_free(&pool->memory->ctx, pool);
+}
+
+size_t ipm_pool_object_size(const ipm_pool* pool)
+{
+    return pool_header(pool)->object_size;
+}
+
+ipm_result ipm_pool_alloc(ipm_pool* pool, size_t* p_offset)
+{
+    if (pool->count == 0)
+    {
+        ipm_pool_header* const header = pool_header(pool);
+        void* const base = pool->memory->real_memory.memory;
+        while (pool->count < IPM_POOL_BATCH_SIZE)
+        {
+            const uint64_t offset = lockfree_stack_pop(&header->free_list, base, IPM_LOCKFREE_OFFSET_MASK);
+            if (!offset)
+            {
+                break;
+            }
+            pool->magazine[pool->count++] = offset;
+        }
+        if (pool->count == 0 && pool_take_fresh(pool) == 0)
+        {
+            return IPM_RESULT_ERR_POOL_EMPTY;
+        }
+    }
+    *p_offset = (size_t)pool->magazine[--pool->count];
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_pool_free(ipm_pool* pool, size_t offset)
+{
+    ipm_pool_header* const header = pool_header(pool);
+    if (offset < header->objects_offset || (offset - header->objects_offset) % header->stride != 0 ||
+        (offset - header->objects_offset) / header->stride >= header->object_count)
+    {
+        IPM_ERROR(&pool->memory->ctx, "Offset %zu is not that of an object of the pool", offset);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (pool->count == IPM_POOL_MAGAZINE_SIZE)
+    {
+        void* const base = pool->memory->real_memory.memory;
+        while (pool->count > IPM_POOL_MAGAZINE_SIZE - IPM_POOL_BATCH_SIZE)
+        {
+            lockfree_stack_push(&header->free_list, base, pool->magazine[--pool->count]);
+        }
+    }
+    pool->magazine[pool->count++] = offset;
+    return IPM_RESULT_SUCCESS;
+}
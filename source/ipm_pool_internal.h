@@ -0,0 +1,42 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_POOL_INTERNAL_H
+#define IPM_POOL_INTERNAL_H
+#include "../include/ipm/ipm_pool.h"
+#include "ipm_memory_internal.h"
+#include "lockfree.h"
+
+enum
+{
+    IPM_POOL_MAGIC = 0x4C4F4F50,            //  Reads as "POOL" on little-endian
+    IPM_POOL_LAYOUT_VERSION = 1,
+    IPM_POOL_ALIGNMENT = 16,                //  Alignment of every object
+    IPM_POOL_MAGAZINE_SIZE = 64,            //  Free objects a handle keeps for itself
+    IPM_POOL_BATCH_SIZE = IPM_POOL_MAGAZINE_SIZE / 2,  //  Objects moved between a handle and the shared list at once
+};
+
+//  Placed at the start of the block
+struct ipm_pool_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t object_size;
+    uint64_t stride;            //  Distance between the starts of two neighbouring objects
+    uint64_t object_count;
+    uint64_t objects_offset;    //  Offset of the first object from the start of the block
+
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_lockfree_stack free_list;    //  Objects which were freed
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t fresh;  //  Objects which were ever given out, the rest follow them
+};
+typedef struct ipm_pool_header_T ipm_pool_header;
+
+struct ipm_pool_T
+{
+    ipm_memory* memory;
+    uint32_t count;
+    uint64_t magazine[IPM_POOL_MAGAZINE_SIZE];  //  Offsets of free objects kept by the handle
+};
+
+#endif //IPM_POOL_INTERNAL_H
@@ -0,0 +1,280 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_queue_internal.h"
+#include "ipm_structure.h"
+
+static inline ipm_queue_slot* queue_slot(const ipm_queue* queue, uint64_t position)
+{
+    return (ipm_queue_slot*)(queue->slots + (position & queue->mask) * queue->stride);
+}
+
+static ipm_result queue_handle_create(ipm_memory* memory, ipm_queue** p_queue)
+{
+    ipm_queue_header* const header = memory->real_memory.memory;
+    ipm_queue* const queue = internal_ipm_structure_alloc_handle(memory, "a queue", sizeof(*queue));
+    if (!queue)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    queue->memory = memory;
+    queue->header = header;
+    queue->slots = (uint8_t*)header + header->slots_offset;
+    queue->mask = header->capacity - 1;
+    queue->stride = header->stride;
+    queue->element_size = header->element_size;
+    *p_queue = queue;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_queue_create(ipm_memory* memory, size_t element_size, size_t capacity, ipm_queue** p_queue)
+{
+    assert(element_size > 0);
+    assert(capacity > 0);
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a queue");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (capacity > ((size_t)1 << 32) || element_size > ((size_t)1 << 32))
+    {
+        IPM_ERROR(&memory->ctx, "Queue can hold at most %zu elements of at most %zu bytes, but %zu of %zu bytes were requested", (size_t)1 << 32, (size_t)1 << 32, capacity, element_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    uint64_t real_capacity = 1;
+    while (real_capacity < capacity)
+    {
+        real_capacity <<= 1;
+    }
+    const uint64_t stride = align_line(IPM_QUEUE_ELEMENT_OFFSET + element_size);
+    const uint64_t slots_offset = align_line(sizeof(ipm_queue_header));
+    if (stride > (SIZE_MAX - IPM_MEMORY_PAGE_SIZE - slots_offset) / real_capacity)
+    {
+        IPM_ERROR(&memory->ctx, "Queue of %zu elements of %zu bytes does not fit into memory", capacity, element_size);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    const size_t needed_size = round_size(slots_offset + real_capacity * stride);
+    if (memory->real_memory.size < needed_size)
+    {
+        res = ipm_memory_resize_grow(memory, needed_size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the queue, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_queue_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    header->layout_version = IPM_QUEUE_LAYOUT_VERSION;
+    header->capacity = real_capacity;
+    header->element_size = element_size;
+    header->stride = stride;
+    header->slots_offset = slots_offset;
+    atomic_init(&header->enqueue_position, 0);
+    atomic_init(&header->dequeue_position, 0);
+    atomic_init(&header->not_empty, 0);
+    atomic_init(&header->pop_waiters, 0);
+    atomic_init(&header->not_full, 0);
+    atomic_init(&header->push_waiters, 0);
+    for (uint64_t i = 0; i < real_capacity; ++i)
+    {
+        ipm_queue_slot* const slot = (ipm_queue_slot*)((uint8_t*)header + slots_offset + i * stride);
+        atomic_init(&slot->sequence, i);
+    }
+    //  Magic is written last, so that the queue is not opened before it is ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_QUEUE_MAGIC, memory_order_release);
+
+    res = queue_handle_create(memory, p_queue);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+    }
+    return res;
+}
+
+ipm_result ipm_queue_open(ipm_memory* memory, ipm_queue** p_queue)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a queue");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a queue", IPM_QUEUE_MAGIC, IPM_QUEUE_LAYOUT_VERSION, sizeof(ipm_queue_header));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const ipm_queue_header* const header = memory->real_memory.memory;
+    res = internal_ipm_structure_map(memory, "a queue", header->slots_offset + header->capacity * header->stride);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return queue_handle_create(memory, p_queue);
+}
+
+void ipm_queue_close(ipm_queue* queue)
+{
+    ipm_free(&queue->memory->ctx, queue);
+}
+
+size_t ipm_queue_element_size(const ipm_queue* queue)
+{
+    return queue->element_size;
+}
+
+/**
+ * Reserves up to count consecutive positions, the slots of which all have the expected sequence.
+ * @param position Either the enqueue or the dequeue position.
+ * @param lag Difference between the sequence of a slot which is ready and its position.
+ * @return Number of reserved positions, with the first one written to p_first.
+ */
+static unsigned queue_reserve(ipm_queue* queue, _Atomic uint64_t* position, uint64_t lag, unsigned count, uint64_t* p_first)
+{
+    uint64_t first = atomic_load_explicit(position, memory_order_relaxed);
+    for (;;)
+    {
+        //  A slot seen as ready stays so until its position is reserved, which would make the exchange below fail
+        unsigned ready = 0;
+        while (ready < count)
+        {
+            const uint64_t sequence = atomic_load_explicit(&queue_slot(queue, first + ready)->sequence, memory_order_acquire);
+            if (sequence != first + ready + lag)
+            {
+                break;
+            }
+            ready += 1;
+        }
+        if (ready == 0)
+        {
+            const uint64_t current = atomic_load_explicit(position, memory_order_relaxed);
+            if (current == first)
+            {
+                return 0;
+            }
+            first = current;
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(position, &first, first + ready, memory_order_relaxed, memory_order_relaxed))
+        {
+            *p_first = first;
+            return ready;
+        }
+    }
+}
+
+static void queue_wake(_Atomic uint32_t* event, _Atomic uint32_t* waiters, unsigned count)
+{
+    //  Waiter announces itself before checking the queue for the last time, so one of them sees the other's change
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed))
+    {
+        atomic_fetch_add_explicit(event, 1, memory_order_relaxed);
+        ipm_futex_wake((uint32_t*)event, count);
+    }
+}
+
+ipm_result ipm_queue_push(ipm_queue* queue, const void* elements, unsigned count, unsigned* p_pushed)
+{
+    assert(count > 0);
+    uint64_t first;
+    const unsigned reserved = queue_reserve(queue, &queue->header->enqueue_position, 0, count, &first);
+    if (p_pushed)
+    {
+        *p_pushed = reserved;
+    }
+    if (reserved == 0)
+    {
+        return IPM_RESULT_ERR_FULL;
+    }
+    for (unsigned i = 0; i < reserved; ++i)
+    {
+        ipm_queue_slot* const slot = queue_slot(queue, first + i);
+        memcpy((uint8_t*)slot + IPM_QUEUE_ELEMENT_OFFSET, (const uint8_t*)elements + i * queue->element_size, queue->element_size);
+        atomic_store_explicit(&slot->sequence, first + i + 1, memory_order_release);
+    }
+    queue_wake(&queue->header->not_empty, &queue->header->pop_waiters, reserved);
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_queue_pop(ipm_queue* queue, void* elements, unsigned count, unsigned* p_popped)
+{
+    assert(count > 0);
+    uint64_t first;
+    const unsigned reserved = queue_reserve(queue, &queue->header->dequeue_position, 1, count, &first);
+    if (p_popped)
+    {
+        *p_popped = reserved;
+    }
+    if (reserved == 0)
+    {
+        return IPM_RESULT_ERR_EMPTY;
+    }
+    for (unsigned i = 0; i < reserved; ++i)
+    {
+        ipm_queue_slot* const slot = queue_slot(queue, first + i);
+        memcpy((uint8_t*)elements + i * queue->element_size, (const uint8_t*)slot + IPM_QUEUE_ELEMENT_OFFSET, queue->element_size);
+        //  Slot is free for the position one lap later
+        atomic_store_explicit(&slot->sequence, first + i + queue->mask + 1, memory_order_release);
+    }
+    queue_wake(&queue->header->not_full, &queue->header->push_waiters, reserved);
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_result queue_wait(
+        ipm_queue* queue, ipm_result (* operation)(ipm_queue*, void*, unsigned, unsigned*), void* elements,
+        unsigned count, _Atomic uint32_t* event, _Atomic uint32_t* waiters, ipm_result fail, unsigned timeout_ms,
+        unsigned* p_done)
+{
+    //  Another process usually makes progress soon, which is much cheaper to wait for without a system call
+    for (unsigned i = 0; i < IPM_QUEUE_SPIN_COUNT; ++i)
+    {
+        const ipm_result res = operation(queue, elements, count, p_done);
+        if (res != fail)
+        {
+            return res;
+        }
+    }
+    const uint64_t deadline = monotonic_time_ms() + timeout_ms;
+    for (;;)
+    {
+        atomic_fetch_add_explicit(waiters, 1, memory_order_relaxed);
+        const uint32_t expected = atomic_load_explicit(event, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        ipm_result res = operation(queue, elements, count, p_done);
+        if (res != fail)
+        {
+            atomic_fetch_sub_explicit(waiters, 1, memory_order_relaxed);
+            return res;
+        }
+        const uint64_t now = monotonic_time_ms();
+        res = now < deadline ? ipm_futex_wait((uint32_t*)event, expected, (unsigned)(deadline - now)) : IPM_RESULT_ERR_TIMED_OUT;
+        atomic_fetch_sub_explicit(waiters, 1, memory_order_relaxed);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+}
+
+static ipm_result queue_push_operation(ipm_queue* queue, void* elements, unsigned count, unsigned* p_done)
+{
+    return ipm_queue_push(queue, elements, count, p_done);
+}
+
+ipm_result ipm_queue_push_wait(
+        ipm_queue* queue, const void* elements, unsigned count, unsigned timeout_ms, unsigned* p_pushed)
+{
+    return queue_wait(
+            queue, queue_push_operation, (void*)elements, count, &queue->header->not_full,
+            &queue->header->push_waiters, IPM_RESULT_ERR_FULL, timeout_ms, p_pushed);
+}
+
+ipm_result ipm_queue_pop_wait(ipm_queue* queue, void* elements, unsigned count, unsigned timeout_ms, unsigned* p_popped)
+{
+    return queue_wait(
+            queue, ipm_queue_pop, elements, count, &queue->header->not_empty, &queue->header->pop_waiters,
+            IPM_RESULT_ERR_EMPTY, timeout_ms, p_popped);
+}
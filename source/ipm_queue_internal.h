@@ -0,0 +1,55 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_QUEUE_INTERNAL_H
+#define IPM_QUEUE_INTERNAL_H
+#include "../include/ipm/ipm_queue.h"
+#include "ipm_memory_internal.h"
+
+enum
+{
+    IPM_QUEUE_MAGIC = 0x55455551,           //  Reads as "QUEU" on little-endian
+    IPM_QUEUE_LAYOUT_VERSION = 1,
+    IPM_QUEUE_ELEMENT_OFFSET = 16,          //  Offset of the element from the start of its slot
+    IPM_QUEUE_SPIN_COUNT = 1024,            //  Times the queue is tried again before the caller goes to sleep
+};
+
+//  Slots are padded to whole cache lines, so that neighbouring slots used by different processes do not share one
+struct ipm_queue_slot_T
+{
+    _Atomic uint64_t sequence;  //  Equal to the position when the slot is free, and to the position plus one when full
+};
+typedef struct ipm_queue_slot_T ipm_queue_slot;
+
+//  Placed at the start of the block
+struct ipm_queue_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t capacity;
+    uint64_t element_size;
+    uint64_t stride;            //  Distance between the starts of two neighbouring slots
+    uint64_t slots_offset;      //  Offset of the first slot from the start of the block
+
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t enqueue_position;
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t dequeue_position;
+    //  Futex words are only changed when someone waits on them, so that pushing and popping normally does not touch them
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint32_t not_empty;
+    _Atomic uint32_t pop_waiters;
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint32_t not_full;
+    _Atomic uint32_t push_waiters;
+};
+typedef struct ipm_queue_header_T ipm_queue_header;
+
+struct ipm_queue_T
+{
+    ipm_memory* memory;
+    ipm_queue_header* header;
+    uint8_t* slots;
+    uint64_t mask;              //  Capacity less one
+    uint64_t stride;
+    size_t element_size;
+};
+
+#endif //IPM_QUEUE_INTERNAL_H
@@ -0,0 +1,258 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_ring_internal.h"
+#include "ipm_structure.h"
+#include <inttypes.h>
+
+static inline uint64_t record_span(size_t size)
+{
+    return sizeof(ipm_ring_record) + ((size + (IPM_RING_ALIGNMENT - 1)) & ~(uint64_t)(IPM_RING_ALIGNMENT - 1));
+}
+
+static inline uint32_t* tail_futex_word(ipm_ring_header* header)
+{
+    //  Lower half of the tail changes with every record, which is enough for the reader to notice one was committed
+    return (uint32_t*)&header->tail + (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__);
+}
+
+static ipm_result ring_handle_create(ipm_memory* memory, ipm_ring** p_ring)
+{
+    ipm_ring_header* const header = memory->real_memory.memory;
+    ipm_ring* const ring = internal_ipm_structure_alloc_handle(memory, "a ring", sizeof(*ring));
+    if (!ring)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    void* data;
+    const ipm_result res = shared_memory_block_map_mirrored(&memory->ctx, &memory->real_memory, IPM_RING_DATA_OFFSET, header->capacity, &data);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        ipm_free(&memory->ctx, ring);
+        IPM_ERROR(&memory->ctx, "Could not map the records of the ring, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    ring->memory = memory;
+    ring->header = header;
+    ring->data = data;
+    ring->mask = header->capacity - 1;
+    ring->cached_head = atomic_load_explicit(&header->head, memory_order_acquire);
+    ring->cached_tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+    ring->reserved = 0;
+    ring->peeked = 0;
+    *p_ring = ring;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_ring_create(ipm_memory* memory, size_t capacity, ipm_ring** p_ring)
+{
+    assert(capacity > 0);
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a ring");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (capacity > ((size_t)1 << 32))
+    {
+        IPM_ERROR(&memory->ctx, "Ring can hold at most %zu bytes, but %zu were requested", (size_t)1 << 32, capacity);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    size_t real_capacity = IPM_MEMORY_PAGE_SIZE;
+    while (real_capacity < capacity)
+    {
+        real_capacity <<= 1;
+    }
+    if (memory->real_memory.size < IPM_RING_DATA_OFFSET + real_capacity)
+    {
+        res = ipm_memory_resize_grow(memory, IPM_RING_DATA_OFFSET + real_capacity);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the ring, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_ring_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    header->layout_version = IPM_RING_LAYOUT_VERSION;
+    header->capacity = real_capacity;
+    atomic_init(&header->head, 0);
+    atomic_init(&header->tail, 0);
+    atomic_init(&header->reader_waiting, 0);
+    //  Magic is written last, so that the ring is not opened before it is ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_RING_MAGIC, memory_order_release);
+
+    res = ring_handle_create(memory, p_ring);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+    }
+    return res;
+}
+
+ipm_result ipm_ring_open(ipm_memory* memory, ipm_ring** p_ring)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a ring");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a ring", IPM_RING_MAGIC, IPM_RING_LAYOUT_VERSION, IPM_RING_DATA_OFFSET);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const ipm_ring_header* const header = memory->real_memory.memory;
+    res = internal_ipm_structure_map(memory, "a ring", IPM_RING_DATA_OFFSET + header->capacity);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return ring_handle_create(memory, p_ring);
+}
+
+void ipm_ring_close(ipm_ring* ring)
+{
+    shared_memory_block_unmap_window(ring->data, 2 * (ring->mask + 1));
+    ipm_free(&ring->memory->ctx, ring);
+}
+
+ipm_result ipm_ring_reserve(ipm_ring* ring, size_t size, void** p_ptr)
+{
+    assert(size > 0);
+    const uint64_t span = record_span(size);
+    const uint64_t capacity = ring->mask + 1;
+    if (span > capacity)
+    {
+        IPM_ERROR(&ring->memory->ctx, "Record of %zu bytes can never fit into the ring of %"PRIu64" bytes", size, capacity);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    const uint64_t tail = atomic_load_explicit(&ring->header->tail, memory_order_relaxed);
+    if (tail + span - ring->cached_head > capacity)
+    {
+        ring->cached_head = atomic_load_explicit(&ring->header->head, memory_order_acquire);
+        if (tail + span - ring->cached_head > capacity)
+        {
+            return IPM_RESULT_ERR_FULL;
+        }
+    }
+    ring->reserved = span;
+    *p_ptr = ring->data + (tail & ring->mask) + sizeof(ipm_ring_record);
+    return IPM_RESULT_SUCCESS;
+}
+
+void ipm_ring_commit(ipm_ring* ring, size_t size)
+{
+    const uint64_t span = record_span(size);
+    assert(size > 0 && span <= ring->reserved);
+    ipm_ring_header* const header = ring->header;
+    const uint64_t tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+    ipm_ring_record* const record = (ipm_ring_record*)(ring->data + (tail & ring->mask));
+    record->size = (uint32_t)size;
+    record->reserved = 0;
+    ring->reserved = 0;
+    atomic_store_explicit(&header->tail, tail + span, memory_order_release);
+    //  Reader announces it will sleep before checking the tail for the last time, so one of them sees the other's store
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&header->reader_waiting, memory_order_relaxed))
+    {
+        atomic_store_explicit(&header->reader_waiting, 0, memory_order_relaxed);
+        ipm_futex_wake(tail_futex_word(header), 1);
+    }
+}
+
+ipm_result ipm_ring_write(ipm_ring* ring, const void* data, size_t size)
+{
+    void* ptr;
+    const ipm_result res = ipm_ring_reserve(ring, size, &ptr);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    memcpy(ptr, data, size);
+    ipm_ring_commit(ring, size);
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_ring_peek(ipm_ring* ring, const void** p_ptr, size_t* p_size)
+{
+    const uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_relaxed);
+    if (head == ring->cached_tail)
+    {
+        ring->cached_tail = atomic_load_explicit(&ring->header->tail, memory_order_acquire);
+        if (head == ring->cached_tail)
+        {
+            return IPM_RESULT_ERR_EMPTY;
+        }
+    }
+    const ipm_ring_record* const record = (const ipm_ring_record*)(ring->data + (head & ring->mask));
+    ring->peeked = record_span(record->size);
+    *p_ptr = record + 1;
+    *p_size = record->size;
+    return IPM_RESULT_SUCCESS;
+}
+
+void ipm_ring_consume(ipm_ring* ring)
+{
+    assert(ring->peeked != 0);
+    const uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->header->head, head + ring->peeked, memory_order_release);
+    ring->peeked = 0;
+}
+
+ipm_result ipm_ring_read(ipm_ring* ring, void* buffer, size_t buffer_size, size_t* p_size)
+{
+    const void* ptr;
+    size_t size;
+    const ipm_result res = ipm_ring_peek(ring, &ptr, &size);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    *p_size = size;
+    if (size > buffer_size)
+    {
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    memcpy(buffer, ptr, size);
+    ipm_ring_consume(ring);
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_ring_wait(ipm_ring* ring, unsigned timeout_ms)
+{
+    ipm_ring_header* const header = ring->header;
+    const uint64_t head = atomic_load_explicit(&header->head, memory_order_relaxed);
+    //  Writer on another core usually commits soon, which is much cheaper to wait for without a system call
+    for (unsigned i = 0; i < IPM_RING_SPIN_COUNT; ++i)
+    {
+        const uint64_t tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+        if (tail != head)
+        {
+            ring->cached_tail = tail;
+            return IPM_RESULT_SUCCESS;
+        }
+    }
+    //  Every wake-up which did not bring a record waits only for what is left of the timeout
+    const uint64_t deadline = monotonic_time_ms() + timeout_ms;
+    for (;;)
+    {
+        atomic_store_explicit(&header->reader_waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        const uint64_t tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+        if (tail != head)
+        {
+            atomic_store_explicit(&header->reader_waiting, 0, memory_order_relaxed);
+            ring->cached_tail = tail;
+            return IPM_RESULT_SUCCESS;
+        }
+        const uint64_t now = monotonic_time_ms();
+        const ipm_result res = now < deadline ? ipm_futex_wait(tail_futex_word(header), (uint32_t)tail, (unsigned)(deadline - now)) : IPM_RESULT_ERR_TIMED_OUT;
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            atomic_store_explicit(&header->reader_waiting, 0, memory_order_relaxed);
+            return res;
+        }
+    }
+}
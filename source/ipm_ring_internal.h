@@ -0,0 +1,53 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_RING_INTERNAL_H
+#define IPM_RING_INTERNAL_H
+#include "../include/ipm/ipm_ring.h"
+#include "ipm_memory_internal.h"
+
+enum
+{
+    IPM_RING_MAGIC = 0x474E4952,            //  Reads as "RING" on little-endian
+    IPM_RING_LAYOUT_VERSION = 1,
+    IPM_RING_ALIGNMENT = 8,                 //  Alignment of every record
+    IPM_RING_DATA_OFFSET = IPM_MEMORY_PAGE_SIZE,   //  Offset of the records from the start of the block
+    IPM_RING_SPIN_COUNT = 1024,             //  Times the reader checks the tail before it goes to sleep
+};
+
+//  Placed before the contents of each record
+struct ipm_ring_record_T
+{
+    uint32_t size;
+    uint32_t reserved;
+};
+typedef struct ipm_ring_record_T ipm_ring_record;
+
+//  Placed at the start of the block
+struct ipm_ring_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t capacity;
+
+    //  Both positions only ever grow, and are only written by the reader and the writer respectively
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t head;   //  Position of the first record not yet consumed
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t tail;   //  Position after the last committed record
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint32_t reader_waiting;   //  Reader sleeps on the lower half of the tail
+};
+typedef struct ipm_ring_header_T ipm_ring_header;
+
+struct ipm_ring_T
+{
+    ipm_memory* memory;
+    ipm_ring_header* header;
+    uint8_t* data;              //  Records, mapped twice in a row
+    uint64_t mask;              //  Capacity less one
+    uint64_t cached_head;       //  Head as last seen by the writer, which only needs to read it again when it looks full
+    uint64_t cached_tail;       //  Tail as last seen by the reader, which only needs to read it again when it looks empty
+    uint64_t reserved;          //  Space reserved by the writer
+    uint64_t peeked;            //  Space taken by the record the reader peeked at
+};
+
+#endif //IPM_RING_INTERNAL_H
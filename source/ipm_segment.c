@@ -0,0 +1,378 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_segment_internal.h"
+#include "ipm_memory_internal.h"
+
+enum
+{
+    SEGMENT_BLOCK_ALIGNMENT = IPM_CACHE_LINE_SIZE,     //  Claim lists of the blocks need to be aligned to cache lines
+};
+
+static inline size_t round_size(size_t size)
+{
+    const size_t remainder = size % IPM_MEMORY_PAGE_SIZE;
+    if (remainder)
+    {
+        return size + (IPM_MEMORY_PAGE_SIZE - remainder);
+    }
+    return size;
+}
+
+static inline size_t align_size(size_t size)
+{
+    return (size + (SEGMENT_BLOCK_ALIGNMENT - 1)) & ~(size_t)(SEGMENT_BLOCK_ALIGNMENT - 1);
+}
+
+static inline ipm_segment_directory* segment_directory(const ipm_segment* segment)
+{
+    return segment->segment.memory;
+}
+
+static inline size_t claim_list_size(void)
+{
+    return align_size(sizeof(ipm_claim_list) + IPM_SEGMENT_BLOCK_CLAIM_CAPACITY * sizeof(ipm_memory_claim));
+}
+
+static void segment_directory_dtor(void* ptr)
+{
+    ipm_segment_directory* const directory = ptr;
+    for (uint32_t i = 0; i < directory->entry_count; ++i)
+    {
+        if (directory->entries[i].refcount != 0)
+        {
+            claim_list_uninit((ipm_claim_list*)((uint8_t*)directory + directory->entries[i].offset));
+        }
+    }
+    ipm_mutex_destroy(&directory->directory_mutex);
+}
+
+static ipm_result segment_directory_initialize(ipm_shared_memory_block* block, void* param)
+{
+    const unsigned max_blocks = *(const unsigned*)param;
+    ipm_segment_directory* const directory = block->memory;
+    const ipm_result res = ipm_mutex_init(&directory->directory_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    directory->max_blocks = max_blocks;
+    directory->entry_count = 0;
+    directory->data_offset = align_size(sizeof(ipm_segment_directory) + max_blocks * sizeof(ipm_segment_entry));
+    directory->data_end = block->size;
+    directory->allocated = directory->data_offset;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_segment_create(
+        const ipm_context* context, size_t segment_size, unsigned max_blocks, const char* segment_name,
+        ipm_segment** p_segment)
+{
+    assert(context);
+    assert(segment_size > 0);
+    assert(max_blocks > 0);
+    assert(strchr(segment_name, '/') == NULL);
+    assert(strlen(segment_name) <= IPM_MAX_NAME_LEN);
+    assert(p_segment);
+    ipm_segment* const this = ipm_alloc(context, sizeof(*this));
+    if (!this)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    this->ctx = *context;
+    memset(this->segment_name, 0, sizeof(this->segment_name));
+    strncpy(this->segment_name, segment_name, sizeof(this->segment_name) - 1);
+
+    //  Directory is placed at the start of the segment, followed by the blocks
+    const size_t directory_size = align_size(sizeof(ipm_segment_directory) + max_blocks * sizeof(ipm_segment_entry));
+    const size_t total_size = round_size(directory_size + segment_size);
+    const ipm_result res = shared_memory_block_create(
+            context, NULL, segment_name, IPM_MEMORY_BLOCK_SEGMENT, 0, total_size, IPM_ACCESS_MODE_READ_WRITE,
+            segment_directory_initialize, &max_blocks, NULL, &this->segment);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not create the shared memory segment %s, reason: %s (%s)", segment_name,
+                  ipm_result_to_str(res), ipm_result_to_msg(res));
+        ipm_free(context, this);
+        return res;
+    }
+
+    *p_segment = this;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_segment_open(const ipm_context* context, const char* segment_name, ipm_segment** p_segment)
+{
+    assert(context);
+    assert(strchr(segment_name, '/') == NULL);
+    assert(strlen(segment_name) <= IPM_MAX_NAME_LEN);
+    assert(p_segment);
+    ipm_segment* const this = ipm_alloc(context, sizeof(*this));
+    if (!this)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    this->ctx = *context;
+    memset(this->segment_name, 0, sizeof(this->segment_name));
+    strncpy(this->segment_name, segment_name, sizeof(this->segment_name) - 1);
+
+    const ipm_result res = shared_memory_block_open(
+            context, NULL, segment_name, IPM_MEMORY_BLOCK_SEGMENT, IPM_ACCESS_MODE_READ_WRITE, 0, &this->segment);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not open the shared memory segment %s, reason: %s (%s)", segment_name,
+                  ipm_result_to_str(res), ipm_result_to_msg(res));
+        ipm_free(context, this);
+        return res;
+    }
+
+    *p_segment = this;
+    return IPM_RESULT_SUCCESS;
+}
+
+void ipm_segment_close(ipm_segment* segment)
+{
+    shared_memory_block_close(&segment->ctx, &segment->segment, segment_directory_dtor, segment->segment.memory);
+    ipm_free(&segment->ctx, segment);
+}
+
+void ipm_segment_clean(ipm_segment* segment)
+{
+    shared_memory_block_clean(&segment->segment);
+    ipm_free(&segment->ctx, segment);
+}
+
+static ipm_segment_entry* find_entry(ipm_segment_directory* directory, const char* block_name, uint64_t hash)
+{
+    //  Directory must be locked by the caller
+    for (uint32_t i = 0; i < directory->entry_count; ++i)
+    {
+        ipm_segment_entry* const entry = directory->entries + i;
+        if (entry->refcount != 0 && entry->name_hash == hash && strcmp(entry->name, block_name) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static ipm_segment_block* make_block_handle(
+        ipm_segment* segment, ipm_segment_directory* directory, const ipm_segment_entry* entry, ipm_access_mode access)
+{
+    ipm_segment_block* const this = ipm_alloc(&segment->ctx, sizeof(*this));
+    if (!this)
+    {
+        return NULL;
+    }
+    this->segment = segment;
+    this->index = entry - directory->entries;
+    this->access_id = atomic_fetch_add(&segment->segment.header->id_counter, 1);
+    this->access_mode = access;
+    this->size = entry->size;
+    this->claims = (ipm_claim_list*)((uint8_t*)directory + entry->offset);
+    this->memory = (uint8_t*)directory + entry->offset + claim_list_size();
+    return this;
+}
+
+ipm_result ipm_segment_block_create(
+        ipm_segment* segment, const char* block_name, size_t block_size, ipm_access_mode access,
+        ipm_segment_block** p_block)
+{
+    assert(block_size > 0);
+    assert(access == IPM_ACCESS_MODE_READ_ONLY || access == IPM_ACCESS_MODE_READ_WRITE);
+    assert(p_block);
+    if (strlen(block_name) > IPM_MAX_NAME_LEN)
+    {
+        IPM_ERROR(&segment->ctx, "Block name is longer than %u characters", (unsigned)IPM_MAX_NAME_LEN);
+        return IPM_RESULT_ERR_NAME_TOO_LONG;
+    }
+    ipm_segment_directory* const directory = segment_directory(segment);
+    const uint64_t hash = ipm_hash_name(block_name);
+    const size_t needed = claim_list_size() + align_size(block_size);
+
+    ipm_result res = ipm_mutex_lock(&directory->directory_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&segment->ctx, "Could not lock the directory of segment %s, reason: %s (%s)", segment->segment_name,
+                  ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+
+    if (find_entry(directory, block_name, hash))
+    {
+        ipm_mutex_unlock(&directory->directory_mutex);
+        IPM_ERROR(&segment->ctx, "Block %s already exists in segment %s", block_name, segment->segment_name);
+        return IPM_RESULT_ERR_EXISTS;
+    }
+
+    //  Reuse the first free entry which is large enough, otherwise take space from the end
+    ipm_segment_entry* entry = NULL;
+    ipm_bool reused = 0;
+    for (uint32_t i = 0; i < directory->entry_count; ++i)
+    {
+        if (directory->entries[i].refcount == 0 && directory->entries[i].capacity >= needed)
+        {
+            entry = directory->entries + i;
+            reused = 1;
+            break;
+        }
+    }
+    if (!entry)
+    {
+        if (directory->entry_count == directory->max_blocks || directory->data_end - directory->allocated < needed)
+        {
+            ipm_mutex_unlock(&directory->directory_mutex);
+            IPM_ERROR(&segment->ctx, "Segment %s has no space left for block %s of size %zu", segment->segment_name, block_name, block_size);
+            return IPM_RESULT_ERR_SEGMENT_FULL;
+        }
+        entry = directory->entries + directory->entry_count;
+        entry->offset = directory->allocated;
+        entry->capacity = needed;
+    }
+
+    ipm_claim_list* const list = (ipm_claim_list*)((uint8_t*)directory + entry->offset);
+    res = claim_list_init(list, (claim_list_size() - sizeof(ipm_claim_list)) / sizeof(ipm_memory_claim));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        ipm_mutex_unlock(&directory->directory_mutex);
+        IPM_ERROR(&segment->ctx, "Could not initialize the claims list for block %s, reason: %s (%s)", block_name,
+                  ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    if (reused)
+    {
+        //  New block must not see the contents of the previous one
+        memset((uint8_t*)list + claim_list_size(), 0, entry->capacity - claim_list_size());
+    }
+    else
+    {
+        directory->allocated += needed;
+        directory->entry_count += 1;
+    }
+    entry->name_hash = hash;
+    entry->size = block_size;
+    memset(entry->name, 0, sizeof(entry->name));
+    strncpy(entry->name, block_name, sizeof(entry->name) - 1);
+    entry->refcount = 1;
+
+    ipm_segment_block* const this = make_block_handle(segment, directory, entry, access);
+    if (!this)
+    {
+        entry->refcount = 0;
+        claim_list_uninit(list);
+        ipm_mutex_unlock(&directory->directory_mutex);
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    ipm_mutex_unlock(&directory->directory_mutex);
+
+    *p_block = this;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_segment_block_open(
+        ipm_segment* segment, const char* block_name, ipm_access_mode access, ipm_segment_block** p_block)
+{
+    assert(access == IPM_ACCESS_MODE_READ_ONLY || access == IPM_ACCESS_MODE_READ_WRITE);
+    assert(p_block);
+    ipm_segment_directory* const directory = segment_directory(segment);
+    const uint64_t hash = ipm_hash_name(block_name);
+
+    const ipm_result res = ipm_mutex_lock(&directory->directory_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&segment->ctx, "Could not lock the directory of segment %s, reason: %s (%s)", segment->segment_name,
+                  ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    ipm_segment_entry* const entry = find_entry(directory, block_name, hash);
+    if (!entry)
+    {
+        ipm_mutex_unlock(&directory->directory_mutex);
+        IPM_ERROR(&segment->ctx, "Block %s does not exist in segment %s", block_name, segment->segment_name);
+        return IPM_RESULT_ERR_DOES_NOT_EXIST;
+    }
+    ipm_segment_block* const this = make_block_handle(segment, directory, entry, access);
+    if (!this)
+    {
+        ipm_mutex_unlock(&directory->directory_mutex);
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    entry->refcount += 1;
+    ipm_mutex_unlock(&directory->directory_mutex);
+
+    *p_block = this;
+    return IPM_RESULT_SUCCESS;
+}
+
+void ipm_segment_block_close(ipm_segment_block* block)
+{
+    ipm_segment* const segment = block->segment;
+    ipm_segment_directory* const directory = segment_directory(segment);
+    ipm_segment_block_release_all(block);
+
+    const ipm_result res = ipm_mutex_lock(&directory->directory_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&segment->ctx, "Could not lock the directory of segment %s, reason: %s (%s)", segment->segment_name,
+                  ipm_result_to_str(res), ipm_result_to_msg(res));
+        ipm_free(&segment->ctx, block);
+        return;
+    }
+    ipm_segment_entry* const entry = directory->entries + block->index;
+    assert(entry->refcount > 0);
+    entry->refcount -= 1;
+    if (entry->refcount == 0)
+    {
+        //  Entry is now free to be reused by another block
+        claim_list_uninit(block->claims);
+        memset(entry->name, 0, sizeof(entry->name));
+    }
+    ipm_mutex_unlock(&directory->directory_mutex);
+    ipm_free(&segment->ctx, block);
+}
+
+void ipm_segment_block_clean(ipm_segment_block* block)
+{
+    ipm_free(&block->segment->ctx, block);
+}
+
+void* ipm_segment_block_pointer(ipm_segment_block* block)
+{
+    return block->memory;
+}
+
+size_t ipm_segment_block_size(const ipm_segment_block* block)
+{
+    return block->size;
+}
+
+ipm_result ipm_segment_block_claim_region(
+        ipm_segment_block* block, ipm_access_mode access, size_t offset, size_t count, ipm_id* p_claim_id)
+{
+    assert(access == IPM_ACCESS_MODE_READ_WRITE || access == IPM_ACCESS_MODE_READ_ONLY);
+    assert(count > 0);
+    assert(p_claim_id);
+    const ipm_context* const ctx = &block->segment->ctx;
+    if (block->access_mode == IPM_ACCESS_MODE_READ_ONLY && access == IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(ctx, "Block was opened as read-only and can not be claimed for write access");
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    if (block->size < offset + count)
+    {
+        IPM_ERROR(ctx, "Block has the size of %zu, so region [%zu, %zu) can not be claimed", block->size, offset, offset + count);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    return claim_list_acquire(ctx, block->claims, access, offset, count, block->access_id, NULL, p_claim_id);
+}
+
+ipm_result ipm_segment_block_release_region(ipm_segment_block* block, ipm_id claim_id)
+{
+    return claim_list_release(&block->segment->ctx, block->claims, claim_id, NULL);
+}
+
+ipm_result ipm_segment_block_release_all(ipm_segment_block* block)
+{
+    return claim_list_release_all(&block->segment->ctx, block->claims, block->access_id, NULL);
+}
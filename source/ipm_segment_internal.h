@@ -0,0 +1,53 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_SEGMENT_INTERNAL_H
+#define IPM_SEGMENT_INTERNAL_H
+#include "../include/ipm/ipm_segment.h"
+#include "shared_memory.h"
+#include "memory_claim.h"
+#include "internal.h"
+
+struct ipm_segment_entry_T
+{
+    uint64_t name_hash;         //  Hash of the block name, checked before the name itself is compared
+    uint32_t refcount;          //  Number of handles to the block, or 0 when the entry is free
+    size_t offset;              //  Offset of the block's claim list from the start of the segment data
+    size_t capacity;            //  Space reserved for the claim list and the data of the block
+    size_t size;                //  Size of the block's data
+    char name[IPM_MAX_NAME_LEN + 1];
+};
+typedef struct ipm_segment_entry_T ipm_segment_entry;
+
+struct ipm_segment_directory_T
+{
+    ipm_mut directory_mutex;    //  Mutex for the directory
+    uint32_t max_blocks;        //  Number of entries in the directory
+    uint32_t entry_count;       //  Number of entries which were ever used
+    size_t data_offset;         //  Offset of the first block from the start of the segment data
+    size_t data_end;            //  End of space available for blocks
+    size_t allocated;           //  Offset of the first byte not yet reserved for any block
+    ipm_segment_entry entries[];
+};
+typedef struct ipm_segment_directory_T ipm_segment_directory;
+
+struct ipm_segment_T
+{
+    ipm_context ctx;
+    char segment_name[IPM_MAX_NAME_LEN + 1];
+    ipm_shared_memory_block segment;
+};
+
+struct ipm_segment_block_T
+{
+    ipm_segment* segment;
+    uint32_t index;             //  Index of the block's entry in the directory
+    ipm_id access_id;
+    ipm_access_mode access_mode;
+    size_t size;
+    ipm_claim_list* claims;
+    void* memory;
+};
+
+#endif //IPM_SEGMENT_INTERNAL_H
@@ -0,0 +1,438 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_shm_heap_internal.h"
+#include "ipm_structure.h"
+#include <inttypes.h>
+
+static inline uint64_t heap_start(void)
+{
+    //  Offset of the first chunk, right after the header
+    return (sizeof(ipm_shm_heap_header) + (IPM_SHM_HEAP_ALIGNMENT - 1)) & ~(uint64_t)(IPM_SHM_HEAP_ALIGNMENT - 1);
+}
+
+static inline ipm_shm_heap_header* heap_header(const ipm_shm_heap* heap)
+{
+    return heap->memory->real_memory.memory;
+}
+
+static inline ipm_shm_chunk* heap_chunk(const ipm_shm_heap* heap, uint64_t offset)
+{
+    return (ipm_shm_chunk*)((uint8_t*)heap->memory->real_memory.memory + offset) - 1;
+}
+
+static unsigned size_class_of(size_t size)
+{
+    assert(size > 0 && size <= IPM_SHM_HEAP_MAX_SMALL_SIZE);
+    //  Steps of 16 bytes up to 128 bytes, after that four steps for each power of two
+    if (size <= 128)
+    {
+        return (unsigned)((size + 15) / 16) - 1;
+    }
+    const unsigned power = 63 - (unsigned)__builtin_clzll((unsigned long long)(size - 1));
+    const unsigned step = (unsigned)((size - (1ull << power) - 1) >> (power - 2));
+    return 8 + (power - 7) * 4 + step;
+}
+
+static size_t size_class_size(unsigned size_class)
+{
+    assert(size_class < IPM_SHM_HEAP_CLASS_COUNT);
+    if (size_class < 8)
+    {
+        return 16 * (size_class + 1);
+    }
+    const unsigned power = 7 + (size_class - 8) / 4;
+    const unsigned step = (size_class - 8) % 4 + 1;
+    return ((size_t)1 << power) + step * ((size_t)1 << (power - 2));
+}
+
+static ipm_result heap_map_all(ipm_shm_heap* heap)
+{
+    //  Some other process might have grown the heap, so its regions may lie past the end of this mapping
+    ipm_memory* const memory = heap->memory;
+    const uint64_t capacity = atomic_load_explicit(&heap_header(heap)->capacity, memory_order_acquire);
+    if (memory->real_memory.size >= capacity)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    const ipm_result res = ipm_memory_sync(memory);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not map the grown heap, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
+
+static ipm_result heap_grow(ipm_shm_heap* heap, uint64_t end)
+{
+    ipm_memory* const memory = heap->memory;
+    ipm_result res = ipm_mutex_lock(&heap_header(heap)->heap_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not lock the heap mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    //  Another process may have grown it while this one waited, and the block must never be resized to a smaller size.
+    //  Mapping is not updated while the mutex is held, since moving it would leave the mutex at an address the kernel
+    //  can no longer reach to mark it as abandoned, should the process die before unlocking it.
+    const uint64_t capacity = atomic_load_explicit(&heap_header(heap)->capacity, memory_order_relaxed);
+    if (capacity < end)
+    {
+        const size_t block_size = memory->real_memory.header->block_size;
+        if (block_size < end)
+        {
+            res = internal_ipm_memory_grow_unmapped(memory, 2 * capacity > end ? 2 * capacity : end);
+        }
+        if (res == IPM_RESULT_SUCCESS)
+        {
+            atomic_store_explicit(&heap_header(heap)->capacity, memory->real_memory.header->block_size, memory_order_release);
+        }
+        else
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the heap to %"PRIu64" bytes, reason: %s (%s)", end, ipm_result_to_str(res), ipm_result_to_msg(res));
+        }
+    }
+    ipm_mutex_unlock(&heap_header(heap)->heap_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return heap_map_all(heap);
+}
+
+static ipm_result heap_carve(ipm_shm_heap* heap, uint64_t size, uint64_t* p_offset)
+{
+    uint64_t top = atomic_load_explicit(&heap_header(heap)->top, memory_order_relaxed);
+    for (;;)
+    {
+        const uint64_t end = top + size;
+        if (end > atomic_load_explicit(&heap_header(heap)->capacity, memory_order_acquire))
+        {
+            const ipm_result res = heap_grow(heap, end);
+            if (res != IPM_RESULT_SUCCESS)
+            {
+                return res;
+            }
+            top = atomic_load_explicit(&heap_header(heap)->top, memory_order_relaxed);
+            continue;
+        }
+        //  Released, so that any process which sees the new top also sees a capacity which covers it
+        if (atomic_compare_exchange_weak_explicit(&heap_header(heap)->top, &top, end, memory_order_release, memory_order_relaxed))
+        {
+            break;
+        }
+    }
+    *p_offset = top;
+    return heap_map_all(heap);
+}
+
+static ipm_result heap_refill(ipm_shm_heap* heap, unsigned size_class)
+{
+    ipm_shm_heap_cache* const cache = heap->caches + size_class;
+    ipm_result res = heap_map_all(heap);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    //  Regions freed by others are reused before new space is taken, moving half a cache at a time
+    ipm_lockfree_stack* const stack = &heap_header(heap)->free_lists[size_class].head;
+    const size_t region_size = size_class_size(size_class);
+    while (cache->count < IPM_SHM_HEAP_CACHE_SIZE / 2)
+    {
+        const size_t mapped_size = heap->memory->real_memory.size;
+        const uint64_t limit = mapped_size > region_size ? mapped_size - region_size : 0;
+        const uint64_t offset = lockfree_stack_pop(stack, heap->memory->real_memory.memory, limit);
+        if (offset == IPM_LOCKFREE_UNMAPPED)
+        {
+            //  Region was carved by a process which grew the heap after this one last mapped it
+            res = heap_map_all(heap);
+            if (res != IPM_RESULT_SUCCESS)
+            {
+                return res;
+            }
+            if (heap->memory->real_memory.size == mapped_size)
+            {
+                IPM_ERROR(&heap->memory->ctx, "Free list of the heap holds a region past its end");
+                return IPM_RESULT_ERR_OS_UNEXPECTED;
+            }
+            continue;
+        }
+        if (!offset)
+        {
+            break;
+        }
+        cache->offsets[cache->count++] = offset;
+    }
+    if (cache->count)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+
+    const size_t chunk_size = sizeof(ipm_shm_chunk) + region_size;
+    size_t count = IPM_SHM_HEAP_CARVE_SIZE / chunk_size;
+    if (count < 1)
+    {
+        count = 1;
+    }
+    else if (count > IPM_SHM_HEAP_CACHE_SIZE / 2)
+    {
+        count = IPM_SHM_HEAP_CACHE_SIZE / 2;
+    }
+    uint64_t start;
+    res = heap_carve(heap, count * chunk_size, &start);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint64_t offset = start + i * chunk_size + sizeof(ipm_shm_chunk);
+        ipm_shm_chunk* const chunk = heap_chunk(heap, offset);
+        chunk->size_class = size_class;
+        chunk->state = IPM_SHM_CHUNK_STATE_FREE;
+        chunk->size = region_size;
+        cache->offsets[cache->count++] = offset;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_result heap_alloc_large(ipm_shm_heap* heap, size_t size, uint64_t* p_offset)
+{
+    //  Large regions and their chunks take up whole pages, so that they can be reused for similar sizes
+    const size_t region_size = round_size(size + sizeof(ipm_shm_chunk)) - sizeof(ipm_shm_chunk);
+    ipm_shm_heap_header* header;
+    ipm_result res;
+    //  Heap can not grow while the mutex is held, so once mapped, every free large region stays within the mapping. It
+    //  is mapped before the mutex is locked, since the mapping may move, and again if the heap grew in between.
+    for (;;)
+    {
+        res = heap_map_all(heap);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            return res;
+        }
+        header = heap_header(heap);
+        res = ipm_mutex_lock(&header->heap_mutex);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&heap->memory->ctx, "Could not lock the heap mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+        if (atomic_load_explicit(&header->capacity, memory_order_relaxed) <= heap->memory->real_memory.size)
+        {
+            break;
+        }
+        ipm_mutex_unlock(&header->heap_mutex);
+    }
+    uint8_t* const base = heap->memory->real_memory.memory;
+    uint64_t* p_next = &header->large_free;
+    uint64_t offset = *p_next;
+    while (offset && heap_chunk(heap, offset)->size < region_size)
+    {
+        p_next = (uint64_t*)(base + offset);
+        offset = *p_next;
+    }
+    if (offset)
+    {
+        *p_next = *(uint64_t*)(base + offset);
+    }
+    ipm_mutex_unlock(&header->heap_mutex);
+    if (offset)
+    {
+        *p_offset = offset;
+        return IPM_RESULT_SUCCESS;
+    }
+
+    uint64_t start;
+    res = heap_carve(heap, sizeof(ipm_shm_chunk) + region_size, &start);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    offset = start + sizeof(ipm_shm_chunk);
+    ipm_shm_chunk* const chunk = heap_chunk(heap, offset);
+    chunk->size_class = IPM_SHM_HEAP_LARGE_CLASS;
+    chunk->size = region_size;
+    *p_offset = offset;
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_result heap_free_large(ipm_shm_heap* heap, uint64_t offset)
+{
+    ipm_shm_heap_header* const header = heap_header(heap);
+    const ipm_result res = ipm_mutex_lock(&header->heap_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&heap->memory->ctx, "Could not lock the heap mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    *(uint64_t*)((uint8_t*)heap->memory->real_memory.memory + offset) = header->large_free;
+    header->large_free = offset;
+    ipm_mutex_unlock(&header->heap_mutex);
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_result heap_handle_create(ipm_memory* memory, ipm_shm_heap** p_heap)
+{
+    ipm_shm_heap* const heap = internal_ipm_structure_alloc_handle(memory, "a heap", sizeof(*heap));
+    if (!heap)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    memset(heap, 0, sizeof(*heap));
+    heap->memory = memory;
+    *p_heap = heap;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_shm_heap_create(ipm_memory* memory, ipm_shm_heap** p_heap)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a heap");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (memory->real_memory.size < heap_start())
+    {
+        res = ipm_memory_resize_grow(memory, round_size(heap_start()));
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the heap header, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_shm_heap_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    res = ipm_mutex_init(&header->heap_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not initialize the heap mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    header->layout_version = IPM_SHM_HEAP_LAYOUT_VERSION;
+    header->large_free = 0;
+    atomic_init(&header->top, heap_start());
+    atomic_init(&header->capacity, memory->real_memory.size);
+    for (unsigned i = 0; i < IPM_SHM_HEAP_CLASS_COUNT; ++i)
+    {
+        lockfree_stack_init(&header->free_lists[i].head);
+    }
+    //  Magic is written last, so that the heap is not opened before it is ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_SHM_HEAP_MAGIC, memory_order_release);
+
+    res = heap_handle_create(memory, p_heap);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+        ipm_mutex_destroy(&header->heap_mutex);
+    }
+    return res;
+}
+
+ipm_result ipm_shm_heap_open(ipm_memory* memory, ipm_shm_heap** p_heap)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a heap");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a heap", IPM_SHM_HEAP_MAGIC, IPM_SHM_HEAP_LAYOUT_VERSION, heap_start());
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return heap_handle_create(memory, p_heap);
+}
+
+void ipm_shm_heap_close(ipm_shm_heap* heap)
+{
+    if (heap_map_all(heap) == IPM_RESULT_SUCCESS)
+    {
+        for (unsigned i = 0; i < IPM_SHM_HEAP_CLASS_COUNT; ++i)
+        {
+            ipm_shm_heap_cache* const cache = heap->caches + i;
+            while (cache->count)
+            {
+                lockfree_stack_push(&heap_header(heap)->free_lists[i].head, heap->memory->real_memory.memory, cache->offsets[--cache->count]);
+            }
+        }
+    }
+    ipm_free(&heap->memory->ctx, heap);
+}
+
+ipm_result ipm_shm_alloc(ipm_shm_heap* heap, size_t size, size_t* p_offset)
+{
+    assert(size > 0);
+    uint64_t offset;
+    if (size > IPM_SHM_HEAP_MAX_SMALL_SIZE)
+    {
+        const ipm_result res = heap_alloc_large(heap, size, &offset);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&heap->memory->ctx, "Could not allocate %zu bytes from the heap, reason: %s (%s)", size, ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+    else
+    {
+        const unsigned size_class = size_class_of(size);
+        ipm_shm_heap_cache* const cache = heap->caches + size_class;
+        if (cache->count == 0)
+        {
+            const ipm_result res = heap_refill(heap, size_class);
+            if (res != IPM_RESULT_SUCCESS)
+            {
+                IPM_ERROR(&heap->memory->ctx, "Could not allocate %zu bytes from the heap, reason: %s (%s)", size, ipm_result_to_str(res), ipm_result_to_msg(res));
+                return res;
+            }
+        }
+        offset = cache->offsets[--cache->count];
+    }
+    atomic_store_explicit((_Atomic uint32_t*)&heap_chunk(heap, offset)->state, IPM_SHM_CHUNK_STATE_USED, memory_order_relaxed);
+    *p_offset = (size_t)offset;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_shm_free(ipm_shm_heap* heap, size_t offset)
+{
+    //  Top is loaded first, so that mapping the heap afterwards also maps every region below it
+    const uint64_t top = atomic_load_explicit(&heap_header(heap)->top, memory_order_acquire);
+    ipm_result res = heap_map_all(heap);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (offset < heap_start() + sizeof(ipm_shm_chunk) || offset >= top || (offset & (IPM_SHM_HEAP_ALIGNMENT - 1)))
+    {
+        IPM_ERROR(&heap->memory->ctx, "Offset %zu is not that of a region of the heap", offset);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    ipm_shm_chunk* const chunk = heap_chunk(heap, offset);
+    //  Exchanged, so that when two processes free the same region at once, only one of them puts it on a free list
+    uint32_t state = IPM_SHM_CHUNK_STATE_USED;
+    if (!atomic_compare_exchange_strong((_Atomic uint32_t*)&chunk->state, &state, IPM_SHM_CHUNK_STATE_FREE))
+    {
+        IPM_ERROR(&heap->memory->ctx, "Region at offset %zu was not allocated or was already freed", offset);
+        return IPM_RESULT_ERR_BAD_VALUE;
+    }
+    if (chunk->size_class == IPM_SHM_HEAP_LARGE_CLASS)
+    {
+        return heap_free_large(heap, offset);
+    }
+
+    //  Region may have been allocated by another process, but once freed it is the same as any other of its size class
+    assert(chunk->size_class < IPM_SHM_HEAP_CLASS_COUNT);
+    ipm_shm_heap_cache* const cache = heap->caches + chunk->size_class;
+    if (cache->count == IPM_SHM_HEAP_CACHE_SIZE)
+    {
+        ipm_lockfree_stack* const stack = &heap_header(heap)->free_lists[chunk->size_class].head;
+        while (cache->count > IPM_SHM_HEAP_CACHE_SIZE / 2)
+        {
+            lockfree_stack_push(stack, heap->memory->real_memory.memory, cache->offsets[--cache->count]);
+        }
+    }
+    cache->offsets[cache->count++] = offset;
+    return IPM_RESULT_SUCCESS;
+}
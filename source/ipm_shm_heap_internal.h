@@ -0,0 +1,73 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_SHM_HEAP_INTERNAL_H
+#define IPM_SHM_HEAP_INTERNAL_H
+#include "../include/ipm/ipm_shm_heap.h"
+#include "ipm_memory_internal.h"
+#include "ipm_platform.h"
+#include "lockfree.h"
+
+enum
+{
+    IPM_SHM_HEAP_MAGIC = 0x50414548,        //  Reads as "HEAP" on little-endian
+    IPM_SHM_HEAP_LAYOUT_VERSION = 1,
+    IPM_SHM_HEAP_ALIGNMENT = 16,            //  Alignment of every allocation
+    IPM_SHM_HEAP_CLASS_COUNT = 60,          //  Size classes from 16 bytes to IPM_SHM_HEAP_MAX_SMALL_SIZE
+    IPM_SHM_HEAP_CACHE_SIZE = 32,           //  Free regions of each size class a handle keeps for itself
+    IPM_SHM_HEAP_CARVE_SIZE = (1 << 16),    //  Bytes of new space taken at once for regions of a small size class
+    IPM_SHM_HEAP_LARGE_CLASS = UINT32_MAX,  //  Size class of regions larger than IPM_SHM_HEAP_MAX_SMALL_SIZE
+};
+
+enum ipm_shm_chunk_state_T
+{
+    IPM_SHM_CHUNK_STATE_FREE = 0x45455246,  //  Reads as "FREE" on little-endian
+    IPM_SHM_CHUNK_STATE_USED = 0x44455355,  //  Reads as "USED" on little-endian
+};
+
+//  Placed right before each region, so that it can be freed by its offset alone
+struct ipm_shm_chunk_T
+{
+    uint32_t size_class;
+    uint32_t state;
+    uint64_t size;              //  Size of the region following the chunk header
+};
+typedef struct ipm_shm_chunk_T ipm_shm_chunk;
+
+struct ipm_shm_free_list_T
+{
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_lockfree_stack head;
+};
+typedef struct ipm_shm_free_list_T ipm_shm_free_list;
+
+//  Placed at the start of the block
+struct ipm_shm_heap_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_mut heap_mutex;  //  Serializes growing the block and the list of large regions
+    uint64_t large_free;        //  Offset of the first free large region, or 0 if there are none
+
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t top;    //  Offset of the first byte never given to any region
+    _Atomic uint64_t capacity;  //  Size of the block the last time the heap grew it
+
+    ipm_shm_free_list free_lists[IPM_SHM_HEAP_CLASS_COUNT];    //  Each on its own cache line
+};
+typedef struct ipm_shm_heap_header_T ipm_shm_heap_header;
+
+struct ipm_shm_heap_cache_T
+{
+    uint32_t count;
+    uint64_t offsets[IPM_SHM_HEAP_CACHE_SIZE];
+};
+typedef struct ipm_shm_heap_cache_T ipm_shm_heap_cache;
+
+struct ipm_shm_heap_T
+{
+    ipm_memory* memory;
+    ipm_shm_heap_cache caches[IPM_SHM_HEAP_CLASS_COUNT];   //  Free regions kept by the handle, by their size class
+};
+
+#endif //IPM_SHM_HEAP_INTERNAL_H
@@ -0,0 +1,237 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_memory_internal.h"
+#include "internal.h"
+
+enum
+{
+    SNAPSHOT_PAGE_PENDING = 0,  //  Page was not yet copied into the shadow
+    SNAPSHOT_PAGE_COPYING = 1,  //  Page is being copied into the shadow by some process
+    SNAPSHOT_PAGE_COPIED = 2,   //  Page was copied into the shadow, so it may be modified
+};
+
+static inline size_t snapshot_state_size(size_t data_size)
+{
+    //  One byte of state per page of data, rounded up to a whole page
+    const size_t page_count = data_size / IPM_MEMORY_PAGE_SIZE;
+    return (page_count + IPM_MEMORY_PAGE_SIZE_MASK) & ~(size_t)IPM_MEMORY_PAGE_SIZE_MASK;
+}
+
+static void snapshot_copy_page(uint8_t* state, uint8_t* shadow_page, const uint8_t* page)
+{
+    uint8_t expected = SNAPSHOT_PAGE_PENDING;
+    if (atomic_compare_exchange_strong(state, &expected, SNAPSHOT_PAGE_COPYING))
+    {
+        memcpy(shadow_page, page, IPM_MEMORY_PAGE_SIZE);
+        atomic_store(state, SNAPSHOT_PAGE_COPIED);
+        return;
+    }
+    while (expected != SNAPSHOT_PAGE_COPIED)
+    {
+        //  Another process is copying the page, which does not take long
+        sched_yield();
+        expected = atomic_load(state);
+    }
+}
+
+void internal_ipm_snapshot_drop_shadow(ipm_memory* memory)
+{
+    if (memory->snapshot_id == 0)
+    {
+        return;
+    }
+    (void)shared_memory_block_clean(&memory->snapshot_shadow);
+    memory->snapshot_id = 0;
+    memory->snapshot_size = 0;
+}
+
+void internal_ipm_snapshot_preserve(ipm_memory* memory, const void* region, size_t offset, size_t size)
+{
+    ipm_shared_memory_header* const header = memory->real_memory.header;
+    const ipm_id id = atomic_load(&header->snapshot_id);
+    if (id != memory->snapshot_id)
+    {
+        //  Shadow of a previous snapshot is no longer needed
+        internal_ipm_snapshot_drop_shadow(memory);
+        if (id == 0)
+        {
+            return;
+        }
+        const size_t snapshot_size = header->snapshot_size;
+        const ipm_result res = shared_memory_block_open(
+                &memory->ctx, NULL, memory->block_name, id, IPM_ACCESS_MODE_READ_WRITE, 0, &memory->snapshot_shadow);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            if (atomic_load(&header->snapshot_id) == id)
+            {
+                IPM_ERROR(&memory->ctx, "Could not open the shadow of snapshot %#016lX for block \"%s\", reason: %s (%s)",
+                          id, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+            }
+            //  Otherwise the snapshot was completed in the meantime, so there is nothing to preserve
+            return;
+        }
+        memory->snapshot_id = id;
+        memory->snapshot_size = snapshot_size;
+    }
+    if (id == 0 || offset >= memory->snapshot_size)
+    {
+        return;
+    }
+
+    const size_t end = offset + size < memory->snapshot_size ? offset + size : memory->snapshot_size;
+    uint8_t* const states = memory->snapshot_shadow.memory;
+    uint8_t* const shadow_data = states + snapshot_state_size(memory->snapshot_size);
+    //  Region may be mapped in a window rather than in the whole block, so pages are addressed relative to it
+    const size_t first = offset / IPM_MEMORY_PAGE_SIZE;
+    const uint8_t* const data = (const uint8_t*)region - (offset - first * IPM_MEMORY_PAGE_SIZE);
+    for (size_t i = first; i < (end + IPM_MEMORY_PAGE_SIZE_MASK) / IPM_MEMORY_PAGE_SIZE; ++i)
+    {
+        if (atomic_load(states + i) != SNAPSHOT_PAGE_COPIED)
+        {
+            snapshot_copy_page(states + i, shadow_data + i * IPM_MEMORY_PAGE_SIZE, data + (i - first) * IPM_MEMORY_PAGE_SIZE);
+        }
+    }
+}
+
+ipm_result ipm_memory_snapshot(ipm_memory* memory, ipm_snapshot** p_snapshot)
+{
+    assert(p_snapshot);
+    if (memory->windows)
+    {
+        IPM_ERROR(&memory->ctx, "Snapshot can not be taken through a windowed handle");
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    }
+    ipm_shared_memory_header* const header = memory->real_memory.header;
+    ipm_claim_list* const list = memory->real_memory.metadata;
+    ipm_snapshot* const this = ipm_alloc(&memory->ctx, sizeof(*this));
+    if (!this)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    this->ctx = memory->ctx;
+
+    //  Only one snapshot of a block is taken at the time
+    ipm_result res = ipm_mutex_lock(&header->segment_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not lock the memory segment, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        ipm_free(&memory->ctx, this);
+        return res;
+    }
+    const ipm_id stale_id = atomic_load(&header->snapshot_id);
+    if (stale_id != 0)
+    {
+        //  Process which was taking the previous snapshot died before completing it
+        (void)shared_memory_block_remove(&memory->ctx, NULL, memory->block_name, stale_id);
+        atomic_store(&header->snapshot_id, 0);
+    }
+
+    const size_t size = header->block_size < memory->real_memory.size ? header->block_size : memory->real_memory.size;
+    const size_t state_size = snapshot_state_size(size);
+    const ipm_id id = (++header->snapshot_counter << 8) | IPM_MEMORY_BLOCK_SNAPSHOT;
+    res = shared_memory_block_create(
+            &memory->ctx, NULL, memory->block_name, id, 0, state_size + size, IPM_ACCESS_MODE_READ_WRITE, NULL, NULL,
+            NULL, &this->shadow);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not create the snapshot shadow for block \"%s\", reason: %s (%s)", memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+        ipm_mutex_unlock(&header->segment_mutex);
+        ipm_free(&memory->ctx, this);
+        return res;
+    }
+
+    //  Once the snapshot is published, any new write claim first preserves the pages it covers. Write claims made before
+    //  that have to be released before the pages they cover can be copied.
+    res = ipm_mutex_lock(&list->list_mutex);
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        header->snapshot_size = size;
+        atomic_store(&header->snapshot_id, id);
+        const ipm_id first_id = list->claim_counter;
+        for (;;)
+        {
+            unsigned i;
+            for (i = 0; i < list->count; ++i)
+            {
+                const ipm_memory_claim* const claim = list->claims + i;
+                if (claim->access == IPM_ACCESS_MODE_READ_WRITE && claim->claim_id < first_id)
+                {
+                    break;
+                }
+            }
+            if (i == list->count)
+            {
+                break;
+            }
+            if (list->claims[i].proc_id == memory->real_memory.access_id)
+            {
+                IPM_ERROR(&memory->ctx, "Can not take a snapshot while holding a write claim to the same block");
+                res = IPM_RESULT_ERR_DEADLOCK;
+                break;
+            }
+            res = ipm_condition_wait(&list->list_cnd, &list->list_mutex);
+            if (res != IPM_RESULT_SUCCESS)
+            {
+                IPM_ERROR(&memory->ctx, "Could not wait on condition variable, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+                break;
+            }
+        }
+        ipm_mutex_unlock(&list->list_mutex);
+    }
+    else
+    {
+        IPM_ERROR(&memory->ctx, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+
+    uint8_t* const states = this->shadow.memory;
+    uint8_t* const shadow_data = states + state_size;
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        //  Copy all pages which were not already copied by writers
+        const uint8_t* const data = memory->real_memory.memory;
+        for (size_t i = 0; i < size / IPM_MEMORY_PAGE_SIZE; ++i)
+        {
+            if (atomic_load(states + i) != SNAPSHOT_PAGE_COPIED)
+            {
+                snapshot_copy_page(states + i, shadow_data + i * IPM_MEMORY_PAGE_SIZE, data + i * IPM_MEMORY_PAGE_SIZE);
+            }
+        }
+    }
+
+    //  Shadow is no longer needed by writers, so its name can be removed. Those that still have it open drop it the
+    //  next time they make a write claim.
+    atomic_store(&header->snapshot_id, 0);
+    (void)shared_memory_block_remove(&memory->ctx, NULL, memory->block_name, id);
+    ipm_mutex_unlock(&header->segment_mutex);
+
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        (void)shared_memory_block_clean(&this->shadow);
+        ipm_free(&memory->ctx, this);
+        return res;
+    }
+
+    (void)mprotect(states, state_size + size, PROT_READ);
+    this->data = shadow_data;
+    this->size = size;
+    *p_snapshot = this;
+    return IPM_RESULT_SUCCESS;
+}
+
+const void* ipm_snapshot_pointer(const ipm_snapshot* snapshot)
+{
+    return snapshot->data;
+}
+
+size_t ipm_snapshot_size(const ipm_snapshot* snapshot)
+{
+    return snapshot->size;
+}
+
+void ipm_snapshot_release(ipm_snapshot* snapshot)
+{
+    (void)shared_memory_block_clean(&snapshot->shadow);
+    ipm_free(&snapshot->ctx, snapshot);
+}
@@ -0,0 +1,64 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_structure.h"
+
+_Static_assert(sizeof(ipm_structure_header) == 2 * sizeof(uint32_t), "Magic and layout version must be all of it");
+
+ipm_result internal_ipm_structure_check_memory(const ipm_memory* memory, const char* what)
+{
+    const ipm_result res = internal_ipm_memory_check_whole_mapping(memory, what);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (memory->real_memory.access_mode != IPM_ACCESS_MODE_READ_WRITE)
+    {
+        IPM_ERROR(&memory->ctx, "Handle of block \"%s\" has read-only access, but %s needs read-write access", memory->block_name, what);
+        return IPM_RESULT_ERR_BAD_ACCESS;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result internal_ipm_structure_check_header(
+        const ipm_memory* memory, const char* what, uint32_t magic, uint32_t layout_version, size_t min_size)
+{
+    const ipm_structure_header* const header = memory->real_memory.memory;
+    //  Creator stores the magic last, so everything else in the header is initialized once it is seen
+    if (memory->real_memory.size < min_size || atomic_load_explicit((_Atomic uint32_t*)&header->magic, memory_order_acquire) != magic)
+    {
+        IPM_ERROR(&memory->ctx, "Block \"%s\" does not hold %s", memory->block_name, what);
+        return IPM_RESULT_ERR_BAD_INIT;
+    }
+    if (header->layout_version != layout_version)
+    {
+        IPM_ERROR(&memory->ctx, "Block \"%s\" holds %s of layout version %u, but version %u is needed", memory->block_name, what, header->layout_version, layout_version);
+        return IPM_RESULT_ERR_BAD_VERSION;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result internal_ipm_structure_map(ipm_memory* memory, const char* what, uint64_t size)
+{
+    if (memory->real_memory.size >= size)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    const ipm_result res = ipm_memory_sync(memory);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(&memory->ctx, "Could not map all of %s in block \"%s\", reason: %s (%s)", what, memory->block_name, ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    return res;
+}
+
+void* internal_ipm_structure_alloc_handle(const ipm_memory* memory, const char* what, size_t size)
+{
+    void* const handle = ipm_alloc(&memory->ctx, size);
+    if (!handle)
+    {
+        IPM_ERROR(&memory->ctx, "Could not allocate memory for the handle of %s", what);
+    }
+    return handle;
+}
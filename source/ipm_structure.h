@@ -0,0 +1,60 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_STRUCTURE_H
+#define IPM_STRUCTURE_H
+#include "ipm_memory_internal.h"
+#include "ipm_platform.h"
+#include <time.h>
+
+//  Helpers of the structures which format a whole block, such as queues, pools and heaps. Each names itself in errors
+//  with a noun phrase such as "a queue".
+
+static inline size_t round_size(size_t size)
+{
+    const size_t remainder = size % IPM_MEMORY_PAGE_SIZE;
+    if (remainder)
+    {
+        return size + (IPM_MEMORY_PAGE_SIZE - remainder);
+    }
+    return size;
+}
+
+static inline uint64_t align_line(uint64_t size)
+{
+    return (size + (IPM_CACHE_LINE_SIZE - 1)) & ~(uint64_t)(IPM_CACHE_LINE_SIZE - 1);
+}
+
+static inline uint64_t monotonic_time_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+//  Start of the header of every structure, which is all that is read before it is known to be there
+struct ipm_structure_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+};
+typedef struct ipm_structure_header_T ipm_structure_header;
+
+//  Checks that the handle maps the whole block with read-write access
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_structure_check_memory(const ipm_memory* memory, const char* what);
+
+//  Checks that the block holds the structure with the given magic and layout version, and is at least min_size bytes
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_structure_check_header(
+        const ipm_memory* memory, const char* what, uint32_t magic, uint32_t layout_version, size_t min_size);
+
+//  Maps the first size bytes of the block, which the creator of the structure may have grown after the handle mapped it
+IPM_INTERNAL_FUNCTION
+ipm_result internal_ipm_structure_map(ipm_memory* memory, const char* what, uint64_t size);
+
+IPM_INTERNAL_FUNCTION
+void* internal_ipm_structure_alloc_handle(const ipm_memory* memory, const char* what, size_t size);
+
+#endif //IPM_STRUCTURE_H
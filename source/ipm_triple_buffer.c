@@ -0,0 +1,191 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#include "ipm_triple_buffer_internal.h"
+#include "ipm_structure.h"
+
+//  Writer and readers never wait for each other. A reader marks the buffer it reads by counting itself among its readers
+//  and then checks that it is still the latest one, while the writer publishes a buffer before it checks the counts of
+//  the others, so whenever the writer misses a reader's mark, the reader sees the new buffer and moves on to it.
+
+static inline uint32_t latest_index(uint64_t latest)
+{
+    return (uint32_t)(latest & IPM_TRIPLE_BUFFER_MAX_COUNT);
+}
+
+static inline uint64_t latest_version(uint64_t latest)
+{
+    return latest >> IPM_TRIPLE_BUFFER_INDEX_BITS;
+}
+
+static ipm_result triple_buffer_handle_create(ipm_memory* memory, ipm_triple_buffer** p_buffer)
+{
+    ipm_triple_buffer_header* const header = memory->real_memory.memory;
+    ipm_triple_buffer* const buffer = internal_ipm_structure_alloc_handle(memory, "a triple buffer", sizeof(*buffer));
+    if (!buffer)
+    {
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    buffer->memory = memory;
+    buffer->header = header;
+    buffer->readers = (ipm_triple_buffer_readers*)((uint8_t*)header + align_line(sizeof(*header)));
+    buffer->buffers = (uint8_t*)header + header->buffers_offset;
+    buffer->writing = IPM_TRIPLE_BUFFER_NONE;
+    buffer->reading = IPM_TRIPLE_BUFFER_NONE;
+    *p_buffer = buffer;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result ipm_triple_buffer_create(ipm_memory* memory, size_t size, unsigned reader_count, ipm_triple_buffer** p_buffer)
+{
+    assert(size > 0);
+    assert(reader_count > 0);
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a triple buffer");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (reader_count > IPM_TRIPLE_BUFFER_MAX_COUNT - 2)
+    {
+        IPM_ERROR(&memory->ctx, "Triple buffer can have at most %u readers, but %u were requested", (unsigned)IPM_TRIPLE_BUFFER_MAX_COUNT - 2, reader_count);
+        return IPM_RESULT_ERR_BAD_SIZE;
+    }
+    //  One buffer is published, one is written, and each reader may hold on to a different older one
+    const uint64_t buffer_count = (uint64_t)reader_count + 2;
+    const uint64_t readers_offset = align_line(sizeof(ipm_triple_buffer_header));
+    const uint64_t buffers_offset = align_line(readers_offset + buffer_count * sizeof(ipm_triple_buffer_readers));
+    const uint64_t stride = align_line(size);
+    const size_t needed_size = round_size(buffers_offset + buffer_count * stride);
+    if (memory->real_memory.size < needed_size)
+    {
+        res = ipm_memory_resize_grow(memory, needed_size);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(&memory->ctx, "Could not grow the block to fit the triple buffer, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+
+    ipm_triple_buffer_header* const header = memory->real_memory.memory;
+    memset(header, 0, sizeof(*header));
+    header->layout_version = IPM_TRIPLE_BUFFER_LAYOUT_VERSION;
+    header->size = size;
+    header->buffer_count = buffer_count;
+    header->stride = stride;
+    header->buffers_offset = buffers_offset;
+    atomic_init(&header->latest, 0);
+    ipm_triple_buffer_readers* const readers = (ipm_triple_buffer_readers*)((uint8_t*)header + readers_offset);
+    for (uint64_t i = 0; i < buffer_count; ++i)
+    {
+        atomic_init(&readers[i].count, 0);
+    }
+    memset((uint8_t*)header + buffers_offset, 0, stride);
+    //  Magic is written last, so that the buffers are not opened before they are ready
+    atomic_store_explicit((_Atomic uint32_t*)&header->magic, IPM_TRIPLE_BUFFER_MAGIC, memory_order_release);
+
+    res = triple_buffer_handle_create(memory, p_buffer);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        header->magic = 0;
+    }
+    return res;
+}
+
+ipm_result ipm_triple_buffer_open(ipm_memory* memory, ipm_triple_buffer** p_buffer)
+{
+    ipm_result res = internal_ipm_structure_check_memory(memory, "a triple buffer");
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    res = internal_ipm_structure_check_header(memory, "a triple buffer", IPM_TRIPLE_BUFFER_MAGIC, IPM_TRIPLE_BUFFER_LAYOUT_VERSION, sizeof(ipm_triple_buffer_header));
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const ipm_triple_buffer_header* const header = memory->real_memory.memory;
+    res = internal_ipm_structure_map(memory, "a triple buffer", header->buffers_offset + header->buffer_count * header->stride);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    return triple_buffer_handle_create(memory, p_buffer);
+}
+
+void ipm_triple_buffer_close(ipm_triple_buffer* buffer)
+{
+    if (buffer->reading != IPM_TRIPLE_BUFFER_NONE)
+    {
+        ipm_triple_buffer_read_end(buffer);
+    }
+    ipm_free(&buffer->memory->ctx, buffer);
+}
+
+size_t ipm_triple_buffer_size(const ipm_triple_buffer* buffer)
+{
+    return buffer->header->size;
+}
+
+ipm_result ipm_triple_buffer_write_begin(ipm_triple_buffer* buffer, void** p_data)
+{
+    ipm_triple_buffer_header* const header = buffer->header;
+    if (buffer->writing == IPM_TRIPLE_BUFFER_NONE)
+    {
+        const uint32_t published = latest_index(atomic_load(&header->latest));
+        for (uint32_t i = 0; i < header->buffer_count; ++i)
+        {
+            if (i != published && atomic_load(&buffer->readers[i].count) == 0)
+            {
+                buffer->writing = i;
+                break;
+            }
+        }
+        if (buffer->writing == IPM_TRIPLE_BUFFER_NONE)
+        {
+            IPM_ERROR(&buffer->memory->ctx, "Every buffer is being read, since more readers read at once than the triple buffer was made for");
+            return IPM_RESULT_ERR_REGION_CLAIMED;
+        }
+    }
+    *p_data = buffer->buffers + (uint64_t)buffer->writing * header->stride;
+    return IPM_RESULT_SUCCESS;
+}
+
+uint64_t ipm_triple_buffer_publish(ipm_triple_buffer* buffer)
+{
+    assert(buffer->writing != IPM_TRIPLE_BUFFER_NONE);
+    ipm_triple_buffer_header* const header = buffer->header;
+    const uint64_t version = latest_version(atomic_load_explicit(&header->latest, memory_order_relaxed)) + 1;
+    atomic_store(&header->latest, version << IPM_TRIPLE_BUFFER_INDEX_BITS | buffer->writing);
+    buffer->writing = IPM_TRIPLE_BUFFER_NONE;
+    return version;
+}
+
+uint64_t ipm_triple_buffer_read_begin(ipm_triple_buffer* buffer, const void** p_data)
+{
+    assert(buffer->reading == IPM_TRIPLE_BUFFER_NONE);
+    ipm_triple_buffer_header* const header = buffer->header;
+    uint64_t latest = atomic_load(&header->latest);
+    for (;;)
+    {
+        const uint32_t index = latest_index(latest);
+        atomic_fetch_add(&buffer->readers[index].count, 1);
+        const uint64_t current = atomic_load(&header->latest);
+        if (current == latest)
+        {
+            buffer->reading = index;
+            *p_data = buffer->buffers + (uint64_t)index * header->stride;
+            return latest_version(latest);
+        }
+        //  Writer published another buffer meanwhile, and may already be writing to this one
+        atomic_fetch_sub_explicit(&buffer->readers[index].count, 1, memory_order_relaxed);
+        latest = current;
+    }
+}
+
+void ipm_triple_buffer_read_end(ipm_triple_buffer* buffer)
+{
+    assert(buffer->reading != IPM_TRIPLE_BUFFER_NONE);
+    atomic_fetch_sub_explicit(&buffer->readers[buffer->reading].count, 1, memory_order_release);
+    buffer->reading = IPM_TRIPLE_BUFFER_NONE;
+}
@@ -0,0 +1,50 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_TRIPLE_BUFFER_INTERNAL_H
+#define IPM_TRIPLE_BUFFER_INTERNAL_H
+#include "../include/ipm/ipm_triple_buffer.h"
+#include "ipm_memory_internal.h"
+
+enum
+{
+    IPM_TRIPLE_BUFFER_MAGIC = 0x4C505254,   //  Reads as "TRPL" on little-endian
+    IPM_TRIPLE_BUFFER_LAYOUT_VERSION = 1,
+    IPM_TRIPLE_BUFFER_INDEX_BITS = 16,      //  Lower bits of the latest state hold the buffer index, the rest the version
+    IPM_TRIPLE_BUFFER_MAX_COUNT = (1 << IPM_TRIPLE_BUFFER_INDEX_BITS) - 1,
+    IPM_TRIPLE_BUFFER_NONE = UINT32_MAX,    //  Index of the buffer when the handle is not reading or writing one
+};
+
+//  Number of readers of each buffer is kept on its own cache line
+struct ipm_triple_buffer_readers_T
+{
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint32_t count;
+};
+typedef struct ipm_triple_buffer_readers_T ipm_triple_buffer_readers;
+
+//  Placed at the start of the block, followed by the reader counts of the buffers and the buffers themselves
+struct ipm_triple_buffer_header_T
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t size;
+    uint64_t buffer_count;
+    uint64_t stride;            //  Distance between the starts of two neighbouring buffers
+    uint64_t buffers_offset;    //  Offset of the first buffer from the start of the block
+
+    _Alignas(IPM_CACHE_LINE_SIZE) _Atomic uint64_t latest; //  Version and index of the last published buffer
+};
+typedef struct ipm_triple_buffer_header_T ipm_triple_buffer_header;
+
+struct ipm_triple_buffer_T
+{
+    ipm_memory* memory;
+    ipm_triple_buffer_header* header;
+    ipm_triple_buffer_readers* readers;
+    uint8_t* buffers;
+    uint32_t writing;           //  Index of the buffer being written through the handle
+    uint32_t reading;           //  Index of the buffer being read through the handle
+};
+
+#endif //IPM_TRIPLE_BUFFER_INTERNAL_H
@@ -0,0 +1,82 @@
+//
+// Created by jan on 19.10.2026.
+//
+
+#ifndef IPM_LOCKFREE_H
+#define IPM_LOCKFREE_H
+#include "internal.h"
+
+//  Lock-free stack of nodes within shared memory. Nodes are identified by their offset from a base address, which may
+//  differ between processes, and the first 8 bytes of each node hold the offset of the next one. Offset 0 marks the end
+//  of the stack, so no node may be placed there. Upper bits of the head count the changes to it, so that a node which is
+//  popped and pushed back while another process is popping it (the ABA problem) does not corrupt the stack.
+
+enum
+{
+    IPM_LOCKFREE_OFFSET_BITS = 48,
+    IPM_LOCKFREE_OFFSET_MASK = (1ull << IPM_LOCKFREE_OFFSET_BITS) - 1,
+    IPM_LOCKFREE_UNMAPPED = IPM_LOCKFREE_OFFSET_MASK + 1, //  Returned by pop for a node which is not yet mapped
+};
+
+typedef _Atomic uint64_t ipm_lockfree_stack;
+
+static inline _Atomic uint64_t* lockfree_stack_node_next(void* base, uint64_t offset)
+{
+    return (_Atomic uint64_t*)((uint8_t*)base + offset);
+}
+
+static inline uint64_t lockfree_stack_next_head(uint64_t head, uint64_t offset)
+{
+    return ((head & ~(uint64_t)IPM_LOCKFREE_OFFSET_MASK) + (1ull << IPM_LOCKFREE_OFFSET_BITS)) | offset;
+}
+
+static inline void lockfree_stack_init(ipm_lockfree_stack* stack)
+{
+    atomic_init(stack, 0);
+}
+
+static inline void lockfree_stack_push(ipm_lockfree_stack* stack, void* base, uint64_t offset)
+{
+    assert(offset != 0 && (offset & ~(uint64_t)IPM_LOCKFREE_OFFSET_MASK) == 0);
+    _Atomic uint64_t* const next = lockfree_stack_node_next(base, offset);
+    uint64_t head = atomic_load_explicit(stack, memory_order_relaxed);
+    do
+    {
+        atomic_store_explicit(next, head & IPM_LOCKFREE_OFFSET_MASK, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(
+            stack, &head, lockfree_stack_next_head(head, offset), memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * Pops the node from the top of the stack. Nodes at offsets above limit are not touched, since memory of another process
+ * which grew the block may not be mapped yet by this one, so that the caller can map it and try again.
+ * @param limit Highest offset of a node which lies within the memory at base, or IPM_LOCKFREE_OFFSET_MASK if all do.
+ * @return Offset of the popped node, 0 if the stack was empty, or IPM_LOCKFREE_UNMAPPED if the node on top lies above the
+ * limit.
+ */
+static inline uint64_t lockfree_stack_pop(ipm_lockfree_stack* stack, void* base, uint64_t limit)
+{
+    uint64_t head = atomic_load_explicit(stack, memory_order_acquire);
+    for (;;)
+    {
+        const uint64_t offset = head & IPM_LOCKFREE_OFFSET_MASK;
+        if (offset == 0)
+        {
+            return 0;
+        }
+        if (offset > limit)
+        {
+            return IPM_LOCKFREE_UNMAPPED;
+        }
+        //  Node may have been popped and reused meanwhile, in which case this is garbage, but the exchange then fails
+        const uint64_t next = atomic_load_explicit(lockfree_stack_node_next(base, offset), memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(
+                stack, &head, lockfree_stack_next_head(head, next & IPM_LOCKFREE_OFFSET_MASK), memory_order_acquire,
+                memory_order_acquire))
+        {
+            return offset;
+        }
+    }
+}
+
+#endif //IPM_LOCKFREE_H
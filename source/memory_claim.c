@@ -8,23 +8,8 @@ ipm_bool claims_conflict(const ipm_memory_claim* claim_1, const ipm_memory_claim
 {
     if (claim_1->proc_id == claim_2->proc_id) return 0;
     if (claim_1->access == IPM_ACCESS_MODE_READ_ONLY && claim_2->access == IPM_ACCESS_MODE_READ_ONLY) return 0;
-    if (claim_1->offset > claim_2->offset)
-    {
-        if (claim_2->offset < claim_1->offset + claim_1->size)
-        {
-            return 1;
-        }
-        return 0;
-    }
-    else if (claim_1->offset < claim_2->offset)
-    {
-        if (claim_1->offset < claim_2->offset + claim_2->size)
-        {
-            return 1;
-        }
-        return 0;
-    }
-    return 1;
+    //  Claims conflict only if their regions overlap
+    return claim_1->offset < claim_2->offset + claim_2->size && claim_2->offset < claim_1->offset + claim_1->size;
 }
 
 ipm_bool claim_encompasses_other(const ipm_memory_claim* claim_1, const ipm_memory_claim* claim_2)
@@ -36,27 +21,12 @@ ipm_bool claim_encompasses_other(const ipm_memory_claim* claim_1, const ipm_memo
 
 ipm_result claim_add_to_list(const ipm_memory_claim* claim, ipm_claim_list* list)
 {
-    //  Take free space
-//    ipm_result wait_res = ipm_semaphore_wait(&list->free_sem);
-//    if (wait_res != IPM_RESULT_SUCCESS)
-//    {
-//        return wait_res;
-//    }
-
-    //  Take ownership of the list for a moment
-//    ipm_result wait_res = ipm_mutex_lock(&list->list_mutex);
-//    if (wait_res != IPM_RESULT_SUCCESS)
-//    {
-//        //  Return free space
-//        ipm_semaphore_post(&list->free_sem);
-//    }
+    //  List must be locked by the caller
 
     //  Check we're not out of bounds
     assert(list->capacity > list->count);
     if (list->count >= list->capacity)
     {
-//        ipm_semaphore_post(&list->free_sem);
-        ipm_mutex_unlock(&list->list_mutex);
         return IPM_RESULT_ERR_LIST_SIZE_MISMATCH;
     }
 
@@ -73,7 +43,7 @@ ipm_result claim_add_to_list(const ipm_memory_claim* claim, ipm_claim_list* list
     //  Shift other elements
     if (pos != list->count)
     {
-        memmove(list->claims + pos + 1, list->claims + pos, sizeof(*list->claims) * (list->count - pos - 1));
+        memmove(list->claims + pos + 1, list->claims + pos, sizeof(*list->claims) * (list->count - pos));
     }
 
     //  Insert in list
@@ -82,35 +52,14 @@ ipm_result claim_add_to_list(const ipm_memory_claim* claim, ipm_claim_list* list
     (void) prev_count;
     assert(prev_count < list->capacity);
 
-    //  Post to relevant semaphores
-//    ipm_mutex_unlock(&list->list_mutex);
-
     return IPM_RESULT_SUCCESS;
 }
 
-ipm_result claim_remove_from_list(ipm_id claim_id, ipm_claim_list* list)
+ipm_result claim_remove_from_list(ipm_id claim_id, ipm_claim_list* list, ipm_memory_claim* p_removed)
 {
-    //  Lock for exclusive access
-//    ipm_result res = ipm_mutex_lock(&list->list_mutex);
-//    if (res != IPM_RESULT_SUCCESS)
-//    {
-//        return res;
-//    }
-//    unsigned count = ipm_semaphore_count(&list->free_sem);
-    unsigned count = atomic_fetch_sub(&list->count, 1);
-    assert(count < list->capacity && count > 0);
-//    if (count != list->count)
-//    {
-//        res = IPM_RESULT_ERR_LIST_SIZE_MISMATCH;
-//        goto end;
-//    }
-    ipm_result res = IPM_RESULT_SUCCESS;
-    if (count == 0)
-    {
-        //  No claims are currently active
-        res = IPM_RESULT_ERR_INVALID_CLAIM;
-        goto end;
-    }
+    //  List must be locked by the caller
+    const size_t count = list->count;
+    assert(count <= list->capacity);
 
     unsigned pos;
     for (pos = 0; pos < count; ++pos)
@@ -121,25 +70,146 @@ ipm_result claim_remove_from_list(ipm_id claim_id, ipm_claim_list* list)
         }
     }
 
-    if (pos > count)
+    if (pos == count)
     {
         //  Claim was not found in the list
-        res = IPM_RESULT_ERR_INVALID_CLAIM;
-        goto end;
+        return IPM_RESULT_ERR_INVALID_CLAIM;
     }
 
-//    const ipm_memory_claim claim = list->claims[pos];
+    if (p_removed)
+    {
+        *p_removed = list->claims[pos];
+    }
     //  Remove claim from the list
     if (pos + 1 != count)
     {
-        memmove(list->claims + pos, list->claims + pos + 1, sizeof(*list->claims) * ((count - 1) - pos - 1));
+        memmove(list->claims + pos, list->claims + pos + 1, sizeof(*list->claims) * (count - pos - 1));
+    }
+    (void)atomic_fetch_sub(&list->count, 1);
+
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result claim_list_acquire(
+        const ipm_context* context, ipm_claim_list* list, ipm_access_mode access, size_t offset, size_t size,
+        ipm_id proc_id, const size_t* p_size_limit, ipm_id* p_claim_id)
+{
+    ipm_result res = ipm_mutex_lock(&list->list_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res),
+                  ipm_result_to_msg(res));
+        return res;
     }
-    //  Post to free semaphore to indicate released claim in the list
-//    ipm_semaphore_post(&list->free_sem);
 
-end:
-    //  Release exclusive access
-//    ipm_mutex_unlock(&list->list_mutex);
+    //  Check if there are any conflicting claims currently active
+    const ipm_memory_claim claim =
+            {
+            .offset = offset,
+            .size = size,
+            .access = access,
+            .claim_id = atomic_fetch_add(&list->claim_counter, 1),
+            .proc_id = proc_id,
+            };
+    for (;;)
+    {
+        //  Limit is checked while the list is locked, and again after each wait, since another process may change it
+        if (p_size_limit && *p_size_limit < offset + size)
+        {
+            ipm_mutex_unlock(&list->list_mutex);
+            IPM_ERROR(context, "Memory block has the size of %zu, so region [%zu, %zu) can not be claimed", *p_size_limit, offset, offset + size);
+            return IPM_RESULT_ERR_BAD_VALUE;
+        }
+        unsigned i;
+        for (i = 0; i < list->count; ++i)
+        {
+            if (claims_conflict(&claim, list->claims + i))
+            {
+                break;
+            }
+        }
+        if (i == list->count && list->count != list->capacity)
+        {
+            //  No claims conflict and there's enough space
+            break;
+        }
+        res = ipm_condition_wait(&list->list_cnd, &list->list_mutex);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(context, "Could not wait on condition variable, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            ipm_mutex_unlock(&list->list_mutex);
+            return res;
+        }
+    }
+
+    res = claim_add_to_list(&claim, list);
+    ipm_mutex_unlock(&list->list_mutex);
+
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not add memory claim to list, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+    *p_claim_id = claim.claim_id;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result claim_list_release(
+        const ipm_context* context, ipm_claim_list* list, ipm_id claim_id, ipm_memory_claim* p_released)
+{
+    ipm_result res = ipm_mutex_lock(&list->list_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not lock access list mutex, reason: %s (%s)", ipm_result_to_str(res),
+                  ipm_result_to_msg(res));
+        return res;
+    }
+
+    res = claim_remove_from_list(claim_id, list, p_released);
+    ipm_mutex_unlock(&list->list_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not remove memory claim from list, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    else
+    {
+        //  Signal that a claim was removed from the list, so threads should check if they can now add any of their claims.
+        //  All of them are woken up, since they may be waiting for different claims.
+        ipm_condition_broadcast(&list->list_cnd);
+    }
+
+    return res;
+}
+
+ipm_result claim_list_release_all(const ipm_context* context, ipm_claim_list* list, ipm_id proc_id, ipm_bool* p_released)
+{
+    ipm_result res = ipm_mutex_lock(&list->list_mutex);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not lock the claim list mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+        return res;
+    }
+
+    ipm_bool removed = 0;
+    for (int i = 0; i < (int)list->count; ++i)
+    {
+        if (proc_id == 0 || list->claims[i].proc_id == proc_id)
+        {
+            (void)claim_remove_from_list(list->claims[i].claim_id, list, NULL);
+            removed = 1;
+            i -= 1;
+        }
+    }
+
+    ipm_mutex_unlock(&list->list_mutex);
+    if (removed)
+    {
+        ipm_condition_broadcast(&list->list_cnd);
+    }
+    if (p_released)
+    {
+        *p_released = removed;
+    }
     return res;
 }
 
@@ -197,7 +267,8 @@ ipm_result claim_list_init(ipm_claim_list* list, size_t capacity)
     }
     list->capacity = capacity;
     list->count = 0;
-    list->claim_counter = 0;
+    //  Claim ID of 0 is given out for claims which are not in the list
+    list->claim_counter = 1;
     return res;
 }
 
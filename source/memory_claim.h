@@ -21,12 +21,14 @@ typedef struct ipm_memory_claim_T ipm_memory_claim;
 struct ipm_claim_list_T
 {
 //    ipm_sem free_sem;           //  Semaphore which counts the number of free entries
-    ipm_mut list_mutex;         //  Mutex for the buffer
-    ipm_cnd list_cnd;           //  Conditional variable used to indicate the state was updated
-    size_t count;               //  Number of claims (redundant)
+    //  Mutex, condition variable, counters and claims are on separate cache lines, so that waiting processes and those
+    //  only reading the count do not take them from the one holding the mutex
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_mut list_mutex;   //  Mutex for the buffer
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_cnd list_cnd;     //  Conditional variable used to indicate the state was updated
+    _Alignas(IPM_CACHE_LINE_SIZE) size_t count;         //  Number of claims (redundant)
     size_t capacity;            //  Capacity of claims (redundant)
     size_t claim_counter;       //  Counts the number of claims made
-    ipm_memory_claim claims[];  //  The claims themselves
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_memory_claim claims[];  //  The claims themselves
 };
 typedef struct ipm_claim_list_T ipm_claim_list;
 
@@ -40,7 +42,19 @@ IPM_INTERNAL_FUNCTION
 ipm_result claim_add_to_list(const ipm_memory_claim* claim, ipm_claim_list* list);
 
 IPM_INTERNAL_FUNCTION
-ipm_result claim_remove_from_list(ipm_id claim_id, ipm_claim_list* list);
+ipm_result claim_remove_from_list(ipm_id claim_id, ipm_claim_list* list, ipm_memory_claim* p_removed);
+
+IPM_INTERNAL_FUNCTION
+ipm_result claim_list_acquire(
+        const ipm_context* context, ipm_claim_list* list, ipm_access_mode access, size_t offset, size_t size,
+        ipm_id proc_id, const size_t* p_size_limit, ipm_id* p_claim_id);
+
+IPM_INTERNAL_FUNCTION
+ipm_result claim_list_release(
+        const ipm_context* context, ipm_claim_list* list, ipm_id claim_id, ipm_memory_claim* p_released);
+
+IPM_INTERNAL_FUNCTION
+ipm_result claim_list_release_all(const ipm_context* context, ipm_claim_list* list, ipm_id proc_id, ipm_bool* p_released);
 
 IPM_INTERNAL_FUNCTION
 ipm_result claims_iterate(ipm_claim_list* list, int(*callback)(const ipm_memory_claim* claim, void* param), void* param);
@@ -4,26 +4,378 @@
 
 #include "shared_memory.h"
 #include "internal.h"
+#include <time.h>
 
 #ifdef IPM_PLATFORM_POSIX
 
-static inline void make_block_name_based_on_id(char* buffer, size_t buffer_size, const char* block_name, ipm_id id)
+enum
 {
-    (void) snprintf(buffer, buffer_size, "/%.*s-%#016lX", IPM_MAX_NAME_LEN, block_name, id);
+    BLOCK_LOCK_OPEN = 0,    //  Byte of a persistent block's file locked exclusively by a process opening it
+    BLOCK_LOCK_IN_USE = 1,  //  Byte of a persistent block's file locked shared by all processes which have it open
+    BLOCK_LOCK_CREATING = 2,//  Byte locked exclusively by the creator of a block until it is initialized
+};
+
+enum
+{
+    IPM_MAPPING_MIN_RESERVATION = 1 << 26,  //  Smallest address range reserved for the mapping of a block
+    IPM_CREATION_CHECK_INTERVAL_MS = 100,   //  How often openers check whether the creator of a block is still alive
+};
+
+static inline void make_block_name_based_on_id(
+        char* buffer, size_t buffer_size, const char* directory, const char* block_name, ipm_id id)
+{
+    if (directory)
+    {
+        (void) snprintf(buffer, buffer_size, "%.*s/%.*s-%#016lX", IPM_MAX_DIRECTORY_LEN, directory, IPM_MAX_NAME_LEN, block_name, id);
+    }
+    else
+    {
+        (void) snprintf(buffer, buffer_size, "/%.*s-%#016lX", IPM_MAX_NAME_LEN, block_name, id);
+    }
+}
+
+static inline int open_block_object(const char* directory, const char* name, int flags)
+{
+    const mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH;
+    if (directory)
+    {
+        return open(name, flags, mode);
+    }
+    return shm_open(name, flags, mode);
+}
+
+static inline int unlink_block_object(const char* directory, const char* name)
+{
+    if (directory)
+    {
+        return unlink(name);
+    }
+    return shm_unlink(name);
+}
+
+static inline int lock_block_byte(int fd, short type, off_t byte, ipm_bool wait)
+{
+    //  Open file description locks are preferred, since they are not dropped when another descriptor of the same file is
+    //  closed by the process
+    struct flock lock = {.l_type = type, .l_whence = SEEK_SET, .l_start = byte, .l_len = 1};
+#ifdef F_OFD_SETLK
+    return fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &lock);
+#else
+    return fcntl(fd, wait ? F_SETLKW : F_SETLK, &lock);
+#endif
+}
+
+_Static_assert(sizeof(ipm_shared_memory_header) <= IPM_MEMORY_PAGE_SIZE, "Header must fit in its page");
+
+static inline uint64_t monotonic_time_ms(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static ipm_bool block_object_is_abandoned(int fd)
+{
+    //  Creator keeps the byte locked until it has initialized the block, so if it can be locked, the creator is gone
+    if (lock_block_byte(fd, F_RDLCK, BLOCK_LOCK_CREATING, 0) < 0)
+    {
+        return 0;
+    }
+    (void)lock_block_byte(fd, F_UNLCK, BLOCK_LOCK_CREATING, 0);
+    struct stat stat_buffer;
+    if (fstat(fd, &stat_buffer) < 0)
+    {
+        return 0;
+    }
+    if ((size_t)stat_buffer.st_size < IPM_MEMORY_PAGE_SIZE)
+    {
+        //  Creator might not have locked the byte yet, unless the object has existed for longer than the open timeout
+        struct timespec now;
+        (void)clock_gettime(CLOCK_REALTIME, &now);
+        return (int64_t)(now.tv_sec - stat_buffer.st_ctim.tv_sec) * 1000 > IPM_DEFAULT_OPEN_TIMEOUT_MS;
+    }
+    uint32_t state;
+    if (pread(fd, &state, sizeof(state), offsetof(ipm_shared_memory_header, init_state)) != sizeof(state))
+    {
+        return 0;
+    }
+    return state == IPM_SHARED_MEMORY_STATE_CREATING;
+}
+
+static ipm_bool remove_abandoned_object(const ipm_context* context, const char* directory, const char* name, int fd)
+{
+    //  Object is only removed if the name still refers to it, since another process may have already replaced it
+    const int current_fd = open_block_object(directory, name, O_RDONLY);
+    if (current_fd < 0)
+    {
+        return 0;
+    }
+    struct stat abandoned, current;
+    ipm_bool removed = 0;
+    if (fstat(fd, &abandoned) == 0 && fstat(current_fd, &current) == 0 && abandoned.st_dev == current.st_dev &&
+        abandoned.st_ino == current.st_ino)
+    {
+        IPM_ERROR(context, "Removing block object %s, since its creator died before initializing it", name);
+        removed = unlink_block_object(directory, name) == 0;
+    }
+    close(current_fd);
+    return removed;
+}
+
+static ipm_result check_creation_progress(
+        const ipm_context* context, const char* directory, const char* name, int fd, uint64_t deadline)
+{
+    if (block_object_is_abandoned(fd))
+    {
+        (void)remove_abandoned_object(context, directory, name, fd);
+        return IPM_RESULT_ERR_DOES_NOT_EXIST;
+    }
+    if (monotonic_time_ms() >= deadline)
+    {
+        IPM_ERROR(context, "Block object %s was not initialized within %u ms", name, (unsigned)IPM_DEFAULT_OPEN_TIMEOUT_MS);
+        return IPM_RESULT_ERR_TIMED_OUT;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+static ipm_bool take_over_abandoned_object(const ipm_context* context, const char* directory, const char* name)
+{
+    ipm_bool removed = 0;
+    const int fd = open_block_object(directory, name, O_RDWR);
+    if (fd >= 0)
+    {
+        removed = block_object_is_abandoned(fd) && remove_abandoned_object(context, directory, name, fd);
+        close(fd);
+    }
+    errno = EEXIST;
+    return removed;
+}
+
+static int hint_to_advice(ipm_memory_hint hint)
+{
+    switch (hint)
+    {
+    case IPM_MEMORY_HINT_NORMAL:
+        return MADV_NORMAL;
+    case IPM_MEMORY_HINT_SEQUENTIAL:
+        return MADV_SEQUENTIAL;
+    case IPM_MEMORY_HINT_RANDOM:
+        return MADV_RANDOM;
+    case IPM_MEMORY_HINT_WILL_NEED:
+        return MADV_WILLNEED;
+    case IPM_MEMORY_HINT_DONT_NEED:
+        return MADV_DONTNEED;
+#ifdef MADV_COLD
+    case IPM_MEMORY_HINT_COLD:
+        return MADV_COLD;
+#endif
+#ifdef MADV_PAGEOUT
+    case IPM_MEMORY_HINT_PAGE_OUT:
+        return MADV_PAGEOUT;
+#endif
+    default:
+        return -1;
+    }
+}
+
+static void apply_hints(const ipm_shared_memory_block* block, const ipm_shared_memory_hint* hints, uint32_t count)
+{
+    //  Hints are only advisory, so failing to apply them is not an error
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const ipm_shared_memory_hint hint = hints[i];
+        const int advice = hint_to_advice(hint.hint);
+        if (advice < 0 || hint.offset >= block->size)
+        {
+            continue;
+        }
+        const size_t size = hint.size < block->size - hint.offset ? hint.size : block->size - hint.offset;
+        (void)madvise((uint8_t*)block->memory + hint.offset, size, advice);
+    }
+}
+
+static void apply_all_hints(const ipm_shared_memory_block* block)
+{
+    //  Hints in the header are read without locking it, since the caller may already hold it
+    ipm_shared_memory_hint hints[IPM_SHARED_MEMORY_MAX_HINTS];
+    uint32_t count = atomic_load(&block->header->hint_count);
+    if (count > IPM_SHARED_MEMORY_MAX_HINTS)
+    {
+        count = IPM_SHARED_MEMORY_MAX_HINTS;
+    }
+    memcpy(hints, block->header->hints, count * sizeof(*hints));
+    apply_hints(block, hints, count);
+    apply_hints(block, block->hints, block->hint_count);
+}
+
+static void record_hint(ipm_shared_memory_hint* hints, uint32_t* p_count, const ipm_shared_memory_hint* hint)
+{
+    //  Hint for the same region replaces the previous one, otherwise the oldest hint is dropped when there is no room
+    uint32_t count = *p_count;
+    uint32_t pos;
+    for (pos = 0; pos < count; ++pos)
+    {
+        if (hints[pos].offset == hint->offset && hints[pos].size == hint->size)
+        {
+            break;
+        }
+    }
+    if (pos == count && count == IPM_SHARED_MEMORY_MAX_HINTS)
+    {
+        pos = 0;
+    }
+    if (pos != count)
+    {
+        memmove(hints + pos, hints + pos + 1, sizeof(*hints) * (count - pos - 1));
+        count -= 1;
+    }
+    hints[count] = *hint;
+    *p_count = count + 1;
+}
+
+static inline int access_protection(ipm_access_mode access)
+{
+    return access == IPM_ACCESS_MODE_READ_ONLY ? PROT_READ : PROT_READ|PROT_WRITE;
+}
+
+static void clip_protected_ranges(ipm_shared_memory_block* block)
+{
+    //  Ranges which are past the end of a shrunk block are dropped
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < block->protected_count; ++i)
+    {
+        ipm_shared_memory_range range = block->protected_ranges[i];
+        if (range.offset >= block->size)
+        {
+            continue;
+        }
+        if (range.offset + range.size > block->size)
+        {
+            range.size = block->size - range.offset;
+        }
+        block->protected_ranges[count++] = range;
+    }
+    block->protected_count = count;
+}
+
+static ipm_bool update_protected_ranges(
+        const ipm_shared_memory_block* block, size_t begin, size_t end, ipm_bool read_only,
+        ipm_shared_memory_range* ranges, uint32_t* p_count)
+{
+    //  Ranges are kept sorted and disjoint, so the new one is first cut out of all others, then added back if needed
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < block->protected_count; ++i)
+    {
+        const ipm_shared_memory_range range = block->protected_ranges[i];
+        const size_t range_end = range.offset + range.size;
+        if (range_end <= begin || range.offset >= end)
+        {
+            ranges[count++] = range;
+        }
+        else
+        {
+            if (range.offset < begin)
+            {
+                ranges[count++] = (ipm_shared_memory_range){.offset = range.offset, .size = begin - range.offset};
+            }
+            if (range_end > end)
+            {
+                ranges[count++] = (ipm_shared_memory_range){.offset = end, .size = range_end - end};
+            }
+        }
+    }
+    if (read_only)
+    {
+        uint32_t insert_at = 0;
+        while (insert_at < count && ranges[insert_at].offset < begin)
+        {
+            insert_at += 1;
+        }
+        memmove(ranges + insert_at + 1, ranges + insert_at, sizeof(*ranges) * (count - insert_at));
+        ranges[insert_at] = (ipm_shared_memory_range){.offset = begin, .size = end - begin};
+        count += 1;
+        //  Neighbours which touch the new range are merged with it
+        uint32_t merged = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (merged && ranges[merged - 1].offset + ranges[merged - 1].size == ranges[i].offset)
+            {
+                ranges[merged - 1].size += ranges[i].size;
+            }
+            else
+            {
+                ranges[merged++] = ranges[i];
+            }
+        }
+        count = merged;
+    }
+    if (count > IPM_SHARED_MEMORY_MAX_PROTECTED_RANGES)
+    {
+        return 0;
+    }
+    *p_count = count;
+    return 1;
+}
+
+static inline size_t reservation_size(size_t total_size)
+{
+    //  Address range is reserved with room to spare, so that the block can grow without the mapping being moved
+    const size_t reserved = 2 * total_size;
+    return reserved > IPM_MAPPING_MIN_RESERVATION ? reserved : IPM_MAPPING_MIN_RESERVATION;
+}
+
+static void* map_block_object(int fd, size_t total_size, void* address, size_t reserve, size_t* p_reserved)
+{
+    //  Object which has to be at a specific address must not replace any existing mapping
+    const size_t reserved = reserve ? reserve : reservation_size(total_size);
+#ifdef MAP_FIXED_NOREPLACE
+    const int fixed_flags = address ? MAP_FIXED_NOREPLACE : 0;
+#else
+    const int fixed_flags = 0;
+#endif
+    uint8_t* const base = mmap(address, reserved, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|fixed_flags, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return MAP_FAILED;
+    }
+    if (address && base != address)
+    {
+        //  Kernels without MAP_FIXED_NOREPLACE only take the address as a hint
+        (void)munmap(base, reserved);
+        errno = EEXIST;
+        return MAP_FAILED;
+    }
+    //  Header, metadata and data are all mapped at once, at the start of the reserved range
+    if (mmap(base, total_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        const int error = errno;
+        (void)munmap(base, reserved);
+        errno = error;
+        return MAP_FAILED;
+    }
+    *p_reserved = reserved;
+    return base;
 }
 
 ipm_result shared_memory_block_create(
-        const ipm_context* context, const char* block_name, ipm_id id, size_t size, ipm_access_mode access,
-        ipm_shared_memory_block* p_block)
+        const ipm_context* context, const char* directory, const char* block_name, ipm_id id, size_t metadata_size,
+        size_t size, ipm_access_mode access, ipm_result (* initialize)(ipm_shared_memory_block* block, void* param),
+        void* param, const ipm_shared_memory_placement* placement, ipm_shared_memory_block* p_block)
 {
     const size_t name_len = strlen(block_name);
     assert((size & (IPM_MEMORY_PAGE_SIZE_MASK)) == 0);
+    assert((metadata_size & (IPM_MEMORY_PAGE_SIZE_MASK)) == 0);
     assert(size > 0);
     assert(name_len <= IPM_MAX_NAME_LEN);
-    char name_buffer[IPM_MAX_NAME_LEN + 32];
-    make_block_name_based_on_id(name_buffer, sizeof(name_buffer), block_name, id);
-    const int fd = shm_open(name_buffer, O_RDWR | O_CREAT | O_EXCL,  //  Need write permission to set size with ftruncate
-                            S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH);
+    assert(!directory || strlen(directory) <= IPM_MAX_DIRECTORY_LEN);
+    char name_buffer[IPM_MAX_DIRECTORY_LEN + IPM_MAX_NAME_LEN + 32];
+    make_block_name_based_on_id(name_buffer, sizeof(name_buffer), directory, block_name, id);
+    int fd = open_block_object(directory, name_buffer, O_RDWR | O_CREAT | O_EXCL);  //  Need write permission to set size with ftruncate
+    if (fd < 0 && errno == EEXIST && take_over_abandoned_object(context, directory, name_buffer))
+    {
+        //  Object left behind by a creator which died before initializing it was removed, so creation is retried
+        fd = open_block_object(directory, name_buffer, O_RDWR | O_CREAT | O_EXCL);
+    }
     if (fd < 0)
     {
         if (errno == EEXIST)
@@ -36,6 +388,7 @@ ipm_result shared_memory_block_create(
         case EACCES:
             return IPM_RESULT_ERR_ACCESS;
         case EINVAL:
+        case ENOTDIR:
             return IPM_RESULT_ERR_BAD_VALUE;
         case EMFILE:
             return IPM_RESULT_ERR_MAX_FDS;
@@ -43,17 +396,36 @@ ipm_result shared_memory_block_create(
             return IPM_RESULT_ERR_MAX_FDS_SYS;
         case ENAMETOOLONG:
             return IPM_RESULT_ERR_NAME_TOO_LONG;
+        case ENOENT:
+            return IPM_RESULT_ERR_DOES_NOT_EXIST;
+        case EROFS:
+            return IPM_RESULT_ERR_BAD_FS;
         default:
             return IPM_RESULT_ERR_OS_UNEXPECTED;
         }
     }
+    //  Lock is released once the block is initialized, or when the creator dies, which lets openers tell the two apart
+    if (lock_block_byte(fd, F_WRLCK, BLOCK_LOCK_CREATING, 0) < 0 ||
+        (directory && lock_block_byte(fd, F_RDLCK, BLOCK_LOCK_IN_USE, 0) < 0))
+    {
+        IPM_ERROR(context, "Could not lock the block object, reason: %s", strerror(errno));
+        close(fd);
+        (void)unlink_block_object(directory, name_buffer);
+        return IPM_RESULT_ERR_BAD_FS;
+    }
 
-    const int truc_res = ftruncate(fd, (off_t) (size + IPM_MEMORY_PAGE_SIZE));
+    //  Object is laid out as the header page, followed by the metadata and then the data
+    const size_t data_offset = IPM_MEMORY_PAGE_SIZE + metadata_size;
+    const size_t total_size = data_offset + size;
+    //  Block at a fixed address reserves room for its largest size, since it can never be moved
+    const size_t fixed_reserved = placement ? data_offset + placement->max_size : 0;
+    assert(!placement || placement->max_size >= size);
+    const int truc_res = ftruncate(fd, (off_t) total_size);
     if (truc_res < 0)
     {
-        IPM_ERROR(context, "Could not truncate shared memory's FD to %zu bytes, reason: %s", (size + IPM_MEMORY_PAGE_SIZE), strerror(errno));
+        IPM_ERROR(context, "Could not truncate shared memory's FD to %zu bytes, reason: %s", total_size, strerror(errno));
         close(fd);
-        (void)shm_unlink(name_buffer);
+        (void)unlink_block_object(directory, name_buffer);
         switch (errno)
         {
         case EACCES:
@@ -68,36 +440,18 @@ ipm_result shared_memory_block_create(
             return IPM_RESULT_ERR_OS_UNEXPECTED;
         }
     }
-    void* const block_memory = mmap(NULL, (size), (access == IPM_ACCESS_MODE_READ_ONLY ? PROT_READ : PROT_READ|PROT_WRITE), MAP_SHARED, fd, IPM_MEMORY_PAGE_SIZE);
-    if (block_memory == MAP_FAILED)
-    {
-        close(fd);
-        IPM_ERROR(context, "Could not map shared memory to memory, reason: %s", strerror(errno));
-        shm_unlink(name_buffer);
-        switch (errno)
-        {
-        case EACCES:
-            return IPM_RESULT_ERR_ACCESS;
-        case EAGAIN:
-        case ENOMEM:
-            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
-        case EINVAL:
-            return IPM_RESULT_ERR_BAD_VALUE;
-        case ENFILE:
-            return IPM_RESULT_ERR_MAX_FDS_SYS;
-        default:
-            return IPM_RESULT_ERR_OS_UNEXPECTED;
-        }
-    }
-    ipm_shared_memory_header* const header = mmap(NULL, IPM_MEMORY_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    if (!header)
+    size_t reserved;
+    uint8_t* const base = map_block_object(fd, total_size, placement ? placement->address : NULL, fixed_reserved, &reserved);
+    if (base == MAP_FAILED)
     {
+        const int error = errno;
         close(fd);
-        IPM_ERROR(context, "Could not map shared memory to memory, reason: %s", strerror(errno));
-        (void)munmap(block_memory, size);
-        shm_unlink(name_buffer);
-        switch (errno)
+        IPM_ERROR(context, "Could not map shared memory to memory, reason: %s", strerror(error));
+        (void)unlink_block_object(directory, name_buffer);
+        switch (error)
         {
+        case EEXIST:
+            return IPM_RESULT_ERR_ADDRESS_IN_USE;
         case EACCES:
             return IPM_RESULT_ERR_ACCESS;
         case EAGAIN:
@@ -111,19 +465,27 @@ ipm_result shared_memory_block_create(
             return IPM_RESULT_ERR_OS_UNEXPECTED;
         }
     }
+    ipm_shared_memory_header* const header = (ipm_shared_memory_header*)base;
 
+    header->magic = IPM_SHARED_MEMORY_MAGIC;
+    header->layout_version = IPM_SHARED_MEMORY_LAYOUT_VERSION;
+    header->section_count = IPM_SHARED_MEMORY_SECTION_COUNT;
+    header->sections[IPM_SHARED_MEMORY_SECTION_HEADER] = (ipm_shared_memory_section){.type = IPM_SHARED_MEMORY_SECTION_HEADER, .offset = 0, .size = IPM_MEMORY_PAGE_SIZE};
+    header->sections[IPM_SHARED_MEMORY_SECTION_METADATA] = (ipm_shared_memory_section){.type = IPM_SHARED_MEMORY_SECTION_METADATA, .offset = IPM_MEMORY_PAGE_SIZE, .size = metadata_size};
+    header->sections[IPM_SHARED_MEMORY_SECTION_DATA] = (ipm_shared_memory_section){.type = IPM_SHARED_MEMORY_SECTION_DATA, .offset = data_offset, .size = size};
     header->block_id = id;
     header->block_size = size;
     header->id_counter = 1;
+    header->fixed_address = placement ? (uintptr_t)base : 0;
+    header->fixed_reserved = fixed_reserved;
 
-    const ipm_result res = ipm_mutex_init(&header->segment_mutex);
+    ipm_result res = ipm_mutex_init(&header->segment_mutex);
     if (res != IPM_RESULT_SUCCESS)
     {
         close(fd);
         IPM_ERROR(context, "Could not create block mutex, reason: %s", strerror(errno));
-        munmap(header, IPM_MEMORY_PAGE_SIZE);
-        munmap(block_memory, size);
-        shm_unlink(name_buffer);
+        (void)munmap(base, reserved);
+        (void)unlink_block_object(directory, name_buffer);
         return res;
     }
 
@@ -132,25 +494,59 @@ ipm_result shared_memory_block_create(
 
     p_block->mem_fd = fd;
     p_block->header = header;
-    p_block->memory = block_memory;
+    p_block->metadata = metadata_size ? base + IPM_MEMORY_PAGE_SIZE : NULL;
+    p_block->memory = base + data_offset;
+    p_block->data_offset = data_offset;
+    p_block->reserved = reserved;
     p_block->access_id = atomic_fetch_add(&header->id_counter, 1);
-    p_block->access_mode = access;
+    p_block->access_mode = IPM_ACCESS_MODE_READ_WRITE;
     p_block->size = size;
     p_block->has_ownership = 0;
+    p_block->is_persistent = directory != NULL;
+    p_block->was_recovered = 0;
+    p_block->generation = 0;
+    p_block->is_windowed = 0;
+    p_block->hint_count = 0;
+    p_block->protected_count = 0;
 
+    //  Metadata is initialized before the block is published, so other processes never see it half-made
+    if (initialize)
+    {
+        res = initialize(p_block, param);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            close(fd);
+            ipm_mutex_destroy(&header->segment_mutex);
+            (void)munmap(base, reserved);
+            (void)unlink_block_object(directory, name_buffer);
+            return res;
+        }
+    }
+    if (access == IPM_ACCESS_MODE_READ_ONLY)
+    {
+        (void)mprotect(p_block->memory, size, PROT_READ);
+        p_block->access_mode = IPM_ACCESS_MODE_READ_ONLY;
+    }
+
+    header->generation = 0;
     header->refcount = 1;
+    //  Block is published and all processes waiting for it to be initialized are woken up
+    atomic_store(&header->init_state, IPM_SHARED_MEMORY_STATE_READY);
+    ipm_futex_wake(&header->init_state, UINT32_MAX);
+    (void)lock_block_byte(fd, F_UNLCK, BLOCK_LOCK_CREATING, 0);
     return IPM_RESULT_SUCCESS;
 }
 
 ipm_result shared_memory_block_open(
-        const ipm_context* context, const char* block_name, ipm_id id, ipm_access_mode access, ipm_shared_memory_block* p_block)
+        const ipm_context* context, const char* directory, const char* block_name, ipm_id id, ipm_access_mode access,
+        ipm_bool windowed, ipm_shared_memory_block* p_block)
 {
     const size_t name_len = strlen(block_name);
     assert(name_len <= IPM_MAX_NAME_LEN);
-    char name_buffer[IPM_MAX_NAME_LEN + 32];
-    make_block_name_based_on_id(name_buffer, sizeof(name_buffer), block_name, id);
-    const int fd = shm_open(name_buffer, O_RDWR,  //  Need write permission to set size with ftruncate
-                            S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH);
+    assert(!directory || strlen(directory) <= IPM_MAX_DIRECTORY_LEN);
+    char name_buffer[IPM_MAX_DIRECTORY_LEN + IPM_MAX_NAME_LEN + 32];
+    make_block_name_based_on_id(name_buffer, sizeof(name_buffer), directory, block_name, id);
+    const int fd = open_block_object(directory, name_buffer, O_RDWR);  //  Need write permission to set size with ftruncate
     if (fd < 0)
     {
         if (errno == EEXIST)
@@ -176,32 +572,60 @@ ipm_result shared_memory_block_open(
             return IPM_RESULT_ERR_OS_UNEXPECTED;
         }
     }
-    ipm_shared_memory_header* const header = mmap(NULL, IPM_MEMORY_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    if (!header)
+
+    //  When a persistent block is opened while no other process has it open, whatever state was left in its header by
+    //  the processes which had it open before (which may have crashed or not survived a reboot) must be reset
+    ipm_bool recovering = 0;
+    if (directory)
     {
-        IPM_ERROR(context, "Could not map shared memory to memory, reason: %s", strerror(errno));
-        switch (errno)
+        if (lock_block_byte(fd, F_WRLCK, BLOCK_LOCK_OPEN, 1) < 0)
         {
-        case EACCES:
-            return IPM_RESULT_ERR_ACCESS;
-        case EAGAIN:
-        case ENOMEM:
-            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
-        case EINVAL:
-            return IPM_RESULT_ERR_BAD_VALUE;
-        case ENFILE:
-            return IPM_RESULT_ERR_MAX_FDS_SYS;
-        default:
-            return IPM_RESULT_ERR_OS_UNEXPECTED;
+            IPM_ERROR(context, "Could not lock the file of the persistent block, reason: %s", strerror(errno));
+            close(fd);
+            return IPM_RESULT_ERR_BAD_FS;
+        }
+        recovering = lock_block_byte(fd, F_WRLCK, BLOCK_LOCK_IN_USE, 0) == 0;
+        if (lock_block_byte(fd, F_RDLCK, BLOCK_LOCK_IN_USE, 1) < 0)
+        {
+            IPM_ERROR(context, "Could not lock the file of the persistent block, reason: %s", strerror(errno));
+            close(fd);
+            return IPM_RESULT_ERR_BAD_FS;
         }
     }
 
-    const size_t size = header->block_size;
-    void* const block_memory = mmap(NULL, size, (access == IPM_ACCESS_MODE_READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE), MAP_SHARED, fd, IPM_MEMORY_PAGE_SIZE);
-    if (block_memory == MAP_FAILED)
+    //  Openers sleep while the block is being initialized, and give up if its creator died or takes too long. Size of the
+    //  object is needed to map it all at once, before its header can be read.
+    const uint64_t deadline = monotonic_time_ms() + IPM_DEFAULT_OPEN_TIMEOUT_MS;
+    struct stat stat_buffer;
+    for (long backoff_us = 50;; backoff_us = backoff_us < 10000 ? 2 * backoff_us : backoff_us)
+    {
+        if (fstat(fd, &stat_buffer) < 0)
+        {
+            IPM_ERROR(context, "Could not query the size of the block, reason: %s", strerror(errno));
+            close(fd);
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+        if ((size_t)stat_buffer.st_size >= IPM_MEMORY_PAGE_SIZE)
+        {
+            break;
+        }
+        const ipm_result res = check_creation_progress(context, directory, name_buffer, fd, deadline);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            close(fd);
+            return res;
+        }
+        //  Creator sets the size right after creating the object, so it is only waited for with short sleeps
+        const struct timespec interval = {.tv_sec = 0, .tv_nsec = backoff_us * 1000};
+        (void)nanosleep(&interval, NULL);
+    }
+    //  Windowed blocks only need the header and the metadata, which are mapped once the header tells where the data begins
+    const size_t mapped_size = windowed ? IPM_MEMORY_PAGE_SIZE : (size_t)stat_buffer.st_size;
+    size_t reserved;
+    uint8_t* base = map_block_object(fd, mapped_size, NULL, 0, &reserved);
+    if (base == MAP_FAILED)
     {
         close(fd);
-        (void)munmap(header, IPM_MEMORY_PAGE_SIZE);
         IPM_ERROR(context, "Could not map shared memory to memory, reason: %s", strerror(errno));
         switch (errno)
         {
@@ -218,39 +642,146 @@ ipm_result shared_memory_block_open(
             return IPM_RESULT_ERR_OS_UNEXPECTED;
         }
     }
+    ipm_shared_memory_header* header = (ipm_shared_memory_header*)base;
+
+    //  Objects made by versions from before the state was added hold their layout version there, so only the creating
+    //  state is waited on, while any other is rejected by the layout checks below
+    for (uint32_t state; (state = atomic_load(&header->init_state)) == IPM_SHARED_MEMORY_STATE_CREATING;)
+    {
+        const ipm_result res = check_creation_progress(context, directory, name_buffer, fd, deadline);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            close(fd);
+            (void)munmap(base, reserved);
+            return res;
+        }
+        //  Creator which died never wakes up the waiters, so the wait is cut into intervals to check for that
+        const uint64_t now = monotonic_time_ms();
+        const uint64_t remaining = deadline > now ? deadline - now : 0;
+        (void)ipm_futex_wait(&header->init_state, state, remaining < IPM_CREATION_CHECK_INTERVAL_MS ? remaining : IPM_CREATION_CHECK_INTERVAL_MS);
+    }
+
+    //  Layout is checked before anything else in the header is used, including resetting it when recovering
+    if (header->magic != IPM_SHARED_MEMORY_MAGIC)
+    {
+        close(fd);
+        IPM_ERROR(context, "Object with id %#016lX was not created by this library, or by a version which is not supported", id);
+        (void)munmap(base, reserved);
+        return IPM_RESULT_ERR_BAD_VERSION;
+    }
+    if (header->layout_version != IPM_SHARED_MEMORY_LAYOUT_VERSION || header->section_count != IPM_SHARED_MEMORY_SECTION_COUNT)
+    {
+        close(fd);
+        IPM_ERROR(context, "Block has layout version %u, but only version %u is supported", header->layout_version, (unsigned)IPM_SHARED_MEMORY_LAYOUT_VERSION);
+        (void)munmap(base, reserved);
+        return IPM_RESULT_ERR_BAD_VERSION;
+    }
 
-    while (header->refcount == 0)
+    if (recovering)
     {
-        //  Wait for the refcount to increase (set by creator thread when it is done initializing
-        sched_yield();  //  If the condition is not true, yield
+        if (header->block_id != id || header->block_size == 0)
+        {
+            //  Creation of the block was never completed
+            close(fd);
+            IPM_ERROR(context, "Persistent block with id %#016lX was not fully created", id);
+            (void)munmap(base, reserved);
+            return IPM_RESULT_ERR_BAD_INIT;
+        }
+        const ipm_result res = ipm_mutex_init(&header->segment_mutex);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            close(fd);
+            IPM_ERROR(context, "Could not reinitialize block mutex, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            (void)munmap(base, reserved);
+            return res;
+        }
+        header->refcount = 0;
     }
 
     if (header->block_id != id)
     {
         close(fd);
         IPM_ERROR(context, "Block id (%#016lX) did not match the specified id (%#016lX)", header->block_id, id);
-        (void)munmap(header, IPM_MEMORY_PAGE_SIZE);
-        (void)munmap(block_memory, size);
+        (void)munmap(base, reserved);
         return IPM_RESULT_ERR_BAD_ID;
     }
     if (memcmp(header->block_name, block_name, name_len) != 0)
     {
         close(fd);
         IPM_ERROR(context, "Block id (%s) did not match the specified id (%.*s)", block_name, IPM_MAX_NAME_LEN, header->block_name);
-        (void)munmap(header, IPM_MEMORY_PAGE_SIZE);
-        (void)munmap(block_memory, size);
+        (void)munmap(base, reserved);
         return IPM_RESULT_ERR_BAD_ID;
     }
 
+    if (header->fixed_address && !windowed)
+    {
+        //  Object is moved to the address where all other processes have it, so pointers into it are the same for all
+        size_t fixed_reserved;
+        uint8_t* const fixed_base = map_block_object(fd, mapped_size, (void*)header->fixed_address, header->fixed_reserved, &fixed_reserved);
+        if (fixed_base == MAP_FAILED)
+        {
+            const int error = errno;
+            IPM_ERROR(context, "Could not map the block at address %p, reason: %s", (void*)header->fixed_address, strerror(error));
+            close(fd);
+            (void)munmap(base, reserved);
+            return error == EEXIST ? IPM_RESULT_ERR_ADDRESS_IN_USE : IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        }
+        (void)munmap(base, reserved);
+        base = fixed_base;
+        reserved = fixed_reserved;
+        header = (ipm_shared_memory_header*)base;
+    }
+
+    const ipm_shared_memory_section* const metadata = header->sections + IPM_SHARED_MEMORY_SECTION_METADATA;
+    const size_t data_offset = header->sections[IPM_SHARED_MEMORY_SECTION_DATA].offset;
+    if (windowed && data_offset > IPM_MEMORY_PAGE_SIZE)
+    {
+        if (data_offset > reserved || mmap(base + IPM_MEMORY_PAGE_SIZE, data_offset - IPM_MEMORY_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, IPM_MEMORY_PAGE_SIZE) == MAP_FAILED)
+        {
+            IPM_ERROR(context, "Could not map the metadata of the block, reason: %s", strerror(errno));
+            close(fd);
+            (void)munmap(base, reserved);
+            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        }
+    }
+
     (void)atomic_fetch_add(&header->refcount, 1);
 
     p_block->header = header;
-    p_block->memory = block_memory;
+    p_block->metadata = metadata->size ? base + metadata->offset : NULL;
+    p_block->memory = windowed ? NULL : base + data_offset;
+    p_block->data_offset = data_offset;
+    p_block->reserved = reserved;
     p_block->access_id = atomic_fetch_add(&header->id_counter, 1);
-    p_block->access_mode = access;
+    p_block->access_mode = IPM_ACCESS_MODE_READ_WRITE;
     p_block->mem_fd = fd;
-    p_block->size = size;
+    p_block->size = mapped_size > data_offset ? mapped_size - data_offset : 0;
+    p_block->is_windowed = windowed;
     p_block->has_ownership = 0;
+    p_block->is_persistent = directory != NULL;
+    p_block->was_recovered = recovering;
+    p_block->generation = atomic_load(&header->generation);
+    p_block->hint_count = 0;
+    p_block->protected_count = 0;
+
+    if (directory)
+    {
+        (void)lock_block_byte(fd, F_UNLCK, BLOCK_LOCK_OPEN, 0);
+    }
+
+    //  Block may have been resized since its size was queried, and the data has to be protected for read-only access
+    const ipm_result res = shared_memory_block_update_mapping(context, p_block, access);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        (void)atomic_fetch_sub(&header->refcount, 1);
+        close(fd);
+        (void)munmap(base, reserved);
+        return res;
+    }
+    if (!windowed)
+    {
+        apply_all_hints(p_block);
+    }
 
     return IPM_RESULT_SUCCESS;
 }
@@ -261,13 +792,14 @@ ipm_result shared_memory_block_close(
 {
     assert(block->has_ownership == 0);
     ipm_shared_memory_header* header = block->header;
-    void* const mem = block->memory;
+    const size_t reserved = block->reserved;
+    const ipm_bool is_persistent = block->is_persistent;
     close(block->mem_fd);
 
     memset(block, 0xCC, sizeof(*block));
 
     const uint32_t refs = atomic_fetch_sub(&header->refcount, 1);
-    if (refs == 1)
+    if (refs == 1 && !is_persistent)
     {
         if (callback)
         {
@@ -276,9 +808,8 @@ ipm_result shared_memory_block_close(
         ipm_mutex_destroy(&header->segment_mutex);
         char name_buffer[IPM_MAX_NAME_LEN + 32];
         const ipm_id id = header->block_id;
-        make_block_name_based_on_id(name_buffer, sizeof(name_buffer), header->block_name, id);
-        (void)munmap(mem, header->block_size);
-        (void) munmap(header, IPM_MEMORY_PAGE_SIZE);
+        make_block_name_based_on_id(name_buffer, sizeof(name_buffer), NULL, header->block_name, id);
+        (void)munmap(header, reserved);
         header = NULL;
         //  This was the last block (meaning, UNLINK THIS)
         const int res = shm_unlink(name_buffer);
@@ -296,8 +827,7 @@ ipm_result shared_memory_block_close(
     }
     else
     {
-        (void)munmap(mem, header->block_size);
-        (void) munmap(header, IPM_MEMORY_PAGE_SIZE);
+        (void)munmap(header, reserved);
         header = NULL;
     }
 
@@ -323,7 +853,7 @@ ipm_result acquire_memory_block_whole(const ipm_context* context, ipm_shared_mem
 
 ipm_result release_memory_block_whole(const ipm_context* context, ipm_shared_memory_block* block)
 {
-    if (block->has_ownership)
+    if (!block->has_ownership)
     {
         IPM_ERROR(context, "Does not have ownership of the block!");
         return IPM_RESULT_ERR_NOT_LOCKED;
@@ -337,64 +867,207 @@ ipm_result shared_memory_block_update_mapping(
         const ipm_context* context, ipm_shared_memory_block* block, ipm_access_mode access_mode)
 {
     const size_t new_size = block->header->block_size;
+    const ipm_id generation = atomic_load(&block->header->generation);
+    if (atomic_load(&block->header->sealed))
+    {
+        //  Nobody may write to a sealed block, regardless of the access it was opened with
+        access_mode = IPM_ACCESS_MODE_READ_ONLY;
+    }
+    if (block->is_windowed)
+    {
+        //  Windows are mapped separately, so only the state of the block is updated
+        block->size = new_size;
+        block->access_mode = access_mode;
+        block->generation = generation;
+        return IPM_RESULT_SUCCESS;
+    }
     if (block->size == new_size && access_mode == block->access_mode && block->memory != 0)
     {
         //  Block size has not changed
+        block->generation = generation;
         return IPM_RESULT_SUCCESS;
     }
 
-    void* const old_ptr = block->memory;
-    munmap(block->memory, block->size);
-    block->memory = NULL;
-    void* const new_ptr = mmap(old_ptr, new_size, (access_mode == IPM_ACCESS_MODE_READ_ONLY ? PROT_READ : PROT_READ|PROT_WRITE), MAP_SHARED, block->mem_fd, IPM_MEMORY_PAGE_SIZE);
-    if (new_ptr == MAP_FAILED)
+    const size_t old_size = block->size;
+    const size_t old_total = block->data_offset + old_size;
+    const size_t new_total = block->data_offset + new_size;
+    //  Protection of the whole block is only changed when it has to be, so that protected ranges are kept
+    ipm_bool reprotect = access_mode != block->access_mode;
+    if (new_size != old_size)
     {
-        IPM_ERROR(context, "Could not map the updated shared memory block, reason: %s", strerror(errno));
-        block->size = 0;
-        block->access_mode = 0;
-        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
-    }
-    block->access_mode = access_mode;
-    block->size = new_size;
-    block->memory = NULL;
-
-    return IPM_RESULT_SUCCESS;
-}
-
-ipm_result shared_memory_block_resize(const ipm_context* context, ipm_shared_memory_block* block, size_t new_size)
-{
-    //  NO SHRINKING!!!
-    assert(new_size >= block->header->block_size);
+        uint8_t* const base = (uint8_t*)block->header;
+        if (new_total <= block->reserved)
+        {
+            //  Only the part past the smaller of the two sizes is replaced, so the header and the metadata stay where
+            //  they are, even while their mutexes are held
+            void* res;
+            if (new_total > old_total)
+            {
+                res = mmap(base + old_total, new_total - old_total, access_protection(block->access_mode), MAP_SHARED|MAP_FIXED, block->mem_fd, (off_t)old_total);
+            }
+            else
+            {
+                res = mmap(base + new_total, old_total - new_total, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED|MAP_NORESERVE, -1, 0);
+            }
+            if (res == MAP_FAILED)
+            {
+                IPM_ERROR(context, "Could not map the updated shared memory block, reason: %s", strerror(errno));
+                block->size = 0;
+                block->access_mode = 0;
+                block->memory = NULL;
+                return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+            }
+        }
+        else
+        {
+            //  Block grew past the reserved range, so the whole mapping has to be moved
+            if (block->header->fixed_address)
+            {
+                IPM_ERROR(context, "Block at a fixed address can not grow past %zu bytes", block->header->fixed_reserved - block->data_offset);
+                return IPM_RESULT_ERR_BAD_SIZE;
+            }
+            size_t reserved;
+            uint8_t* const new_base = map_block_object(block->mem_fd, new_total, NULL, 0, &reserved);
+            if (new_base == MAP_FAILED)
+            {
+                IPM_ERROR(context, "Could not map the updated shared memory block, reason: %s", strerror(errno));
+                return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+            }
+            (void)munmap(base, block->reserved);
+            if (block->metadata)
+            {
+                block->metadata = new_base + ((uint8_t*)block->metadata - base);
+            }
+            block->header = (ipm_shared_memory_header*)new_base;
+            block->reserved = reserved;
+            reprotect = 1;
+        }
+        block->memory = (uint8_t*)block->header + block->data_offset;
+        block->size = new_size;
+        clip_protected_ranges(block);
+        //  Mapping which was replaced had the hints applied, but the new one does not have them yet
+        apply_all_hints(block);
+    }
+    if (reprotect)
+    {
+        if (mprotect(block->memory, new_size, access_protection(access_mode)) < 0)
+        {
+            IPM_ERROR(context, "Could not change the protection of the shared memory block, reason: %s", strerror(errno));
+            return IPM_RESULT_ERR_ACCESS;
+        }
+        if (access_mode == block->access_mode)
+        {
+            //  Mapping was moved, so the ranges which were protected on the old one are protected again
+            for (uint32_t i = 0; i < block->protected_count; ++i)
+            {
+                (void)mprotect((uint8_t*)block->memory + block->protected_ranges[i].offset, block->protected_ranges[i].size, PROT_READ);
+            }
+        }
+        else
+        {
+            block->protected_count = 0;
+        }
+    }
+    block->access_mode = access_mode;
+    block->generation = generation;
+
+    //  The placement policy is kept by the shared memory object, so only the newly grown part needs it applied
+    const ipm_numa_policy policy = block->header->numa_policy;
+    if (policy != IPM_NUMA_POLICY_DEFAULT && new_size > old_size)
+    {
+        const ipm_result res = ipm_numa_bind((uint8_t*) block->memory + old_size, new_size - old_size, policy,
+                                             block->header->numa_node_mask, 0);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(context, "Could not apply NUMA policy to the grown part of the block, reason: %s (%s)",
+                      ipm_result_to_str(res), ipm_result_to_msg(res));
+        }
+    }
+
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result shared_memory_block_seal(const ipm_context* context, ipm_shared_memory_block* block)
+{
+    //  Segment must be locked by the caller, so the size can not change while sealing
+    assert(block->has_ownership);
+    //  Objects created with shm_open can not be sealed by the kernel like memfd can, so the flag in the header is what
+    //  stops the writers, while each process enforces it with the protection of its own mapping
+    atomic_store(&block->header->sealed, 1);
+    //  Generation is changed so that other processes know they should remap the block as read-only
+    atomic_fetch_add(&block->header->generation, 1);
+    return shared_memory_block_update_mapping(context, block, IPM_ACCESS_MODE_READ_ONLY);
+}
+
+ipm_result shared_memory_block_truncate(const ipm_context* context, ipm_shared_memory_block* block, size_t new_size)
+{
     assert((new_size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
     assert(new_size > 0);
-    //  Lock access to file
-    const ipm_result sem_res = ipm_mutex_lock(&block->header->segment_mutex);
-    if (sem_res != IPM_RESULT_SUCCESS)
+    //  Lock access to file, unless the block is already owned by the caller
+    const ipm_bool needs_lock = !block->has_ownership;
+    if (needs_lock)
     {
-        //  Could not lock the semaphore
-        IPM_ERROR(context, "Could not wait for semaphore to lock the memory segment, reason: %s", strerror(errno));
-        return sem_res;
+        const ipm_result sem_res = ipm_mutex_lock(&block->header->segment_mutex);
+        if (sem_res != IPM_RESULT_SUCCESS)
+        {
+            //  Could not lock the semaphore
+            IPM_ERROR(context, "Could not wait for semaphore to lock the memory segment, reason: %s", strerror(errno));
+            return sem_res;
+        }
+    }
+
+    if (atomic_load(&block->header->sealed))
+    {
+        if (needs_lock)
+        {
+            ipm_mutex_unlock(&block->header->segment_mutex);
+        }
+        IPM_ERROR(context, "Sealed block can not be resized");
+        return IPM_RESULT_ERR_SEALED;
+    }
+
+    if (block->header->fixed_address && block->data_offset + new_size > block->header->fixed_reserved)
+    {
+        if (needs_lock)
+        {
+            ipm_mutex_unlock(&block->header->segment_mutex);
+        }
+        IPM_ERROR(context, "Block at a fixed address can not grow past %zu bytes", block->header->fixed_reserved - block->data_offset);
+        return IPM_RESULT_ERR_BAD_SIZE;
     }
 
     if (new_size == block->header->block_size)
     {
         //  Block was already truncated to the correct size
-        ipm_mutex_unlock(&block->header->segment_mutex);
-        if (new_size != block->size)
+        if (needs_lock)
         {
-            return shared_memory_block_update_mapping(context, block, block->access_mode);
+            ipm_mutex_unlock(&block->header->segment_mutex);
         }
         return IPM_RESULT_SUCCESS;
     }
 
-    const int res = ftruncate(block->mem_fd, (off_t) (IPM_MEMORY_PAGE_SIZE + new_size));
+    if (new_size < block->header->block_size)
+    {
+        //  When shrinking, the size is updated first, so that the header never reports more than the file holds
+        block->header->block_size = new_size;
+    }
+    const int res = ftruncate(block->mem_fd, (off_t) (block->data_offset + new_size));
     if (res < 0)
     {
         //  Failed truncation
-        ipm_mutex_unlock(&block->header->segment_mutex);
-        IPM_ERROR(context, "Could not truncate file to %zu bytes, reason: %s", IPM_MEMORY_PAGE_SIZE + new_size,
-                  strerror(errno));
-        switch (errno)
+        const int error = errno;
+        struct stat stat_buffer;
+        if (fstat(block->mem_fd, &stat_buffer) == 0 && (size_t) stat_buffer.st_size >= block->data_offset)
+        {
+            block->header->block_size = (size_t) stat_buffer.st_size - block->data_offset;
+        }
+        if (needs_lock)
+        {
+            ipm_mutex_unlock(&block->header->segment_mutex);
+        }
+        IPM_ERROR(context, "Could not truncate file to %zu bytes, reason: %s", block->data_offset + new_size,
+                  strerror(error));
+        switch (error)
         {
         case EACCES:
             return IPM_RESULT_ERR_ACCESS;
@@ -410,25 +1083,547 @@ ipm_result shared_memory_block_resize(const ipm_context* context, ipm_shared_mem
             return IPM_RESULT_ERR_OS_UNEXPECTED;
         }
     }
-    //  Update internal size
+    //  Update internal size and let other processes know they have to update their mappings
     block->header->block_size = new_size;
-    ipm_mutex_unlock(&block->header->segment_mutex);
+    block->header->sections[IPM_SHARED_MEMORY_SECTION_DATA].size = new_size;
+    atomic_fetch_add(&block->header->generation, 1);
+    if (needs_lock)
+    {
+        ipm_mutex_unlock(&block->header->segment_mutex);
+    }
+    return IPM_RESULT_SUCCESS;
+}
 
+ipm_result shared_memory_block_resize(const ipm_context* context, ipm_shared_memory_block* block, size_t new_size)
+{
+    const ipm_result res = shared_memory_block_truncate(context, block, new_size);
+    if (res != IPM_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    //  Mapping is only updated once the segment is unlocked, since it may be moved
     return shared_memory_block_update_mapping(context, block, block->access_mode);
 }
 
+ipm_result shared_memory_block_discard(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size)
+{
+    assert((offset & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert((size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert(offset + size <= block->size);
+#ifdef FALLOC_FL_PUNCH_HOLE
+    if (fallocate(block->mem_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t) (block->data_offset + offset), (off_t) size) == 0)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    if (errno != EOPNOTSUPP && errno != ENOSYS)
+    {
+        IPM_ERROR(context, "Could not punch a hole in the shared memory, reason: %s", strerror(errno));
+        switch (errno)
+        {
+        case EPERM:
+        case EACCES:
+            return IPM_RESULT_ERR_ACCESS;
+        case EBADF:
+        case EINVAL:
+            return IPM_RESULT_ERR_BAD_VALUE;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+#endif
+#ifdef MADV_REMOVE
+    if (block->is_windowed)
+    {
+        IPM_ERROR(context, "Filesystem does not support punching holes, and the block is not mapped whole");
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    }
+    //  Filesystem does not support punching holes, so the pages are removed through the mapping instead
+    if (madvise((uint8_t*) block->memory + offset, size, MADV_REMOVE) == 0)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    IPM_ERROR(context, "Could not remove pages of the shared memory, reason: %s", strerror(errno));
+    switch (errno)
+    {
+    case EACCES:
+    case EPERM:
+        return IPM_RESULT_ERR_ACCESS;
+    case EINVAL:
+        return IPM_RESULT_ERR_BAD_VALUE;
+    case EOPNOTSUPP:
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    default:
+        return IPM_RESULT_ERR_OS_UNEXPECTED;
+    }
+#else
+    (void) context;
+    return IPM_RESULT_ERR_NOT_SUPPORTED;
+#endif
+}
+
+ipm_result shared_memory_block_set_numa_policy(
+        const ipm_context* context, ipm_shared_memory_block* block, ipm_numa_policy policy, uint64_t node_mask)
+{
+    const ipm_result lock_res = ipm_mutex_lock(&block->header->segment_mutex);
+    if (lock_res != IPM_RESULT_SUCCESS)
+    {
+        IPM_ERROR(context, "Could not lock the memory segment, reason: %s (%s)", ipm_result_to_str(lock_res), ipm_result_to_msg(lock_res));
+        return lock_res;
+    }
+
+    if (block->is_windowed)
+    {
+        ipm_mutex_unlock(&block->header->segment_mutex);
+        IPM_ERROR(context, "Policy of a block can not be set through a windowed mapping");
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    }
+
+    //  Pages which were already touched are moved to conform to the new policy
+    const ipm_result res = ipm_numa_bind(block->memory, block->size, policy, node_mask, 1);
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        block->header->numa_policy = policy;
+        block->header->numa_node_mask = node_mask;
+    }
+    else
+    {
+        IPM_ERROR(context, "Could not set the NUMA policy of the block, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+    }
+    ipm_mutex_unlock(&block->header->segment_mutex);
+
+    return res;
+}
+
+ipm_result shared_memory_block_advise(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size, ipm_memory_hint hint,
+        ipm_bool shared)
+{
+    assert((offset & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert((size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert(offset + size <= block->size);
+    const int advice = hint_to_advice(hint);
+    if (advice < 0)
+    {
+        IPM_ERROR(context, "Memory hint %u is not supported on this platform", (unsigned)hint);
+        return IPM_RESULT_ERR_NOT_SUPPORTED;
+    }
+    if (madvise((uint8_t*)block->memory + offset, size, advice) < 0)
+    {
+        IPM_ERROR(context, "Could not advise the kernel about the shared memory, reason: %s", strerror(errno));
+        switch (errno)
+        {
+        case EINVAL:
+            //  Kernels which are too old reject the advice they do not know
+            return hint >= IPM_MEMORY_HINT_COLD ? IPM_RESULT_ERR_NOT_SUPPORTED : IPM_RESULT_ERR_BAD_VALUE;
+        case EAGAIN:
+            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        case ENOMEM:
+            return IPM_RESULT_ERR_BAD_VALUE;
+        case EACCES:
+        case EPERM:
+            return IPM_RESULT_ERR_ACCESS;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+
+    //  Only access pattern hints last, others just act on the pages which are there right now
+    if (hint != IPM_MEMORY_HINT_NORMAL && hint != IPM_MEMORY_HINT_SEQUENTIAL && hint != IPM_MEMORY_HINT_RANDOM)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+    const ipm_shared_memory_hint record = {.offset = offset, .size = size, .hint = hint};
+    record_hint(block->hints, &block->hint_count, &record);
+    if (!shared)
+    {
+        return IPM_RESULT_SUCCESS;
+    }
+
+    const ipm_bool needs_lock = !block->has_ownership;
+    if (needs_lock)
+    {
+        const ipm_result res = ipm_mutex_lock(&block->header->segment_mutex);
+        if (res != IPM_RESULT_SUCCESS)
+        {
+            IPM_ERROR(context, "Could not lock the memory segment, reason: %s (%s)", ipm_result_to_str(res), ipm_result_to_msg(res));
+            return res;
+        }
+    }
+    record_hint(block->header->hints, &block->header->hint_count, &record);
+    if (needs_lock)
+    {
+        ipm_mutex_unlock(&block->header->segment_mutex);
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result shared_memory_block_protect_range(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size, ipm_access_mode access)
+{
+    assert((offset & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert((size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert(offset + size <= block->size);
+    assert(block->access_mode == IPM_ACCESS_MODE_READ_WRITE);
+    //  New range may split an existing one in two, so there may be two more ranges than there is room for
+    ipm_shared_memory_range ranges[IPM_SHARED_MEMORY_MAX_PROTECTED_RANGES + 2];
+    uint32_t count;
+    if (!update_protected_ranges(block, offset, offset + size, access == IPM_ACCESS_MODE_READ_ONLY, ranges, &count))
+    {
+        IPM_ERROR(context, "Block can not have more than %u separate protected ranges", (unsigned)IPM_SHARED_MEMORY_MAX_PROTECTED_RANGES);
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    if (mprotect((uint8_t*)block->memory + offset, size, access_protection(access)) < 0)
+    {
+        IPM_ERROR(context, "Could not change the protection of the shared memory block, reason: %s", strerror(errno));
+        switch (errno)
+        {
+        case EACCES:
+            return IPM_RESULT_ERR_ACCESS;
+        case ENOMEM:
+            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+    memcpy(block->protected_ranges, ranges, sizeof(*ranges) * count);
+    block->protected_count = count;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_bool shared_memory_block_is_protected(const ipm_shared_memory_block* block, size_t offset, size_t size)
+{
+    for (uint32_t i = 0; i < block->protected_count; ++i)
+    {
+        const ipm_shared_memory_range range = block->protected_ranges[i];
+        if (range.offset < offset + size && offset < range.offset + range.size)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static ipm_result copy_error_to_result(const ipm_context* context, const char* what)
+{
+    switch (errno)
+    {
+    case ENOSPC:
+    case ENOMEM:
+        IPM_ERROR(context, "Could not copy %s, reason: %s", what, strerror(errno));
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    case EBADF:
+    case EPERM:
+    case EACCES:
+        IPM_ERROR(context, "Could not copy %s, reason: %s", what, strerror(errno));
+        return IPM_RESULT_ERR_ACCESS;
+    default:
+        IPM_ERROR(context, "Could not copy %s, reason: %s", what, strerror(errno));
+        return IPM_RESULT_ERR_OS_UNEXPECTED;
+    }
+}
+
+static ipm_result splice_between_objects(
+        const ipm_context* context, int in_fd, off_t* p_in_offset, int out_fd, off_t* p_out_offset, size_t size,
+        const char* what)
+{
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) < 0)
+    {
+        IPM_ERROR(context, "Could not create a pipe, reason: %s", strerror(errno));
+        return IPM_RESULT_ERR_OS_UNEXPECTED;
+    }
+    //  Larger pipe means fewer system calls per page, but it is fine if it can not be enlarged
+    (void)fcntl(pipe_fds[1], F_SETPIPE_SZ, 1 << 20);
+    ipm_result res = IPM_RESULT_SUCCESS;
+    while (size > 0)
+    {
+        const ssize_t filled = splice(in_fd, p_in_offset, pipe_fds[1], NULL, size, SPLICE_F_MOVE);
+        if (filled <= 0)
+        {
+            if (filled < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (filled == 0)
+            {
+                IPM_ERROR(context, "Source ended before %s was copied", what);
+                res = IPM_RESULT_ERR_BAD_SIZE;
+            }
+            else
+            {
+                res = errno == EINVAL ? IPM_RESULT_ERR_NOT_SUPPORTED : copy_error_to_result(context, what);
+            }
+            break;
+        }
+        size_t in_pipe = (size_t)filled;
+        while (in_pipe > 0)
+        {
+            const ssize_t drained = splice(pipe_fds[0], NULL, out_fd, p_out_offset, in_pipe, SPLICE_F_MOVE);
+            if (drained <= 0)
+            {
+                if (drained < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                //  Data already in the pipe is lost, so the caller can not fall back to anything else
+                res = copy_error_to_result(context, what);
+                goto end;
+            }
+            in_pipe -= (size_t)drained;
+        }
+        size -= (size_t)filled;
+    }
+end:
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return res;
+}
+
+static ipm_result copy_between_objects(
+        const ipm_context* context, int in_fd, off_t in_offset, int out_fd, off_t out_offset, size_t size,
+        const char* what)
+{
+    //  Data never passes through the user space, and filesystems which support it share the extents instead of copying
+    while (size > 0)
+    {
+        const ssize_t copied = copy_file_range(in_fd, &in_offset, out_fd, &out_offset, size, 0);
+        if (copied <= 0)
+        {
+            if (copied == 0)
+            {
+                IPM_ERROR(context, "Source ended before %s was copied", what);
+                return IPM_RESULT_ERR_BAD_SIZE;
+            }
+            switch (errno)
+            {
+            case EINTR:
+                continue;
+            case ENOSYS:
+            case EXDEV:
+            case EOPNOTSUPP:
+            case EINVAL:
+                //  Objects on different filesystems, or a filesystem which can not do it, so pages go through a pipe
+                return splice_between_objects(context, in_fd, &in_offset, out_fd, &out_offset, size, what);
+            default:
+                return copy_error_to_result(context, what);
+            }
+        }
+        size -= (size_t)copied;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result shared_memory_block_copy_range(
+        const ipm_context* context, const ipm_shared_memory_block* src, size_t src_offset,
+        const ipm_shared_memory_block* dst, size_t dst_offset, size_t size)
+{
+    assert(src_offset + size <= src->size);
+    assert(dst_offset + size <= dst->size);
+    return copy_between_objects(
+            context, src->mem_fd, (off_t)(src->data_offset + src_offset), dst->mem_fd,
+            (off_t)(dst->data_offset + dst_offset), size, "the range between blocks");
+}
+
+ipm_result shared_memory_block_copy_file(
+        const ipm_context* context, const ipm_shared_memory_block* block, size_t offset, int fd, off_t file_offset,
+        size_t size, ipm_bool to_file)
+{
+    assert(offset + size <= block->size);
+    const off_t block_offset = (off_t)(block->data_offset + offset);
+    if (to_file)
+    {
+        return copy_between_objects(context, block->mem_fd, block_offset, fd, file_offset, size, "the block to the file");
+    }
+    //  File is read once from start to end, so the kernel should read ahead of the copy as far as it can
+    (void)posix_fadvise(fd, file_offset, (off_t)size, POSIX_FADV_SEQUENTIAL);
+    (void)posix_fadvise(fd, file_offset, (off_t)size, POSIX_FADV_WILLNEED);
+    return copy_between_objects(context, fd, file_offset, block->mem_fd, block_offset, size, "the file to the block");
+}
+
+ipm_bool shared_memory_block_same_object(const ipm_shared_memory_block* block_1, const ipm_shared_memory_block* block_2)
+{
+    struct stat stat_1, stat_2;
+    if (fstat(block_1->mem_fd, &stat_1) < 0 || fstat(block_2->mem_fd, &stat_2) < 0)
+    {
+        return 0;
+    }
+    return stat_1.st_dev == stat_2.st_dev && stat_1.st_ino == stat_2.st_ino;
+}
+
+ipm_bool shared_memory_block_lock_byte(const ipm_shared_memory_block* block, unsigned byte)
+{
+    return lock_block_byte(block->mem_fd, F_WRLCK, byte, 0) == 0;
+}
+
+void shared_memory_block_unlock_byte(const ipm_shared_memory_block* block, unsigned byte)
+{
+    (void)lock_block_byte(block->mem_fd, F_UNLCK, byte, 0);
+}
+
+ipm_bool shared_memory_block_byte_is_locked(const ipm_shared_memory_block* block, unsigned byte)
+{
+    //  Lock is only tested, since taking it would replace one held through the same open file description
+    struct flock lock = {.l_type = F_RDLCK, .l_whence = SEEK_SET, .l_start = byte, .l_len = 1};
+#ifdef F_OFD_GETLK
+    const int res = fcntl(block->mem_fd, F_OFD_GETLK, &lock);
+#else
+    const int res = fcntl(block->mem_fd, F_GETLK, &lock);
+#endif
+    //  When the lock can not be tested, its holder is taken to be alive, since that is the safe mistake to make
+    return res < 0 || lock.l_type != F_UNLCK;
+}
+
+ipm_result shared_memory_block_map_window(
+        const ipm_context* context, const ipm_shared_memory_block* block, size_t offset, size_t size, void** p_window)
+{
+    assert((offset & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert((size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert(offset + size <= block->size);
+    const int protection = access_protection(block->access_mode);
+    void* const window = mmap(NULL, size, protection, MAP_SHARED, block->mem_fd, (off_t)(block->data_offset + offset));
+    if (window == MAP_FAILED)
+    {
+        IPM_ERROR(context, "Could not map window [%zu, %zu) of the block, reason: %s", offset, offset + size, strerror(errno));
+        switch (errno)
+        {
+        case EACCES:
+            return IPM_RESULT_ERR_ACCESS;
+        case EAGAIN:
+        case ENOMEM:
+            return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+        case EINVAL:
+            return IPM_RESULT_ERR_BAD_VALUE;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+    *p_window = window;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result shared_memory_block_map_mirrored(
+        const ipm_context* context, const ipm_shared_memory_block* block, size_t offset, size_t size, void** p_mapping)
+{
+    assert((offset & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert((size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert(offset + size <= block->size);
+    //  Both copies are placed into a single reserved range, so that nothing else can end up between them
+    uint8_t* const reserved = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED)
+    {
+        IPM_ERROR(context, "Could not reserve %zu bytes of address space, reason: %s", 2 * size, strerror(errno));
+        return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+    }
+    const int protection = access_protection(block->access_mode);
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        if (mmap(reserved + i * size, size, protection, MAP_SHARED | MAP_FIXED, block->mem_fd, (off_t)(block->data_offset + offset)) == MAP_FAILED)
+        {
+            const int error = errno;
+            (void)munmap(reserved, 2 * size);
+            IPM_ERROR(context, "Could not map region [%zu, %zu) of the block twice, reason: %s", offset, offset + size, strerror(error));
+            switch (error)
+            {
+            case EACCES:
+                return IPM_RESULT_ERR_ACCESS;
+            case EAGAIN:
+            case ENOMEM:
+                return IPM_RESULT_ERR_OS_OUT_OF_MEMORY;
+            default:
+                return IPM_RESULT_ERR_OS_UNEXPECTED;
+            }
+        }
+    }
+    *p_mapping = reserved;
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result shared_memory_block_protect_window(
+        const ipm_context* context, const ipm_shared_memory_block* block, void* window, size_t size)
+{
+    const int protection = access_protection(block->access_mode);
+    if (mprotect(window, size, protection) < 0)
+    {
+        IPM_ERROR(context, "Could not change the protection of the window, reason: %s", strerror(errno));
+        return IPM_RESULT_ERR_ACCESS;
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+void shared_memory_block_unmap_window(void* window, size_t size)
+{
+    (void)munmap(window, size);
+}
+
+ipm_result shared_memory_block_flush(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size)
+{
+    if (!block->is_persistent)
+    {
+        //  Nothing backs the block besides memory
+        return IPM_RESULT_SUCCESS;
+    }
+    assert((offset & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert((size & IPM_MEMORY_PAGE_SIZE_MASK) == 0);
+    assert(offset + size <= block->size);
+
+    //  The whole range is written back with a single call, followed by the header and the metadata
+    if (msync((uint8_t*)block->memory + offset, size, MS_SYNC) < 0 || msync(block->header, block->data_offset, MS_SYNC) < 0)
+    {
+        IPM_ERROR(context, "Could not flush the block to its file, reason: %s", strerror(errno));
+        switch (errno)
+        {
+        case EINVAL:
+        case ENOMEM:
+            return IPM_RESULT_ERR_BAD_VALUE;
+        case EBUSY:
+            return IPM_RESULT_ERR_ALREADY_LOCKED;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
+ipm_result shared_memory_block_remove(
+        const ipm_context* context, const char* directory, const char* block_name, ipm_id id)
+{
+    assert(strlen(block_name) <= IPM_MAX_NAME_LEN);
+    assert(!directory || strlen(directory) <= IPM_MAX_DIRECTORY_LEN);
+    char name_buffer[IPM_MAX_DIRECTORY_LEN + IPM_MAX_NAME_LEN + 32];
+    make_block_name_based_on_id(name_buffer, sizeof(name_buffer), directory, block_name, id);
+    if (unlink_block_object(directory, name_buffer) < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return IPM_RESULT_ERR_DOES_NOT_EXIST;
+        }
+        IPM_ERROR(context, "Could not unlink memory block %s, reason: %s", name_buffer, strerror(errno));
+        switch (errno)
+        {
+        case EACCES:
+        case EPERM:
+            return IPM_RESULT_ERR_ACCESS;
+        case EROFS:
+            return IPM_RESULT_ERR_BAD_FS;
+        default:
+            return IPM_RESULT_ERR_OS_UNEXPECTED;
+        }
+    }
+    return IPM_RESULT_SUCCESS;
+}
+
 ipm_result shared_memory_block_clean(ipm_shared_memory_block* block)
 {
     assert(block->has_ownership == 0);
-    ipm_shared_memory_header* header = block->header;
-    void* const mem = block->memory;
+    ipm_shared_memory_header* const header = block->header;
+    const size_t reserved = block->reserved;
     close(block->mem_fd);
 
     memset(block, 0xCC, sizeof(*block));
 
-    (void)munmap(mem, header->block_size);
-    (void)munmap(header, IPM_MEMORY_PAGE_SIZE);
-    header = NULL;
+    (void)munmap(header, reserved);
 
     return IPM_RESULT_SUCCESS;
 }
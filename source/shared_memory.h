@@ -7,14 +7,110 @@
 #include "../include/ipm/ipm_common.h"
 #include "ipm_platform.h"
 
+enum
+{
+    IPM_SHARED_MEMORY_MAGIC = 0x214D5049,   //  Marks objects made by this library, reads as "IPM!" on little-endian
+    IPM_SHARED_MEMORY_LAYOUT_VERSION = 8,   //  Incremented each time the layout of the shared memory object changes
+    IPM_SHARED_MEMORY_MAX_HINTS = 16,       //  Number of access pattern hints kept by the header and by each block
+    IPM_SHARED_MEMORY_MAX_PROTECTED_RANGES = IPM_MEMORY_MAX_PROTECTED_RANGES,   //  Separate read-only ranges of a block
+    IPM_SHARED_MEMORY_MAX_WATCHERS = 32,    //  Handles which can watch the block for events at the same time
+    //  Bytes of the object which handles keep locked while they are alive, so that others can tell when they are not,
+    //  even when they are in another PID namespace or their process ID was reused
+    IPM_SHARED_MEMORY_LOCK_WATCHERS = 64,   //  One byte for each watcher
+    IPM_SHARED_MEMORY_LOCK_USERS = 128,     //  Bytes which structures placed in the block lock for their own handles
+};
+
+enum ipm_shared_memory_state_T
+{
+    IPM_SHARED_MEMORY_STATE_CREATING = 0,   //  Object exists, but its creator did not yet initialize it
+    //  Object was fully initialized by its creator. Never 1, since versions of the library from before the state was
+    //  added read it as their layout version, which was 1, and would accept the object.
+    IPM_SHARED_MEMORY_STATE_READY = 2,
+};
+
+enum ipm_shared_memory_section_type_T
+{
+    IPM_SHARED_MEMORY_SECTION_HEADER = 0,   //  Page holding the header itself
+    IPM_SHARED_MEMORY_SECTION_METADATA = 1, //  Metadata of the block's user, such as the claim list
+    IPM_SHARED_MEMORY_SECTION_DATA = 2,     //  Contents of the block
+
+    IPM_SHARED_MEMORY_SECTION_COUNT,
+};
+
+struct ipm_shared_memory_section_T
+{
+    uint32_t type;
+    size_t offset;              //  Offset of the section from the start of the object
+    size_t size;
+};
+typedef struct ipm_shared_memory_section_T ipm_shared_memory_section;
+
+struct ipm_shared_memory_hint_T
+{
+    size_t offset;
+    size_t size;
+    uint32_t hint;
+};
+typedef struct ipm_shared_memory_hint_T ipm_shared_memory_hint;
+
+struct ipm_shared_memory_range_T
+{
+    size_t offset;
+    size_t size;
+};
+typedef struct ipm_shared_memory_range_T ipm_shared_memory_range;
+
+//  Handle watching the block for events, which are sent to the socket named after the state
+struct ipm_shared_memory_watcher_T
+{
+    uint64_t state;             //  Process ID, then 24 bits which tell its sockets apart, then 8 bits of events, or 0 if free
+    uint32_t pending;           //  Events sent but not yet taken, so none are lost when the socket's queue is full
+    ipm_id access_id;           //  Access ID of the handle, whose lock on the watcher's byte can not be tested by itself
+    size_t offset;              //  Range of the block in which released claims are reported
+    size_t size;
+};
+typedef struct ipm_shared_memory_watcher_T ipm_shared_memory_watcher;
+
+struct ipm_shared_memory_placement_T
+{
+    void* address;              //  Address at which to map the object, or NULL to let the system choose one
+    size_t max_size;            //  Largest size the block can grow to, since it can not be moved
+};
+typedef struct ipm_shared_memory_placement_T ipm_shared_memory_placement;
+
 struct ipm_shared_memory_header_T
 {
-    ipm_mut segment_mutex;
-    uint32_t refcount;
-    size_t block_size;
-    ipm_id id_counter;
+    //  Fields which are only written by the creator. First three keep their place in every layout.
+    uint32_t init_state;        //  Futex word which openers wait on
+    uint32_t magic;
+    uint32_t layout_version;
+    uint32_t section_count;
+    ipm_shared_memory_section sections[IPM_SHARED_MEMORY_SECTION_COUNT];
     ipm_id block_id;
+    uintptr_t fixed_address;    //  Address at which every process maps the object, or 0 if it is mapped anywhere
+    size_t fixed_reserved;      //  Size of the address range reserved at the fixed address, which limits the block size
+
+    //  Fields which are written often each have their own cache line, so that writing one does not slow the others down
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_mut segment_mutex;
+    _Alignas(IPM_CACHE_LINE_SIZE) uint32_t refcount;
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_id id_counter;
+
+    //  Fields which are read by every claim, but only change together with the size or the state of the whole block
+    _Alignas(IPM_CACHE_LINE_SIZE) size_t block_size;
+    ipm_id generation;          //  Incremented each time the block is resized
+    ipm_id snapshot_id;         //  ID of the snapshot currently being copied, or 0 when there is none
+    uint32_t sealed;            //  Block was sealed, so its contents and size can no longer change
+    uint32_t numa_policy;
+    uint64_t numa_node_mask;
+    uint32_t watcher_count;     //  Number of watchers, so that changes need not look through them when there are none
+
+    //  Fields which are rarely used
+    _Alignas(IPM_CACHE_LINE_SIZE) ipm_id snapshot_counter;  //  Counts the number of snapshots taken
+    size_t snapshot_size;       //  Size of the data copied by the current snapshot
+    uint32_t hint_count;
+    ipm_shared_memory_hint hints[IPM_SHARED_MEMORY_MAX_HINTS];  //  Access pattern hints applied by all openers
     char block_name[IPM_MAX_NAME_LEN + 1];
+    ipm_shared_memory_watcher watchers[IPM_SHARED_MEMORY_MAX_WATCHERS];
 };
 typedef struct ipm_shared_memory_header_T ipm_shared_memory_header;
 
@@ -22,22 +118,35 @@ struct ipm_shared_memory_block_T
 {
     ipm_id access_id;
     size_t size;
-    ipm_shared_memory_header* header;
+    ipm_shared_memory_header* header;   //  Start of the mapping, which holds the whole object
+    void* metadata;
     void* memory;
+    size_t data_offset;         //  Offset of the data from the start of the object
+    size_t reserved;            //  Size of the address range reserved for the mapping
     ipm_bool has_ownership;
     ipm_access_mode access_mode;
     int mem_fd;
+    ipm_bool is_persistent;     //  Block is backed by a regular file, which is kept when the block is closed
+    ipm_bool was_recovered;     //  Block was persistent and was opened when no other process had it open
+    ipm_id generation;          //  Generation of the block which the mapping corresponds to
+    ipm_bool is_windowed;       //  Only the header and metadata are mapped, while the data is mapped in windows
+    uint32_t hint_count;
+    ipm_shared_memory_hint hints[IPM_SHARED_MEMORY_MAX_HINTS];  //  Access pattern hints applied only by this handle
+    uint32_t protected_count;
+    ipm_shared_memory_range protected_ranges[IPM_SHARED_MEMORY_MAX_PROTECTED_RANGES];   //  Sorted read-only ranges
 };
 typedef struct ipm_shared_memory_block_T ipm_shared_memory_block;
 
 IPM_INTERNAL_FUNCTION
 ipm_result shared_memory_block_create(
-        const ipm_context* context, const char* block_name, ipm_id id, size_t size, ipm_access_mode access,
-        ipm_shared_memory_block* p_block);
+        const ipm_context* context, const char* directory, const char* block_name, ipm_id id, size_t metadata_size,
+        size_t size, ipm_access_mode access, ipm_result (* initialize)(ipm_shared_memory_block* block, void* param),
+        void* param, const ipm_shared_memory_placement* placement, ipm_shared_memory_block* p_block);
 
 IPM_INTERNAL_FUNCTION
 ipm_result shared_memory_block_open(
-        const ipm_context* context, const char* block_name, ipm_id id, ipm_access_mode access, ipm_shared_memory_block* p_block);
+        const ipm_context* context, const char* directory, const char* block_name, ipm_id id, ipm_access_mode access,
+        ipm_bool windowed, ipm_shared_memory_block* p_block);
 
 IPM_INTERNAL_FUNCTION
 ipm_result shared_memory_block_close(
@@ -57,7 +166,83 @@ IPM_INTERNAL_FUNCTION
 ipm_result shared_memory_block_update_mapping(
         const ipm_context* context, ipm_shared_memory_block* block, ipm_access_mode access_mode);
 
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_seal(const ipm_context* context, ipm_shared_memory_block* block);
+
+//  Changes the size of the block without updating the mapping, so that it can be called with mutexes within the block
+//  held. Mapping has to be updated with shared_memory_block_update_mapping once they are unlocked.
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_truncate(const ipm_context* context, ipm_shared_memory_block* block, size_t new_size);
+
 IPM_INTERNAL_FUNCTION
 ipm_result shared_memory_block_resize(const ipm_context* context, ipm_shared_memory_block* block, size_t new_size);
 
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_discard(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_advise(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size, ipm_memory_hint hint,
+        ipm_bool shared);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_protect_range(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size, ipm_access_mode access);
+
+IPM_INTERNAL_FUNCTION
+ipm_bool shared_memory_block_is_protected(const ipm_shared_memory_block* block, size_t offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_copy_range(
+        const ipm_context* context, const ipm_shared_memory_block* src, size_t src_offset,
+        const ipm_shared_memory_block* dst, size_t dst_offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_copy_file(
+        const ipm_context* context, const ipm_shared_memory_block* block, size_t offset, int fd, off_t file_offset,
+        size_t size, ipm_bool to_file);
+
+//  Locks a byte of the object through the handle's open file description without waiting, which fails only when another
+//  handle has it locked. Lock is dropped when the handle is closed, or when its process ends in any way.
+IPM_INTERNAL_FUNCTION
+ipm_bool shared_memory_block_lock_byte(const ipm_shared_memory_block* block, unsigned byte);
+
+IPM_INTERNAL_FUNCTION
+void shared_memory_block_unlock_byte(const ipm_shared_memory_block* block, unsigned byte);
+
+//  Tells whether another handle has the byte locked, or whether that could not be checked
+IPM_INTERNAL_FUNCTION
+ipm_bool shared_memory_block_byte_is_locked(const ipm_shared_memory_block* block, unsigned byte);
+
+IPM_INTERNAL_FUNCTION
+ipm_bool shared_memory_block_same_object(const ipm_shared_memory_block* block_1, const ipm_shared_memory_block* block_2);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_map_window(
+        const ipm_context* context, const ipm_shared_memory_block* block, size_t offset, size_t size, void** p_window);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_map_mirrored(
+        const ipm_context* context, const ipm_shared_memory_block* block, size_t offset, size_t size, void** p_mapping);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_protect_window(
+        const ipm_context* context, const ipm_shared_memory_block* block, void* window, size_t size);
+
+IPM_INTERNAL_FUNCTION
+void shared_memory_block_unmap_window(void* window, size_t size);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_flush(
+        const ipm_context* context, ipm_shared_memory_block* block, size_t offset, size_t size);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_remove(
+        const ipm_context* context, const char* directory, const char* block_name, ipm_id id);
+
+IPM_INTERNAL_FUNCTION
+ipm_result shared_memory_block_set_numa_policy(
+        const ipm_context* context, ipm_shared_memory_block* block, ipm_numa_policy policy, uint64_t node_mask);
+
 #endif //IPM_SHARED_MEMORY_H
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_broadcast.h>
+
+enum
+{
+    READER_COUNT = 4,
+    RECORD_COUNT = 200000,
+    RECORD_WORDS = 8,
+};
+
+//  Every word of a record holds its sequence number, so a torn copy is easy to spot
+static void make_record(uint64_t record[RECORD_WORDS], uint64_t number)
+{
+    for (unsigned i = 0; i < RECORD_WORDS; ++i)
+    {
+        record[i] = number;
+    }
+}
+
+static int run_reader(const ipm_context* ctx, int ready_fd)
+{
+    ipm_memory* mem;
+    ipm_broadcast* broadcast;
+    ipm_result res = ipm_memory_open(ctx, "broadcast_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_broadcast_open(mem, &broadcast);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(write(ready_fd, "", 1) == 1);
+    close(ready_fd);
+
+    uint64_t last = UINT64_MAX;
+    for (;;)
+    {
+        uint64_t record[RECORD_WORDS];
+        size_t size;
+        uint64_t sequence;
+        res = ipm_broadcast_read(broadcast, record, sizeof(record), &size, &sequence);
+        if (res == IPM_RESULT_ERR_EMPTY)
+        {
+            res = ipm_broadcast_wait(broadcast, 100);
+            ASSERT(res == IPM_RESULT_SUCCESS || res == IPM_RESULT_ERR_TIMED_OUT);
+            continue;
+        }
+        if (res == IPM_RESULT_ERR_LAPPED)
+        {
+            continue;
+        }
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(size == sizeof(record));
+        ASSERT(last == UINT64_MAX || sequence > last);
+        for (unsigned i = 0; i < RECORD_WORDS; ++i)
+        {
+            ASSERT(record[i] == sequence);
+        }
+        last = sequence;
+        if (sequence == RECORD_COUNT - 1)
+        {
+            break;
+        }
+    }
+    ipm_broadcast_close(broadcast);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "broadcast_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_broadcast* writer;
+    res = ipm_broadcast_open(mem, &writer);
+    ASSERT(res == IPM_RESULT_ERR_BAD_INIT);
+    res = ipm_broadcast_create(mem, RECORD_WORDS * sizeof(uint64_t), 3, &writer);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_broadcast_record_size(writer) == RECORD_WORDS * sizeof(uint64_t));
+
+    //  Reader through a read-only handle does not need to write anything to read records
+    ipm_memory* read_only_mem;
+    res = ipm_memory_open(&ctx, "broadcast_block", IPM_ACCESS_MODE_READ_ONLY, &read_only_mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_broadcast* reader;
+    res = ipm_broadcast_open(read_only_mem, &reader);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    uint64_t record[RECORD_WORDS];
+    size_t size;
+    uint64_t sequence;
+    res = ipm_broadcast_read(reader, record, sizeof(record), &size, &sequence);
+    ASSERT(res == IPM_RESULT_ERR_EMPTY);
+    res = ipm_broadcast_wait(reader, 10);
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    res = ipm_broadcast_publish(reader, record, sizeof(record));
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    res = ipm_broadcast_publish(writer, record, sizeof(record) + 1);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        make_record(record, i);
+        res = ipm_broadcast_publish(writer, record, (size_t)(i + 1) * sizeof(uint64_t));
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    res = ipm_broadcast_read(reader, record, sizeof(uint64_t) / 2, &size, &sequence);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE && size == sizeof(uint64_t));
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        res = ipm_broadcast_read(reader, record, sizeof(record), &size, &sequence);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(sequence == i && size == (i + 1) * sizeof(uint64_t) && record[0] == i);
+    }
+    res = ipm_broadcast_read(reader, record, sizeof(record), &size, &sequence);
+    ASSERT(res == IPM_RESULT_ERR_EMPTY);
+
+    //  Capacity was rounded up to 4, so publishing 6 more overwrites the first 2 of them before the reader gets to them
+    for (uint64_t i = 3; i < 9; ++i)
+    {
+        make_record(record, i);
+        res = ipm_broadcast_publish(writer, record, sizeof(record));
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    res = ipm_broadcast_read(reader, record, sizeof(record), &size, &sequence);
+    ASSERT(res == IPM_RESULT_ERR_LAPPED);
+    for (uint64_t i = 6; i < 9; ++i)
+    {
+        res = ipm_broadcast_read(reader, record, sizeof(record), &size, &sequence);
+        ASSERT(res == IPM_RESULT_SUCCESS && sequence == i && record[RECORD_WORDS - 1] == i);
+    }
+    res = ipm_broadcast_read(reader, record, sizeof(record), &size, &sequence);
+    ASSERT(res == IPM_RESULT_ERR_EMPTY);
+    ipm_broadcast_close(reader);
+    ipm_memory_close(read_only_mem);
+    ipm_broadcast_close(writer);
+
+    //  Readers in other processes, which are lapped often by a writer that never waits for them
+    res = ipm_broadcast_create(mem, RECORD_WORDS * sizeof(uint64_t), 64, &writer);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    int ready_pipe[2];
+    ASSERT(pipe(ready_pipe) == 0);
+    pid_t children[READER_COUNT];
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        children[i] = fork();
+        ASSERT(children[i] != -1);
+        if (children[i] == 0)
+        {
+            close(ready_pipe[0]);
+            ipm_memory_clean(mem);
+            _exit(run_reader(&ctx, ready_pipe[1]));
+        }
+    }
+    close(ready_pipe[1]);
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        char c;
+        ASSERT(read(ready_pipe[0], &c, 1) == 1);
+    }
+    close(ready_pipe[0]);
+    for (uint64_t i = 0; i < RECORD_COUNT; ++i)
+    {
+        make_record(record, i);
+        res = ipm_broadcast_publish(writer, record, sizeof(record));
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        int ret_v;
+        ASSERT(waitpid(children[i], &ret_v, 0) == children[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+    ipm_broadcast_close(writer);
+
+    ipm_memory_close(mem);
+    return 0;
+}
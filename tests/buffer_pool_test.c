@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_buffer_pool.h>
+
+enum
+{
+    BUFFER_COUNT = 8,
+    BUFFER_WORDS = 64,
+    ITEM_COUNT = 50000,     //  Buffers passed through the pipeline
+};
+
+//  Stage 0 fills each buffer with its number, stage 1 adds one to every word, and stage 2 checks it and releases it
+static int run_stage(const ipm_context* ctx, unsigned stage)
+{
+    ipm_memory* mem;
+    ipm_buffer_pool* pool;
+    ipm_result res = ipm_memory_open(ctx, "buffer_pool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_buffer_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    unsigned transform, sink;
+    ASSERT(ipm_buffer_pool_find_consumer(pool, "transform", &transform) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_find_consumer(pool, "sink", &sink) == IPM_RESULT_SUCCESS);
+
+    for (uint64_t i = 0; i < ITEM_COUNT; ++i)
+    {
+        unsigned buffer;
+        if (stage == 0)
+        {
+            while ((res = ipm_buffer_pool_acquire(pool, &buffer)) == IPM_RESULT_ERR_POOL_EMPTY)
+            {
+                sched_yield();
+            }
+        }
+        else
+        {
+            while ((res = ipm_buffer_pool_receive_wait(pool, stage == 1 ? transform : sink, 100, &buffer)) == IPM_RESULT_ERR_TIMED_OUT)
+            {
+            }
+        }
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        uint64_t* const words = ipm_buffer_pool_pointer(pool, buffer);
+        for (unsigned j = 0; j < BUFFER_WORDS; ++j)
+        {
+            switch (stage)
+            {
+            case 0:
+                words[j] = i;
+                break;
+            case 1:
+                ASSERT(words[j] == i);
+                words[j] += 1;
+                break;
+            default:
+                ASSERT(words[j] == i + 1);
+                break;
+            }
+        }
+        switch (stage)
+        {
+        case 0:
+            res = ipm_buffer_pool_hand_off(pool, buffer, transform);
+            break;
+        case 1:
+            res = ipm_buffer_pool_hand_off(pool, buffer, sink);
+            break;
+        default:
+            res = ipm_buffer_pool_release(pool, buffer);
+            break;
+        }
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    ipm_buffer_pool_close(pool);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+static int run_exiting_holder(const ipm_context* ctx)
+{
+    ipm_memory* mem;
+    ipm_buffer_pool* pool;
+    ipm_result res = ipm_memory_open(ctx, "buffer_pool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_buffer_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    unsigned buffer;
+    ASSERT(ipm_buffer_pool_acquire(pool, &buffer) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_acquire(pool, &buffer) == IPM_RESULT_SUCCESS);
+    //  Exits without releasing either buffer, but closes the block, so that it is removed at the end of the test
+    ipm_buffer_pool_close(pool);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+static int run_crashing_holder(const ipm_context* ctx, int ready_fd, int exit_fd)
+{
+    ipm_memory* mem;
+    ipm_buffer_pool* pool;
+    ipm_result res = ipm_memory_open(ctx, "buffer_pool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_buffer_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    unsigned buffer;
+    ASSERT(ipm_buffer_pool_acquire(pool, &buffer) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_acquire(pool, &buffer) == IPM_RESULT_SUCCESS);
+    //  Holds the buffers until told to exit, then exits without closing the pool, but closes the block, so that it is
+    //  removed at the end of the test
+    char c = 0;
+    ASSERT(write(ready_fd, &c, 1) == 1);
+    ASSERT(read(exit_fd, &c, 1) == 1);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+static void acquire_all(ipm_buffer_pool* pool, unsigned buffers[BUFFER_COUNT])
+{
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i)
+    {
+        ASSERT(ipm_buffer_pool_acquire(pool, buffers + i) == IPM_RESULT_SUCCESS);
+    }
+    unsigned buffer;
+    ASSERT(ipm_buffer_pool_acquire(pool, &buffer) == IPM_RESULT_ERR_POOL_EMPTY);
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "buffer_pool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_buffer_pool* pool;
+    res = ipm_buffer_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_ERR_BAD_INIT);
+    const char* const consumer_names[] = {"transform", "sink"};
+    res = ipm_buffer_pool_create(mem, BUFFER_WORDS * sizeof(uint64_t), BUFFER_COUNT, consumer_names, 2, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_buffer_size(pool) == BUFFER_WORDS * sizeof(uint64_t));
+    unsigned transform, sink, consumer;
+    ASSERT(ipm_buffer_pool_find_consumer(pool, "transform", &transform) == IPM_RESULT_SUCCESS && transform == 0);
+    ASSERT(ipm_buffer_pool_find_consumer(pool, "sink", &sink) == IPM_RESULT_SUCCESS && sink == 1);
+    ASSERT(ipm_buffer_pool_find_consumer(pool, "source", &consumer) == IPM_RESULT_ERR_BAD_VALUE);
+
+    //  Buffers handed off are received in order, and only their holder may hand them off or release them
+    unsigned buffers[BUFFER_COUNT];
+    acquire_all(pool, buffers);
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i)
+    {
+        ASSERT(ipm_buffer_pool_hand_off(pool, buffers[i], sink) == IPM_RESULT_SUCCESS);
+    }
+    ASSERT(ipm_buffer_pool_release(pool, buffers[0]) == IPM_RESULT_ERR_BAD_VALUE);
+    ASSERT(ipm_buffer_pool_hand_off(pool, buffers[0], transform) == IPM_RESULT_ERR_BAD_VALUE);
+    unsigned buffer;
+    ASSERT(ipm_buffer_pool_receive(pool, transform, &buffer) == IPM_RESULT_ERR_EMPTY);
+    ASSERT(ipm_buffer_pool_receive_wait(pool, transform, 10, &buffer) == IPM_RESULT_ERR_TIMED_OUT);
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i)
+    {
+        ASSERT(ipm_buffer_pool_receive(pool, sink, &buffer) == IPM_RESULT_SUCCESS && buffer == buffers[i]);
+        ASSERT(ipm_buffer_pool_release(pool, buffer) == IPM_RESULT_SUCCESS);
+    }
+    ASSERT(ipm_buffer_pool_receive(pool, sink, &buffer) == IPM_RESULT_ERR_EMPTY);
+    ASSERT(ipm_buffer_pool_release(pool, buffers[0]) == IPM_RESULT_ERR_BAD_VALUE);
+    ASSERT(ipm_buffer_pool_hand_off(pool, buffers[0], 2) == IPM_RESULT_ERR_BAD_VALUE);
+    ASSERT(ipm_buffer_pool_receive(pool, 2, &buffer) == IPM_RESULT_ERR_BAD_VALUE);
+    ASSERT(ipm_buffer_pool_receive_wait(pool, 2, 10, &buffer) == IPM_RESULT_ERR_BAD_VALUE);
+
+    //  Buffers of a handle open through another memory handle are only reclaimed once it is closed
+    ipm_memory* other_mem;
+    ipm_buffer_pool* other_pool;
+    ASSERT(ipm_memory_open(&ctx, "buffer_pool_block", IPM_ACCESS_MODE_READ_WRITE, &other_mem) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_open(other_mem, &other_pool) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_acquire(other_pool, &buffer) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_release(pool, buffer) == IPM_RESULT_ERR_BAD_VALUE);
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 0);
+    ipm_buffer_pool_close(other_pool);
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 1);
+    ipm_memory_close(other_mem);
+
+    //  Buffers of a process which exits while holding them are returned by reclaiming them
+    pid_t child = fork();
+    ASSERT(child != -1);
+    if (child == 0)
+    {
+        ipm_memory_clean(mem);
+        _exit(run_exiting_holder(&ctx));
+    }
+    int ret_v;
+    ASSERT(waitpid(child, &ret_v, 0) == child);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    ASSERT(ipm_buffer_pool_acquire(pool, &buffer) == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 2);
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 0);
+    ASSERT(ipm_buffer_pool_release(pool, buffer) == IPM_RESULT_SUCCESS);
+    acquire_all(pool, buffers);
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i)
+    {
+        ASSERT(ipm_buffer_pool_release(pool, buffers[i]) == IPM_RESULT_SUCCESS);
+    }
+
+    //  Buffers of a process which is alive are kept, and those of one which crashed are reclaimed
+    int ready_pipe[2], exit_pipe[2];
+    ASSERT(pipe(ready_pipe) == 0 && pipe(exit_pipe) == 0);
+    child = fork();
+    ASSERT(child != -1);
+    if (child == 0)
+    {
+        ipm_memory_clean(mem);
+        _exit(run_crashing_holder(&ctx, ready_pipe[1], exit_pipe[0]));
+    }
+    char c;
+    ASSERT(read(ready_pipe[0], &c, 1) == 1);
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 0);
+    ASSERT(write(exit_pipe[1], &c, 1) == 1);
+    ASSERT(waitpid(child, &ret_v, 0) == child);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 2);
+    close(ready_pipe[0]);
+    close(ready_pipe[1]);
+    close(exit_pipe[0]);
+    close(exit_pipe[1]);
+
+    //  Pipeline of three processes passing the buffers on without copying them
+    pid_t children[3];
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        children[i] = fork();
+        ASSERT(children[i] != -1);
+        if (children[i] == 0)
+        {
+            ipm_memory_clean(mem);
+            _exit(run_stage(&ctx, i));
+        }
+    }
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        ASSERT(waitpid(children[i], &ret_v, 0) == children[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+    ASSERT(ipm_buffer_pool_reclaim(pool) == 0);
+    acquire_all(pool, buffers);
+    ipm_buffer_pool_close(pool);
+
+    ipm_memory_close(mem);
+    return 0;
+}
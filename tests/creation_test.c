@@ -0,0 +1,129 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+#include <unistd.h>
+#include <wait.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+static int create_abandoned_object(const char* name, int lock_it)
+{
+    //  Object is created the way the library does it, but its header is never initialized
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    ASSERT(fd >= 0);
+    if (lock_it)
+    {
+        struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 2, .l_len = 1};
+        ASSERT(fcntl(fd, F_OFD_SETLK, &lock) == 0);
+    }
+    ASSERT(ftruncate(fd, 2 * 4096) == 0);
+    return fd;
+}
+
+static double elapsed_ms(const struct timespec* begin)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - begin->tv_sec) * 1e3 + (double)(now.tv_nsec - begin->tv_nsec) / 1e6;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+    //  Name of the object holding the memory of a block, which has the ID of 1
+    char object_name[64];
+    snprintf(object_name, sizeof(object_name), "/%s-%#016lX", "cool_block", 1LU);
+    struct timespec begin;
+
+    //  Opening a block whose creator died right away reports it does not exist, without waiting for the timeout
+    close(create_abandoned_object(object_name, 0));
+    ipm_memory* mem = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    ipm_result res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_ERR_DOES_NOT_EXIST);
+    ASSERT(elapsed_ms(&begin) < IPM_DEFAULT_OPEN_TIMEOUT_MS);
+
+    //  Creating a block takes over the object which was abandoned
+    close(create_abandoned_object(object_name, 0));
+    res = ipm_memory_create(&ctx, 69, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_memory_close(mem);
+
+    //  While the creator is alive, openers sleep until it dies
+    pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        (void)create_abandoned_object(object_name, 1);
+        usleep(300000);
+        _exit(EXIT_SUCCESS);
+    }
+    usleep(50000);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_ERR_DOES_NOT_EXIST);
+    const double waited = elapsed_ms(&begin);
+    ASSERT(waited > 100 && waited < IPM_DEFAULT_OPEN_TIMEOUT_MS);
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+
+    //  Object with a layout from another version of the library is refused, rather than being misread
+    int fd = create_abandoned_object(object_name, 0);
+    const uint32_t header_words[3] = {1, 0x214D5049, 1};
+    ASSERT(pwrite(fd, header_words, sizeof(header_words), 0) == sizeof(header_words));
+    close(fd);
+    res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VERSION);
+    ASSERT(shm_unlink(object_name) == 0);
+
+    //  Object from before the state was added starts with its layout version, and is neither waited on nor removed
+    fd = create_abandoned_object(object_name, 0);
+    const uint32_t old_header_words[2] = {1, 3};
+    ASSERT(pwrite(fd, old_header_words, sizeof(old_header_words), 0) == sizeof(old_header_words));
+    close(fd);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VERSION);
+    ASSERT(elapsed_ms(&begin) < IPM_DEFAULT_OPEN_TIMEOUT_MS);
+    ASSERT(shm_unlink(object_name) == 0);
+
+    //  Many openers started together with the creator all get the block once it is ready
+    enum {OPENER_COUNT = 8};
+    pid_t openers[OPENER_COUNT];
+    for (unsigned i = 0; i < OPENER_COUNT; ++i)
+    {
+        openers[i] = fork();
+        ASSERT(openers[i] != -1);
+        if (openers[i] == 0)
+        {
+            while ((res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_ONLY, &mem)) == IPM_RESULT_ERR_DOES_NOT_EXIST)
+            {
+                usleep(1000);
+            }
+            ASSERT(res == IPM_RESULT_SUCCESS);
+            ASSERT(ipm_memory_get_info(mem).block_size == 4096);
+            ipm_memory_close(mem);
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    res = ipm_memory_create(&ctx, 4096, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    for (unsigned i = 0; i < OPENER_COUNT; ++i)
+    {
+        ASSERT(waitpid(openers[i], &ret_v, 0) == openers[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+    ipm_memory_close(mem);
+
+    return 0;
+}
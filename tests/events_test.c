@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <poll.h>
+#include <unistd.h>
+#include <wait.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+
+//  Checks whether the descriptor is readable, waiting for at most the given time
+static int is_readable(int fd, int timeout_ms)
+{
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    const int n = poll(&pfd, 1, timeout_ms);
+    ASSERT(n >= 0);
+    return n > 0 && (pfd.revents & POLLIN);
+}
+
+enum
+{
+    MAX_WATCHERS = 32,
+};
+
+//  Watches the block, but makes its socket unreachable, like that of a watcher in another network namespace
+static int run_unreachable_watcher(const ipm_context* ctx, int ready_fd, int ring_fd)
+{
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_open(ctx, "events_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    int fd;
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    const int null_fd = open("/dev/null", O_RDONLY);
+    ASSERT(null_fd >= 0 && dup2(null_fd, fd) == fd);
+    close(null_fd);
+    //  Doorbell keeps being reported through the block after the first one failed to reach the socket
+    char c = 0;
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        ASSERT(write(ready_fd, &c, 1) == 1);
+        ASSERT(read(ring_fd, &c, 1) == 1);
+        ASSERT(ipm_memory_take_events(mem) == IPM_MEMORY_EVENT_DOORBELL);
+    }
+    ipm_memory_close(mem);
+    return 0;
+}
+
+//  Watches the block, then exits without closing its handle
+static int run_crashing_watcher(const ipm_context* ctx)
+{
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_open(ctx, "events_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    int fd;
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    return 0;
+}
+
+static int run_ringer(const ipm_context* ctx)
+{
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_open(ctx, "events_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_ring_doorbell(mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4 * 4096, "events_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_memory* other;
+    res = ipm_memory_open(&ctx, "events_block", IPM_ACCESS_MODE_READ_WRITE, &other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    //  Nothing is watched yet, so there is nothing to take and the doorbell reaches no one
+    ASSERT(ipm_memory_take_events(mem) == 0);
+    res = ipm_memory_ring_doorbell(other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    int fd;
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_ALL, 4096, 4096, &fd);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(fd >= 0);
+    ASSERT(!is_readable(fd, 0));
+
+    //  Claims released outside the watched range are not reported
+    ipm_id claim;
+    res = ipm_memory_claim_region(other, IPM_ACCESS_MODE_READ_WRITE, 0, 4096, &claim);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_release_region(other, claim);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(!is_readable(fd, 0));
+    res = ipm_memory_claim_region(other, IPM_ACCESS_MODE_READ_ONLY, 4000, 200, &claim);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_release_region(other, claim);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(is_readable(fd, 10000));
+    ASSERT(ipm_memory_take_events(mem) == IPM_MEMORY_EVENT_RELEASED);
+    ASSERT(!is_readable(fd, 0));
+
+    //  Events which happen before they are taken are combined
+    res = ipm_memory_resize_grow(other, 8 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_ring_doorbell(other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(is_readable(fd, 10000));
+    ASSERT(ipm_memory_take_events(mem) == (IPM_MEMORY_EVENT_RESIZED | IPM_MEMORY_EVENT_DOORBELL));
+    res = ipm_memory_sync(mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Watching again only changes the events, and the doorbell reaches it from another process
+    int same_fd;
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &same_fd);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(same_fd == fd);
+    res = ipm_memory_claim_region(other, IPM_ACCESS_MODE_READ_WRITE, 4096, 4096, &claim);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_release_region(other, claim);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(!is_readable(fd, 0));
+    const pid_t child = fork();
+    ASSERT(child != -1);
+    if (child == 0)
+    {
+        ipm_memory_clean(other);
+        ipm_memory_clean(mem);
+        _exit(run_ringer(&ctx));
+    }
+    ASSERT(is_readable(fd, 10000));
+    int ret_v;
+    ASSERT(waitpid(child, &ret_v, 0) == child);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    ASSERT(ipm_memory_take_events(mem) == IPM_MEMORY_EVENT_DOORBELL);
+
+    //  Handle which no longer watches the block receives nothing
+    ipm_memory_unwatch(mem);
+    ASSERT(ipm_memory_take_events(mem) == 0);
+    res = ipm_memory_ring_doorbell(other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_take_events(mem) == 0);
+
+    //  Watcher whose socket can not be reached is kept while its handle is open, and its slot is freed once it closes
+    int ready_pipe[2], ring_pipe[2];
+    ASSERT(pipe(ready_pipe) == 0 && pipe(ring_pipe) == 0);
+    pid_t watcher = fork();
+    ASSERT(watcher != -1);
+    if (watcher == 0)
+    {
+        ipm_memory_clean(other);
+        ipm_memory_clean(mem);
+        _exit(run_unreachable_watcher(&ctx, ready_pipe[1], ring_pipe[0]));
+    }
+    char c;
+    ASSERT(read(ready_pipe[0], &c, 1) == 1);
+    ipm_memory* watchers[MAX_WATCHERS - 1];
+    for (unsigned i = 0; i < MAX_WATCHERS - 1; ++i)
+    {
+        res = ipm_memory_open(&ctx, "events_block", IPM_ACCESS_MODE_READ_WRITE, watchers + i);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_memory_watch(watchers[i], IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    res = ipm_memory_ring_doorbell(other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+    ASSERT(res == IPM_RESULT_ERR_FULL);
+    ASSERT(write(ring_pipe[1], &c, 1) == 1);
+    ASSERT(read(ready_pipe[0], &c, 1) == 1);
+    res = ipm_memory_ring_doorbell(other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(write(ring_pipe[1], &c, 1) == 1);
+    ASSERT(waitpid(watcher, &ret_v, 0) == watcher);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_memory_unwatch(mem);
+    close(ready_pipe[0]);
+    close(ready_pipe[1]);
+    close(ring_pipe[0]);
+    close(ring_pipe[1]);
+
+    //  Watcher of a process which exited without closing its handle is removed once an event is sent to it
+    watcher = fork();
+    ASSERT(watcher != -1);
+    if (watcher == 0)
+    {
+        ipm_memory_clean(other);
+        ipm_memory_clean(mem);
+        for (unsigned i = 0; i < MAX_WATCHERS - 1; ++i)
+        {
+            ipm_memory_clean(watchers[i]);
+        }
+        _exit(run_crashing_watcher(&ctx));
+    }
+    ASSERT(waitpid(watcher, &ret_v, 0) == watcher);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+    ASSERT(res == IPM_RESULT_ERR_FULL);
+    res = ipm_memory_ring_doorbell(other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_watch(mem, IPM_MEMORY_EVENT_DOORBELL, 0, 0, &fd);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    for (unsigned i = 0; i < MAX_WATCHERS - 1; ++i)
+    {
+        ipm_memory_close(watchers[i]);
+    }
+
+    ipm_memory_close(other);
+    ipm_memory_close(mem);
+    //  Process which exited without closing its handle left a reference behind, so the object is removed here
+    char object_name[64];
+    snprintf(object_name, sizeof(object_name), "/%s-%#016lX", "events_block", 1LU);
+    ASSERT(shm_unlink(object_name) == 0);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+
+enum {FILE_SIZE = 64 * 4096 + 123};
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    char in_path[] = "/tmp/ipm_file_in_XXXXXX";
+    char out_path[] = "/tmp/ipm_file_out_XXXXXX";
+    const int in_fd = mkstemp(in_path);
+    ASSERT(in_fd >= 0);
+    const int out_fd = mkstemp(out_path);
+    ASSERT(out_fd >= 0);
+    unlink(in_path);
+    unlink(out_path);
+
+    char* const contents = malloc(FILE_SIZE);
+    ASSERT(contents);
+    for (unsigned i = 0; i < FILE_SIZE; ++i)
+    {
+        contents[i] = (char)(i * 13 + i / 4096);
+    }
+    ASSERT(write(in_fd, contents, FILE_SIZE) == FILE_SIZE);
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 2 * FILE_SIZE, "file_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    const char* const ptr = ipm_memory_pointer(mem);
+
+    //  Whole file is loaded at the start of the block, then a part of it at an unaligned offset
+    res = ipm_memory_load_file(mem, in_fd, 0, 0, FILE_SIZE);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp(ptr, contents, FILE_SIZE) == 0);
+    res = ipm_memory_load_file(mem, in_fd, 4096 + 7, FILE_SIZE + 3, 5 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp(ptr + FILE_SIZE + 3, contents + 4096 + 7, 5 * 4096) == 0);
+    res = ipm_memory_load_file(mem, in_fd, FILE_SIZE - 10, 0, 20);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+    res = ipm_memory_load_file(mem, in_fd, 0, FILE_SIZE, 2 * FILE_SIZE);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+
+    //  Loading in parallel gives the same contents
+    memset(ipm_memory_pointer(mem), 0, 2 * FILE_SIZE);
+    res = ipm_memory_load_file_parallel(mem, in_fd, 0, 0, FILE_SIZE, 4);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp(ptr, contents, FILE_SIZE) == 0);
+    res = ipm_memory_load_file_parallel(mem, in_fd, 0, FILE_SIZE + 3, FILE_SIZE, 4);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp(ptr + FILE_SIZE + 3, contents, FILE_SIZE) == 0);
+
+    //  Region overlapping a range protected for read-only access is not loaded, neither by the kernel nor through the
+    //  mapping, while dumping it is fine
+    res = ipm_memory_protect_range(mem, 4096, 4096, IPM_ACCESS_MODE_READ_ONLY);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_load_file(mem, in_fd, 0, 4000, 200);
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    res = ipm_memory_load_file_parallel(mem, in_fd, 0, 0, FILE_SIZE, 4);
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    ASSERT(memcmp(ptr, contents, FILE_SIZE) == 0);
+    res = ipm_memory_dump_file(mem, 4096, out_fd, 0, 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_protect_range(mem, 4096, 4096, IPM_ACCESS_MODE_READ_WRITE);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Dumped region of the block matches the original file
+    res = ipm_memory_dump_file(mem, 0, out_fd, 0, FILE_SIZE);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    char* const dumped = malloc(FILE_SIZE);
+    ASSERT(dumped);
+    ASSERT(pread(out_fd, dumped, FILE_SIZE, 0) == FILE_SIZE);
+    ASSERT(memcmp(dumped, contents, FILE_SIZE) == 0);
+
+    free(dumped);
+    free(contents);
+    ipm_memory_close(mem);
+    close(out_fd);
+    close(in_fd);
+    return 0;
+}
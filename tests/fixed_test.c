@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+#include <unistd.h>
+#include <wait.h>
+
+struct node_T
+{
+    struct node_T* next;
+    int value;
+};
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem = NULL;
+    ipm_result res = ipm_memory_create_fixed(&ctx, NULL, 4096, 4 * 4096, "fixed_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  List which links its nodes with raw pointers
+    struct node_T* const nodes = ipm_memory_pointer(mem);
+    for (int i = 0; i < 4; ++i)
+    {
+        nodes[i].next = i < 3 ? nodes + i + 1 : NULL;
+        nodes[i].value = i;
+    }
+
+    //  Address of the block is already taken by the handle of this process
+    ipm_memory* other;
+    res = ipm_memory_open(&ctx, "fixed_block", IPM_ACCESS_MODE_READ_WRITE, &other);
+    ASSERT(res == IPM_RESULT_ERR_ADDRESS_IN_USE);
+
+    const pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        //  Mapping inherited from the parent is dropped, so the block is opened again at the same address
+        ipm_memory_clean(mem);
+        res = ipm_memory_open(&ctx, "fixed_block", IPM_ACCESS_MODE_READ_ONLY, &mem);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(ipm_memory_pointer(mem) == nodes);
+        int sum = 0;
+        for (const struct node_T* node = ipm_memory_pointer(mem); node; node = node->next)
+        {
+            sum += node->value;
+        }
+        ASSERT(sum == 6);
+        ipm_memory_close(mem);
+        exit(EXIT_SUCCESS);
+    }
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+
+    //  Block can grow up to its maximum size in place, but not past it
+    res = ipm_memory_resize_grow(mem, 4 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_pointer(mem) == nodes);
+    res = ipm_memory_resize_grow(mem, 5 * 4096);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+    ASSERT(ipm_memory_pointer(mem) == nodes);
+    ASSERT(ipm_memory_get_info(mem).block_size == 4 * 4096);
+
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -3,6 +3,8 @@
 #include <ipm/ipm_memory.h>
 #include <unistd.h>
 #include <wait.h>
+#include <errno.h>
+#include <sys/mman.h>
 
 
 int main()
@@ -64,6 +66,30 @@ int main()
         ASSERT(child_id == pid);
     }
 
+    //  Child cleans a handle the parent opened twice through the cache with a single call, which unmaps it
+    ipm_memory* cached_1;
+    ipm_memory* cached_2;
+    res = ipm_memory_open_cached(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &cached_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_open_cached(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &cached_2);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(cached_1 == cached_2);
+    pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        void* const cached_ptr = ipm_memory_pointer(cached_1);
+        ipm_memory_clean(mem);
+        ipm_memory_clean(cached_1);
+        ASSERT(msync(cached_ptr, 1, MS_ASYNC) == -1 && errno == ENOMEM);
+        exit(EXIT_SUCCESS);
+    }
+    int ret_v;
+    ASSERT(waitpid(pid, &ret_v, 0) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    ipm_memory_close(cached_2);
+    ipm_memory_close(cached_1);
+
     ipm_memory_close(mem);
     //  This should report error message if correct, since the block has to get cleaned up
     res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_shm_heap.h>
+
+enum
+{
+    REGION_COUNT = 300,
+    STRESS_PROCESSES = 4,
+    STRESS_ROUNDS = 40,
+    STRESS_MAX_REGIONS = 32 + STRESS_ROUNDS * 24,
+};
+
+static size_t region_size(unsigned i)
+{
+    return 1 + (i * 97) % 5000;
+}
+
+static void fill_regions(ipm_memory* mem, const size_t* offsets, unsigned first, unsigned end, char seed)
+{
+    char* const ptr = ipm_memory_pointer(mem);
+    for (unsigned i = first; i < end; ++i)
+    {
+        memset(ptr + offsets[i], (char)(seed + i), region_size(i));
+    }
+}
+
+static int check_regions(ipm_memory* mem, const size_t* offsets, unsigned first, unsigned end, char seed)
+{
+    const char* const ptr = ipm_memory_pointer(mem);
+    for (unsigned i = first; i < end; ++i)
+    {
+        for (size_t j = 0; j < region_size(i); ++j)
+        {
+            if (ptr[offsets[i] + j] != (char)(seed + i))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static size_t stress_size(unsigned process, unsigned i)
+{
+    return 1 + (i * 131 + process * 17) % 2048;
+}
+
+//  Allocates more regions each round, so that the heap keeps growing while the others pop regions carved past their mapping
+static int run_stress(const ipm_context* ctx, unsigned process)
+{
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_open(ctx, "heap_stress_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_shm_heap* heap;
+    res = ipm_shm_heap_open(mem, &heap);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    static size_t offsets[STRESS_MAX_REGIONS];
+    for (unsigned round = 0; round < STRESS_ROUNDS; ++round)
+    {
+        const unsigned count = 32 + round * 24;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            res = ipm_shm_alloc(heap, stress_size(process, i), offsets + i);
+            ASSERT(res == IPM_RESULT_SUCCESS);
+        }
+        char* const ptr = ipm_memory_pointer(mem);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            memset(ptr + offsets[i], (char)(process * 64 + i), stress_size(process, i));
+        }
+        for (unsigned i = 0; i < count; ++i)
+        {
+            for (size_t j = 0; j < stress_size(process, i); ++j)
+            {
+                ASSERT(ptr[offsets[i] + j] == (char)(process * 64 + i));
+            }
+        }
+        for (unsigned i = 0; i < count; ++i)
+        {
+            res = ipm_shm_free(heap, offsets[i]);
+            ASSERT(res == IPM_RESULT_SUCCESS);
+        }
+    }
+    ipm_shm_heap_close(heap);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "heap_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_shm_heap* heap;
+    res = ipm_shm_heap_open(mem, &heap);
+    ASSERT(res == IPM_RESULT_ERR_BAD_INIT);
+    res = ipm_shm_heap_create(mem, &heap);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Regions of many sizes do not overlap, even as the heap grows the block
+    size_t offsets[REGION_COUNT];
+    for (unsigned i = 0; i < REGION_COUNT; ++i)
+    {
+        res = ipm_shm_alloc(heap, region_size(i), offsets + i);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(offsets[i] % 16 == 0);
+    }
+    fill_regions(mem, offsets, 0, REGION_COUNT, 1);
+    ASSERT(check_regions(mem, offsets, 0, REGION_COUNT, 1));
+
+    //  Freed regions are reused, so allocating them again does not grow the block
+    const size_t grown_size = ipm_memory_get_info(mem).block_size;
+    for (unsigned i = 0; i < REGION_COUNT; ++i)
+    {
+        res = ipm_shm_free(heap, offsets[i]);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    res = ipm_shm_free(heap, offsets[0]);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    res = ipm_shm_free(heap, 8);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    for (unsigned i = 0; i < REGION_COUNT; ++i)
+    {
+        res = ipm_shm_alloc(heap, region_size(i), offsets + i);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    ASSERT(ipm_memory_get_info(mem).block_size == grown_size);
+    fill_regions(mem, offsets, 0, REGION_COUNT, 1);
+
+    //  Large regions are reused for smaller large allocations
+    size_t large_1, large_2;
+    res = ipm_shm_alloc(heap, 3 << 20, &large_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    memset((char*)ipm_memory_pointer(mem) + large_1, 0x5A, 3 << 20);
+    res = ipm_shm_free(heap, large_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_shm_alloc(heap, 2 << 20, &large_2);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(large_1 == large_2);
+    ASSERT(check_regions(mem, offsets, 0, REGION_COUNT, 1));
+
+    //  Growing past the reserved address range moves the mapping, after which the heap and its regions are still there
+    const void* const unmoved = ipm_memory_pointer(mem);
+    size_t huge;
+    res = ipm_shm_alloc(heap, 96 << 20, &huge);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_pointer(mem) != unmoved);
+    ASSERT(check_regions(mem, offsets, 0, REGION_COUNT, 1));
+    res = ipm_shm_free(heap, huge);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Other process frees regions allocated by this one and allocates its own, without overlapping the rest
+    const pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        ipm_memory_clean(mem);
+        ipm_memory* mem_child;
+        ipm_shm_heap* heap_child;
+        res = ipm_memory_open(&ctx, "heap_block", IPM_ACCESS_MODE_READ_WRITE, &mem_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_shm_heap_open(mem_child, &heap_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        for (unsigned i = 0; i < REGION_COUNT / 2; ++i)
+        {
+            res = ipm_shm_free(heap_child, offsets[i]);
+            ASSERT(res == IPM_RESULT_SUCCESS);
+        }
+        size_t child_offsets[REGION_COUNT];
+        for (unsigned i = 0; i < REGION_COUNT; ++i)
+        {
+            res = ipm_shm_alloc(heap_child, region_size(i), child_offsets + i);
+            ASSERT(res == IPM_RESULT_SUCCESS);
+        }
+        fill_regions(mem_child, child_offsets, 0, REGION_COUNT, 2);
+        ipm_shm_heap_close(heap_child);
+        ipm_memory_close(mem_child);
+        _exit(EXIT_SUCCESS);
+    }
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    if (ipm_memory_needs_sync(mem))
+    {
+        res = ipm_memory_sync(mem);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    ASSERT(check_regions(mem, offsets, REGION_COUNT / 2, REGION_COUNT, 1));
+
+    ipm_shm_heap_close(heap);
+    ipm_memory_close(mem);
+
+    //  Processes allocate and free at the same time through shared free lists, while the heap grows
+    res = ipm_memory_create(&ctx, 4096, "heap_stress_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_shm_heap_create(mem, &heap);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    pid_t children[STRESS_PROCESSES];
+    for (unsigned i = 0; i < STRESS_PROCESSES; ++i)
+    {
+        children[i] = fork();
+        ASSERT(children[i] != -1);
+        if (children[i] == 0)
+        {
+            ipm_memory_clean(mem);
+            _exit(run_stress(&ctx, i));
+        }
+    }
+    for (unsigned i = 0; i < STRESS_PROCESSES; ++i)
+    {
+        ASSERT(waitpid(children[i], &ret_v, 0) == children[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+    ipm_shm_heap_close(heap);
+    ipm_memory_close(mem);
+    return 0;
+}
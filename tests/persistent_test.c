@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <string.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+#include <unistd.h>
+#include <wait.h>
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    char directory[] = "/tmp/ipm_persistent_XXXXXX";
+    ASSERT(mkdtemp(directory) != NULL);
+
+    ipm_memory* mem = NULL;
+    ipm_result res = ipm_memory_create_persistent(&ctx, directory, 69, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    snprintf(ipm_memory_pointer(mem), 32, "Persistent hello");
+
+    pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        //  Child opens the block, claims a part of it and "crashes" without closing it
+        ipm_memory_clean(mem);
+        ipm_memory* mem_child;
+        ipm_id claim_id;
+        res = ipm_memory_open_persistent(&ctx, directory, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_memory_claim_region(mem_child, IPM_ACCESS_MODE_READ_WRITE, 0, 32, &claim_id);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        _exit(EXIT_SUCCESS);
+    }
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+    ASSERT(ipm_memory_get_info(mem).active_claims == 1);
+    res = ipm_memory_flush(mem, 0, 32);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_memory_close(mem);
+
+    //  No process has the block open anymore, so opening it again recovers it
+    res = ipm_memory_open_persistent(&ctx, directory, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_ref_count(mem) == 1);
+    ASSERT(ipm_memory_get_info(mem).active_claims == 0);
+    ASSERT(strcmp(ipm_memory_pointer(mem), "Persistent hello") == 0);
+    ipm_memory_close(mem);
+
+    res = ipm_memory_remove_persistent(&ctx, directory, "cool_block");
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    //  This should report error message if correct, since the block was removed
+    res = ipm_memory_open_persistent(&ctx, directory, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_ERR_DOES_NOT_EXIST);
+    ASSERT(rmdir(directory) == 0);
+
+    return 0;
+}
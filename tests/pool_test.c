@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_pool.h>
+
+enum
+{
+    OBJECT_COUNT = 1000,
+    CHILD_COUNT = 4,
+    CYCLE_COUNT = 20000,
+    HELD_COUNT = 100,
+};
+
+struct record_T
+{
+    uint32_t owner;
+    uint32_t sequence;
+    char payload[40];
+};
+typedef struct record_T record;
+
+static int run_child(const ipm_context* ctx, uint32_t owner)
+{
+    ipm_memory* mem;
+    ipm_pool* pool;
+    ipm_result res = ipm_memory_open(ctx, "pool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_pool_object_size(pool) == sizeof(record));
+    char* const ptr = ipm_memory_pointer(mem);
+
+    //  Each object is marked when allocated and checked before being freed, so giving one out twice is caught
+    size_t held[HELD_COUNT];
+    for (unsigned i = 0; i < CYCLE_COUNT; ++i)
+    {
+        const unsigned slot = i % HELD_COUNT;
+        if (i >= HELD_COUNT)
+        {
+            const record* const r = (const record*)(ptr + held[slot]);
+            ASSERT(r->owner == owner && r->sequence == i - HELD_COUNT);
+            res = ipm_pool_free(pool, held[slot]);
+            ASSERT(res == IPM_RESULT_SUCCESS);
+        }
+        res = ipm_pool_alloc(pool, held + slot);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        record* const r = (record*)(ptr + held[slot]);
+        r->owner = owner;
+        r->sequence = i;
+    }
+    for (unsigned i = 0; i < HELD_COUNT; ++i)
+    {
+        res = ipm_pool_free(pool, held[i]);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    ipm_pool_close(pool);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "pool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_pool* pool;
+    res = ipm_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_ERR_BAD_INIT);
+    res = ipm_pool_create(mem, sizeof(record), OBJECT_COUNT, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Every object can be allocated once, after which the pool is empty until one is freed
+    size_t offsets[OBJECT_COUNT];
+    for (unsigned i = 0; i < OBJECT_COUNT; ++i)
+    {
+        res = ipm_pool_alloc(pool, offsets + i);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(offsets[i] % 16 == 0);
+        ASSERT(i == 0 || offsets[i] != offsets[i - 1]);
+    }
+    size_t extra;
+    res = ipm_pool_alloc(pool, &extra);
+    ASSERT(res == IPM_RESULT_ERR_POOL_EMPTY);
+    res = ipm_pool_free(pool, offsets[0] + 1);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    for (unsigned i = 0; i < OBJECT_COUNT; ++i)
+    {
+        res = ipm_pool_free(pool, offsets[i]);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    res = ipm_pool_alloc(pool, &extra);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_pool_free(pool, extra);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_pool_close(pool);
+
+    //  Several processes allocate and free at the same time
+    pid_t children[CHILD_COUNT];
+    for (unsigned i = 0; i < CHILD_COUNT; ++i)
+    {
+        children[i] = fork();
+        ASSERT(children[i] != -1);
+        if (children[i] == 0)
+        {
+            ipm_memory_clean(mem);
+            _exit(run_child(&ctx, i + 1));
+        }
+    }
+    for (unsigned i = 0; i < CHILD_COUNT; ++i)
+    {
+        int ret_v;
+        ASSERT(waitpid(children[i], &ret_v, 0) == children[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+
+    //  All objects went back to the pool once the children closed their handles
+    res = ipm_pool_open(mem, &pool);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    for (unsigned i = 0; i < OBJECT_COUNT; ++i)
+    {
+        res = ipm_pool_alloc(pool, offsets + i);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    res = ipm_pool_alloc(pool, &extra);
+    ASSERT(res == IPM_RESULT_ERR_POOL_EMPTY);
+    ipm_pool_close(pool);
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_queue.h>
+
+enum
+{
+    PRODUCER_COUNT = 3,
+    CONSUMER_COUNT = 3,
+    ELEMENT_COUNT = 100000,     //  Pushed by each producer
+    BATCH_SIZE = 8,
+};
+
+struct element_T
+{
+    uint32_t producer;
+    uint32_t index;
+};
+typedef struct element_T element;
+
+struct totals_T
+{
+    _Atomic uint64_t popped;
+    _Atomic uint64_t index_sum[PRODUCER_COUNT];
+};
+typedef struct totals_T totals;
+
+static int run_producer(const ipm_context* ctx, uint32_t producer)
+{
+    ipm_memory* mem;
+    ipm_queue* queue;
+    ipm_result res = ipm_memory_open(ctx, "queue_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_queue_open(mem, &queue);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    element batch[BATCH_SIZE];
+    for (uint32_t i = 0; i < ELEMENT_COUNT;)
+    {
+        unsigned count = 0;
+        while (count < BATCH_SIZE && i + count < ELEMENT_COUNT)
+        {
+            batch[count] = (element){.producer = producer, .index = i + count};
+            count += 1;
+        }
+        unsigned pushed;
+        res = ipm_queue_push_wait(queue, batch, count, 10000, &pushed);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        i += pushed;
+    }
+    ipm_queue_close(queue);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+static int run_consumer(const ipm_context* ctx, totals* shared_totals)
+{
+    ipm_memory* mem;
+    ipm_queue* queue;
+    ipm_result res = ipm_memory_open(ctx, "queue_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_queue_open(mem, &queue);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    element batch[BATCH_SIZE];
+    while (atomic_load(&shared_totals->popped) < (uint64_t)PRODUCER_COUNT * ELEMENT_COUNT)
+    {
+        unsigned popped;
+        res = ipm_queue_pop_wait(queue, batch, BATCH_SIZE, 100, &popped);
+        if (res == IPM_RESULT_ERR_TIMED_OUT)
+        {
+            continue;
+        }
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        for (unsigned i = 0; i < popped; ++i)
+        {
+            ASSERT(batch[i].producer < PRODUCER_COUNT && batch[i].index < ELEMENT_COUNT);
+            atomic_fetch_add(&shared_totals->index_sum[batch[i].producer], batch[i].index);
+        }
+        atomic_fetch_add(&shared_totals->popped, popped);
+    }
+    ipm_queue_close(queue);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "queue_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_queue* queue;
+    res = ipm_queue_open(mem, &queue);
+    ASSERT(res == IPM_RESULT_ERR_BAD_INIT);
+    //  Capacities whose slots would not fit into memory are refused, rather than rounded up forever or wrapped around
+    res = ipm_queue_create(mem, sizeof(element), SIZE_MAX, &queue);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+    res = ipm_queue_create(mem, (size_t)1 << 32, (size_t)1 << 32, &queue);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+    res = ipm_queue_create(mem, sizeof(element), 6, &queue);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_queue_element_size(queue) == sizeof(element));
+
+    //  Capacity is rounded up to 8, and elements come out in the order they went in
+    element batch[10];
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        batch[i] = (element){.producer = 0, .index = i};
+    }
+    unsigned count;
+    res = ipm_queue_pop(queue, batch, 1, &count);
+    ASSERT(res == IPM_RESULT_ERR_EMPTY && count == 0);
+    res = ipm_queue_pop_wait(queue, batch, 1, 10, &count);
+    ASSERT(res == IPM_RESULT_ERR_TIMED_OUT);
+    res = ipm_queue_push(queue, batch, 10, &count);
+    ASSERT(res == IPM_RESULT_SUCCESS && count == 8);
+    res = ipm_queue_push(queue, batch + 8, 2, &count);
+    ASSERT(res == IPM_RESULT_ERR_FULL && count == 0);
+    res = ipm_queue_push_wait(queue, batch + 8, 2, 10, &count);
+    ASSERT(res == IPM_RESULT_ERR_TIMED_OUT);
+    element out[10];
+    res = ipm_queue_pop(queue, out, 3, &count);
+    ASSERT(res == IPM_RESULT_SUCCESS && count == 3);
+    res = ipm_queue_push(queue, batch + 8, 2, &count);
+    ASSERT(res == IPM_RESULT_SUCCESS && count == 2);
+    res = ipm_queue_pop(queue, out + 3, 10, &count);
+    ASSERT(res == IPM_RESULT_SUCCESS && count == 7);
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        ASSERT(out[i].index == i);
+    }
+    ipm_queue_close(queue);
+    res = ipm_queue_create(mem, sizeof(element), 256, &queue);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_queue_close(queue);
+
+    //  Several producers and consumers in separate processes, where every element must be popped exactly once
+    totals* const shared_totals = mmap(NULL, sizeof(totals), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT(shared_totals != MAP_FAILED);
+    memset(shared_totals, 0, sizeof(*shared_totals));
+    pid_t children[PRODUCER_COUNT + CONSUMER_COUNT];
+    for (unsigned i = 0; i < PRODUCER_COUNT + CONSUMER_COUNT; ++i)
+    {
+        children[i] = fork();
+        ASSERT(children[i] != -1);
+        if (children[i] == 0)
+        {
+            ipm_memory_clean(mem);
+            _exit(i < PRODUCER_COUNT ? run_producer(&ctx, i) : run_consumer(&ctx, shared_totals));
+        }
+    }
+    for (unsigned i = 0; i < PRODUCER_COUNT + CONSUMER_COUNT; ++i)
+    {
+        int ret_v;
+        ASSERT(waitpid(children[i], &ret_v, 0) == children[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+    ASSERT(atomic_load(&shared_totals->popped) == (uint64_t)PRODUCER_COUNT * ELEMENT_COUNT);
+    for (unsigned i = 0; i < PRODUCER_COUNT; ++i)
+    {
+        ASSERT(atomic_load(&shared_totals->index_sum[i]) == (uint64_t)ELEMENT_COUNT * (ELEMENT_COUNT - 1) / 2);
+    }
+    munmap(shared_totals, sizeof(*shared_totals));
+
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_ring.h>
+
+enum
+{
+    RECORD_COUNT = 1000000,
+    MAX_RECORD_SIZE = 200,
+};
+
+static size_t record_size(unsigned i)
+{
+    return 4 + (i * 31) % (MAX_RECORD_SIZE - 4);
+}
+
+static void fill_record(uint8_t* ptr, unsigned i)
+{
+    memcpy(ptr, &i, sizeof(i));
+    for (size_t j = sizeof(i); j < record_size(i); ++j)
+    {
+        ptr[j] = (uint8_t)(i + j);
+    }
+}
+
+static int check_record(const uint8_t* ptr, size_t size, unsigned i)
+{
+    unsigned value;
+    memcpy(&value, ptr, sizeof(value));
+    if (size != record_size(i) || value != i)
+    {
+        return 0;
+    }
+    for (size_t j = sizeof(i); j < size; ++j)
+    {
+        if (ptr[j] != (uint8_t)(i + j))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "ring_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_ring* ring;
+    res = ipm_ring_create(mem, 4096, &ring);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Records which wrap around the end of the ring are still contiguous
+    uint8_t buffer[4096];
+    size_t size;
+    res = ipm_ring_read(ring, buffer, sizeof(buffer), &size);
+    ASSERT(res == IPM_RESULT_ERR_EMPTY);
+    res = ipm_ring_wait(ring, 10);
+    ASSERT(res == IPM_RESULT_ERR_TIMED_OUT);
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        uint8_t record[MAX_RECORD_SIZE];
+        fill_record(record, i);
+        res = ipm_ring_write(ring, record, record_size(i));
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_ring_read(ring, buffer, sizeof(buffer), &size);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(check_record(buffer, size, i));
+    }
+    res = ipm_ring_write(ring, buffer, 4096);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+    res = ipm_ring_write(ring, buffer, 4000);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_ring_write(ring, buffer, 100);
+    ASSERT(res == IPM_RESULT_ERR_FULL);
+    res = ipm_ring_read(ring, buffer, 100, &size);
+    ASSERT(res == IPM_RESULT_ERR_BAD_SIZE);
+    ASSERT(size == 4000);
+    res = ipm_ring_read(ring, buffer, sizeof(buffer), &size);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_ring_close(ring);
+    res = ipm_ring_create(mem, 1 << 20, &ring);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_ring_close(ring);
+
+    //  Records are streamed from another process, with the reader sleeping whenever the ring is empty
+    const pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        ipm_memory_clean(mem);
+        ipm_memory* mem_child;
+        ipm_ring* ring_child;
+        res = ipm_memory_open(&ctx, "ring_block", IPM_ACCESS_MODE_READ_WRITE, &mem_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_ring_open(mem_child, &ring_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        for (unsigned i = 0; i < RECORD_COUNT; ++i)
+        {
+            void* ptr;
+            while ((res = ipm_ring_reserve(ring_child, record_size(i), &ptr)) == IPM_RESULT_ERR_FULL)
+            {
+                sched_yield();
+            }
+            ASSERT(res == IPM_RESULT_SUCCESS);
+            fill_record(ptr, i);
+            ipm_ring_commit(ring_child, record_size(i));
+        }
+        ipm_ring_close(ring_child);
+        ipm_memory_close(mem_child);
+        _exit(EXIT_SUCCESS);
+    }
+    res = ipm_ring_open(mem, &ring);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    for (unsigned i = 0; i < RECORD_COUNT; ++i)
+    {
+        const void* ptr;
+        while ((res = ipm_ring_peek(ring, &ptr, &size)) == IPM_RESULT_ERR_EMPTY)
+        {
+            res = ipm_ring_wait(ring, 1000);
+            ASSERT(res == IPM_RESULT_SUCCESS);
+        }
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(check_record(ptr, size, i));
+        ipm_ring_consume(ring);
+    }
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    res = ipm_ring_read(ring, buffer, sizeof(buffer), &size);
+    ASSERT(res == IPM_RESULT_ERR_EMPTY);
+
+    ipm_ring_close(ring);
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string.h>
+#include "test_common.h"
+#include <ipm/ipm_segment.h>
+#include <unistd.h>
+#include <wait.h>
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_segment* segment = NULL;
+    ipm_result res = ipm_segment_create(&ctx, 1 << 16, 4, "cool_segment", &segment);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    ipm_segment_block* first;
+    ipm_segment_block* second;
+    res = ipm_segment_block_create(segment, "first", 100, IPM_ACCESS_MODE_READ_WRITE, &first);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_segment_block_create(segment, "second", 1000, IPM_ACCESS_MODE_READ_WRITE, &second);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_segment_block_size(first) == 100);
+    ASSERT(ipm_segment_block_size(second) == 1000);
+    //  This should report error message if correct
+    ipm_segment_block* duplicate;
+    res = ipm_segment_block_create(segment, "first", 100, IPM_ACCESS_MODE_READ_WRITE, &duplicate);
+    ASSERT(res == IPM_RESULT_ERR_EXISTS);
+    //  This should report error message if correct, since it does not fit
+    res = ipm_segment_block_create(segment, "huge", 1 << 20, IPM_ACCESS_MODE_READ_WRITE, &duplicate);
+    ASSERT(res == IPM_RESULT_ERR_SEGMENT_FULL);
+
+    //  Blocks have separate claims, so a child can claim the second one while the first one is claimed
+    ipm_id claim_id;
+    res = ipm_segment_block_claim_region(first, IPM_ACCESS_MODE_READ_WRITE, 0, 100, &claim_id);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    snprintf(ipm_segment_block_pointer(first), 100, "First hello");
+
+    pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        ipm_segment_block_clean(first);
+        ipm_segment_block_clean(second);
+        ipm_segment_clean(segment);
+        ipm_segment* segment_child;
+        ipm_segment_block* block_child;
+        ipm_id child_claim;
+        res = ipm_segment_open(&ctx, "cool_segment", &segment_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_segment_block_open(segment_child, "second", IPM_ACCESS_MODE_READ_WRITE, &block_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_segment_block_claim_region(block_child, IPM_ACCESS_MODE_READ_WRITE, 0, 1000, &child_claim);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        snprintf(ipm_segment_block_pointer(block_child), 1000, "Second hello");
+        ipm_segment_block_close(block_child);
+
+        //  Claiming the first block has to wait until the parent releases it
+        res = ipm_segment_block_open(segment_child, "first", IPM_ACCESS_MODE_READ_ONLY, &block_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        res = ipm_segment_block_claim_region(block_child, IPM_ACCESS_MODE_READ_ONLY, 0, 100, &child_claim);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(strcmp(ipm_segment_block_pointer(block_child), "First hello, again") == 0);
+        ipm_segment_block_close(block_child);
+        ipm_segment_close(segment_child);
+        _exit(EXIT_SUCCESS);
+    }
+
+    //  Give the child time to get to the first block
+    usleep(100000);
+    snprintf(ipm_segment_block_pointer(first), 100, "First hello, again");
+    res = ipm_segment_block_release_region(first, claim_id);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    ASSERT(strcmp(ipm_segment_block_pointer(second), "Second hello") == 0);
+
+    //  Once the last handle is closed, the space of the block is reused and its contents are zeroed
+    ipm_segment_block_close(second);
+    res = ipm_segment_block_open(segment, "second", IPM_ACCESS_MODE_READ_WRITE, &second);
+    ASSERT(res == IPM_RESULT_ERR_DOES_NOT_EXIST);
+    res = ipm_segment_block_create(segment, "third", 500, IPM_ACCESS_MODE_READ_WRITE, &second);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(((const char*)ipm_segment_block_pointer(second))[0] == 0);
+
+    ipm_segment_block_close(second);
+    ipm_segment_block_close(first);
+    ipm_segment_close(segment);
+
+    return 0;
+}
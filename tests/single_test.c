@@ -1,7 +1,44 @@
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <wait.h>
+#include <string.h>
 #include "test_common.h"
 #include <ipm/ipm_memory.h>
 
+static int is_writable(int zero_fd, void* ptr)
+{
+    //  Kernel reports EFAULT instead of raising a signal when it can not write to the buffer
+    return read(zero_fd, ptr, 1) == 1 || errno != EFAULT;
+}
+
+static int has_vm_flag(const void* address, const char* flag)
+{
+    //  Flags of the mapping which holds the address show the access pattern advice applied to it
+    FILE* const smaps = fopen("/proc/self/smaps", "r");
+    ASSERT(smaps);
+    char line[512];
+    int in_mapping = 0, found = 0;
+    while (fgets(line, sizeof(line), smaps))
+    {
+        unsigned long begin, end;
+        if (sscanf(line, "%lx-%lx ", &begin, &end) == 2)
+        {
+            in_mapping = (unsigned long)address >= begin && (unsigned long)address < end;
+        }
+        else if (in_mapping && strncmp(line, "VmFlags:", 8) == 0)
+        {
+            for (const char* token = strtok(line + 8, " \n"); token; token = strtok(NULL, " \n"))
+            {
+                found |= strcmp(token, flag) == 0;
+            }
+        }
+    }
+    fclose(smaps);
+    return found;
+}
+
 int main()
 {
     const ipm_context ctx =
@@ -43,10 +80,240 @@ int main()
     printf("\nClaims at point 4:\n");
     print_claims(mem);
 
+    res = ipm_memory_set_numa_policy(mem, IPM_NUMA_POLICY_BIND, 1);
+    ASSERT(res == IPM_RESULT_SUCCESS || res == IPM_RESULT_ERR_NOT_SUPPORTED);
+    if (res == IPM_RESULT_SUCCESS)
+    {
+        res = ipm_memory_resize_grow(mem, 4 * block_info.block_size);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        char* const ptr = ipm_memory_pointer(mem);
+        ASSERT(ptr);
+        ptr[0] = 1;
+        size_t pages_per_node[1], not_resident;
+        res = ipm_memory_numa_residency(mem, 0, 4 * block_info.block_size, 1, pages_per_node, &not_resident);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ASSERT(pages_per_node[0] >= 1);
+    }
+
+    res = ipm_memory_resize_grow(mem, 8 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    char* ptr = ipm_memory_pointer(mem);
+    ptr[5 * 4096] = 'A';
+    res = ipm_memory_discard(mem, 4 * 4096, 2 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ptr[5 * 4096] == 0);
+    res = ipm_memory_claim_region(mem, IPM_ACCESS_MODE_READ_WRITE, 3 * 4096, 16, &claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_resize_shrink(mem, 4096);
+    ASSERT(res == IPM_RESULT_ERR_REGION_CLAIMED);
+    res = ipm_memory_release_region(mem, claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_resize_shrink(mem, 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_get_info(mem).block_size == 4096);
+    ASSERT(!ipm_memory_needs_sync(mem));
+
+    //  Claim which waits while another process shrinks the block is refused once it wakes up, since it is past the end
+    res = ipm_memory_resize_grow(mem, 4 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    const size_t capacity = claim_capacity(mem);
+    ipm_id* const filling_ids = malloc(capacity * sizeof(*filling_ids));
+    ASSERT(filling_ids);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        res = ipm_memory_claim_region(mem, IPM_ACCESS_MODE_READ_ONLY, 0, 16, filling_ids + i);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    const pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        ipm_memory_clean(mem);
+        ipm_memory* mem_child;
+        res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        //  List is full, so this waits for a claim to be released
+        res = ipm_memory_claim_region(mem_child, IPM_ACCESS_MODE_READ_WRITE, 3 * 4096, 16, &claim_id1);
+        ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+        ipm_memory_close(mem_child);
+        _exit(EXIT_SUCCESS);
+    }
+    usleep(100000);
+    res = ipm_memory_resize_shrink(mem, 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        res = ipm_memory_release_region(mem, filling_ids[i]);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    free(filling_ids);
+    int ret_v;
+    ASSERT(waitpid(pid, &ret_v, 0) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    ASSERT(ipm_memory_get_info(mem).active_claims == 0);
+
+    //  Access pattern hints are kept when the mapping changes, others only act right away
+    res = ipm_memory_advise(mem, 0, 4096, IPM_MEMORY_HINT_SEQUENTIAL | IPM_MEMORY_HINT_SHARED);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_advise(mem, 16, 16, IPM_MEMORY_HINT_RANDOM);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_advise(mem, 0, 4096, IPM_MEMORY_HINT_WILL_NEED);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_advise(mem, 0, 4096, IPM_MEMORY_HINT_COLD);
+    ASSERT(res == IPM_RESULT_SUCCESS || res == IPM_RESULT_ERR_NOT_SUPPORTED);
+    res = ipm_memory_advise(mem, 4096, 4096, IPM_MEMORY_HINT_NORMAL);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    ASSERT(has_vm_flag(ipm_memory_pointer(mem), "rr"));
+    //  Later openers apply only the hints which were shared
+    ipm_memory* opener;
+    res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &opener);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(has_vm_flag(ipm_memory_pointer(opener), "sr"));
+    ASSERT(!has_vm_flag(ipm_memory_pointer(opener), "rr"));
+    //  Growing past the reserved address range moves the mappings, which get their hints again
+    res = ipm_memory_resize_grow(mem, 1 << 27);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_pointer(mem) != ptr);
+    ASSERT(has_vm_flag(ipm_memory_pointer(mem), "rr"));
+    res = ipm_memory_sync(opener);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(has_vm_flag(ipm_memory_pointer(opener), "sr"));
+    ipm_memory_close(opener);
+    res = ipm_memory_resize_shrink(mem, 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Protection of ranges is changed in place and survives the block growing
+    const int zero_fd = open("/dev/zero", O_RDONLY);
+    ASSERT(zero_fd >= 0);
+    res = ipm_memory_resize_grow(mem, 4 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ptr = ipm_memory_pointer(mem);
+    res = ipm_memory_protect_range(mem, 4096, 2 * 4096, IPM_ACCESS_MODE_READ_ONLY);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_protect_range(mem, 2 * 4096, 4096, IPM_ACCESS_MODE_READ_WRITE);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(is_writable(zero_fd, ptr));
+    ASSERT(!is_writable(zero_fd, ptr + 4096));
+    ASSERT(is_writable(zero_fd, ptr + 2 * 4096));
+    res = ipm_memory_resize_grow(mem, 8 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_pointer(mem) == ptr);
+    ASSERT(!is_writable(zero_fd, ptr + 4096));
+    ASSERT(is_writable(zero_fd, ptr + 6 * 4096));
+    res = ipm_memory_change_access(mem, IPM_ACCESS_MODE_READ_ONLY);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_pointer(mem) == ptr);
+    ASSERT(!is_writable(zero_fd, ptr));
+    res = ipm_memory_protect_range(mem, 0, 4096, IPM_ACCESS_MODE_READ_WRITE);
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    res = ipm_memory_change_access(mem, IPM_ACCESS_MODE_READ_WRITE);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(is_writable(zero_fd, ptr + 4096));
+    close(zero_fd);
+
+    //  Region is transferred between blocks both when pages line up and when they do not
+    ipm_memory* other;
+    res = ipm_memory_create(&ctx, 8 * 4096, "other_block", IPM_ACCESS_MODE_READ_WRITE, &other);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ptr = ipm_memory_pointer(mem);
+    for (unsigned i = 0; i < 8 * 4096; ++i)
+    {
+        ptr[i] = (char)(i * 7 + 3);
+    }
+    res = ipm_memory_transfer(mem, 100, other, 100, 5 * 4096 + 50);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp((const char*)ipm_memory_pointer(other) + 100, ptr + 100, 5 * 4096 + 50) == 0);
+    res = ipm_memory_transfer(mem, 10, other, 4096 + 3, 2 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp((const char*)ipm_memory_pointer(other) + 4096 + 3, ptr + 10, 2 * 4096) == 0);
+    res = ipm_memory_transfer(other, 0, mem, 0, 8 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp(ptr, ipm_memory_pointer(other), 8 * 4096) == 0);
+    res = ipm_memory_transfer(mem, 0, other, 4096, 8 * 4096);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    res = ipm_memory_transfer(mem, 0, mem, 4096, 2 * 4096);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    res = ipm_memory_transfer(mem, 0, mem, 4 * 4096, 2 * 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(memcmp(ptr, ptr + 4 * 4096, 2 * 4096) == 0);
+    res = ipm_memory_protect_range(other, 2 * 4096, 4096, IPM_ACCESS_MODE_READ_ONLY);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_transfer(mem, 0, other, 4096 + 100, 4096);
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    res = ipm_memory_transfer(mem, 0, other, 4096, 2 * 4096);
+    ASSERT(res == IPM_RESULT_ERR_BAD_ACCESS);
+    res = ipm_memory_transfer(mem, 0, other, 3 * 4096, 4096);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_memory_close(other);
+
+    //  Opening the block through the cache again gives the same handle
+    ipm_memory* cached_1;
+    ipm_memory* cached_2;
+    res = ipm_memory_open_cached(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &cached_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_open_cached(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &cached_2);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(cached_1 == cached_2);
+    ASSERT(ipm_memory_ref_count(mem) == 2);
+    ipm_memory_close(cached_2);
+    ASSERT(ipm_memory_ref_count(mem) == 2);
+    ipm_memory_close(cached_1);
+    ASSERT(ipm_memory_ref_count(mem) == 1);
+
+    //  Growing past the reserved address range moves the mapping, together with the claim list
+    res = ipm_memory_claim_region(mem, IPM_ACCESS_MODE_READ_WRITE, 0, 16, &claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ptr = ipm_memory_pointer(mem);
+    ptr[0] = 'B';
+    res = ipm_memory_resize_grow(mem, 1 << 27);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ptr = ipm_memory_pointer(mem);
+    ASSERT(ptr[0] == 'B');
+    ptr[(1 << 27) - 1] = 'C';
+    ASSERT(ipm_memory_get_info(mem).active_claims == 1);
+    res = ipm_memory_release_region(mem, claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
     ipm_memory_close(mem);
     res = ipm_memory_open(&ctx, "cool_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
     ASSERT(res == IPM_RESULT_ERR_DOES_NOT_EXIST);
 
+    //  Sealed block can only be read, which does not go through the claim list
+    ipm_memory* reader;
+    res = ipm_memory_create(&ctx, 4096, "sealed_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_open(&ctx, "sealed_block", IPM_ACCESS_MODE_READ_WRITE, &reader);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_claim_region(mem, IPM_ACCESS_MODE_READ_WRITE, 0, 16, &claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ((char*)ipm_memory_pointer(mem))[0] = 'D';
+    res = ipm_memory_seal(mem);
+    ASSERT(res == IPM_RESULT_ERR_REGION_CLAIMED);
+    res = ipm_memory_release_region(mem, claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_seal(mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_is_sealed(reader));
+    ASSERT(ipm_memory_needs_sync(reader));
+    res = ipm_memory_sync(reader);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_get_info(reader).memory_access_mode == IPM_ACCESS_MODE_READ_ONLY);
+    res = ipm_memory_claim_region(reader, IPM_ACCESS_MODE_READ_WRITE, 0, 16, &claim_id1);
+    ASSERT(res == IPM_RESULT_ERR_SEALED);
+    res = ipm_memory_claim_region(reader, IPM_ACCESS_MODE_READ_ONLY, 0, 16, &claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(claim_id1 == IPM_SEALED_CLAIM_ID);
+    ASSERT(ipm_memory_get_info(reader).active_claims == 0);
+    ASSERT(((const char*)ipm_memory_pointer(reader))[0] == 'D');
+    res = ipm_memory_release_region(reader, claim_id1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_resize_grow(reader, 2 * 4096);
+    ASSERT(res == IPM_RESULT_ERR_SEALED);
+    res = ipm_memory_change_access(reader, IPM_ACCESS_MODE_READ_WRITE);
+    ASSERT(res == IPM_RESULT_ERR_SEALED);
+    ipm_memory_close(reader);
+    ipm_memory_close(mem);
+
 
     return 0;
 }
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+#include <unistd.h>
+#include <wait.h>
+
+enum {BLOCK_SIZE = 1 << 24, PAGE_SIZE = 4096};
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem = NULL;
+    ipm_result res = ipm_memory_create(&ctx, BLOCK_SIZE, "snapshot_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    memset(ipm_memory_pointer(mem), 'A', BLOCK_SIZE);
+
+    pid_t pid = fork();
+    ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        ipm_memory_clean(mem);
+        ipm_memory* mem_child;
+        ipm_id claim_id;
+        res = ipm_memory_open(&ctx, "snapshot_block", IPM_ACCESS_MODE_READ_WRITE, &mem_child);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        char* const buffer = ipm_memory_pointer(mem_child);
+        //  Write claim made before the snapshot, which it has to wait for
+        res = ipm_memory_claim_region(mem_child, IPM_ACCESS_MODE_READ_WRITE, 0, PAGE_SIZE, &claim_id);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        buffer[0] = 'X';
+        sleep(1);
+        res = ipm_memory_release_region(mem_child, claim_id);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        //  Write claim made after the snapshot started, which must not be visible in it
+        res = ipm_memory_claim_region(mem_child, IPM_ACCESS_MODE_READ_WRITE, 100 * PAGE_SIZE, PAGE_SIZE, &claim_id);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        buffer[100 * PAGE_SIZE] = 'C';
+        res = ipm_memory_release_region(mem_child, claim_id);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        ipm_memory_close(mem_child);
+        exit(EXIT_SUCCESS);
+    }
+
+    usleep(300000);
+    ipm_snapshot* snapshot;
+    res = ipm_memory_snapshot(mem, &snapshot);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_snapshot_size(snapshot) == BLOCK_SIZE);
+
+    int ret_v;
+    ASSERT(wait(&ret_v) == pid);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+
+    const char* const snapshot_data = ipm_snapshot_pointer(snapshot);
+    const char* const live_data = ipm_memory_pointer(mem);
+    ASSERT(snapshot_data[0] == 'X');
+    ASSERT(snapshot_data[100 * PAGE_SIZE] == 'A');
+    ASSERT(snapshot_data[BLOCK_SIZE - 1] == 'A');
+    ASSERT(live_data[100 * PAGE_SIZE] == 'C');
+    ipm_snapshot_release(snapshot);
+
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -9,7 +9,7 @@
 
 void print_claims(const ipm_memory* memory)
 {
-    ipm_claim_list* const list = memory->active_claims.memory;
+    ipm_claim_list* const list = memory->real_memory.metadata;
     assert(list);
     for (unsigned i = 0; i < list->count; ++i)
     {
@@ -18,6 +18,13 @@ void print_claims(const ipm_memory* memory)
     }
 }
 
+size_t claim_capacity(const ipm_memory* memory)
+{
+    const ipm_claim_list* const list = memory->real_memory.metadata;
+    assert(list);
+    return list->capacity;
+}
+
 void common_error_report_fn(const char* msg, const char* file, int line, const char* func, void* param)
 {
     (void) param;
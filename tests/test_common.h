@@ -10,6 +10,8 @@
 
 void print_claims(const ipm_memory* memory);
 
+size_t claim_capacity(const ipm_memory* memory);
+
 void common_error_report_fn(const char* msg, const char* file, int line, const char* func, void* param);
 
 void* allocate_callback(void* state, size_t size);
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_triple_buffer.h>
+
+enum
+{
+    READER_COUNT = 3,
+    STATE_WORDS = 32,
+    STATE_COUNT = 100000,   //  States published while the readers run
+};
+
+static void write_state(ipm_triple_buffer* buffer, uint64_t value)
+{
+    void* data;
+    ipm_result res = ipm_triple_buffer_write_begin(buffer, &data);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    uint64_t* const words = data;
+    for (unsigned i = 0; i < STATE_WORDS; ++i)
+    {
+        words[i] = value;
+    }
+}
+
+//  Each state is filled with its own version, so a state that was changed while it was read is easy to spot
+static int run_reader(const ipm_context* ctx)
+{
+    ipm_memory* mem;
+    ipm_triple_buffer* buffer;
+    ipm_result res = ipm_memory_open(ctx, "triple_buffer_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_triple_buffer_open(mem, &buffer);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    uint64_t last = 0;
+    while (last != STATE_COUNT)
+    {
+        const void* data;
+        const uint64_t version = ipm_triple_buffer_read_begin(buffer, &data);
+        ASSERT(version >= last);
+        const uint64_t* const words = data;
+        for (unsigned i = 0; i < STATE_WORDS; ++i)
+        {
+            ASSERT(words[i] == version);
+        }
+        ipm_triple_buffer_read_end(buffer);
+        last = version;
+    }
+    ipm_triple_buffer_close(buffer);
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "triple_buffer_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ipm_triple_buffer* writer;
+    res = ipm_triple_buffer_open(mem, &writer);
+    ASSERT(res == IPM_RESULT_ERR_BAD_INIT);
+    res = ipm_triple_buffer_create(mem, STATE_WORDS * sizeof(uint64_t), 1, &writer);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_triple_buffer_size(writer) == STATE_WORDS * sizeof(uint64_t));
+    ipm_triple_buffer* reader;
+    res = ipm_triple_buffer_open(mem, &reader);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Before anything is published, the state is all zeros
+    const void* data;
+    ASSERT(ipm_triple_buffer_read_begin(reader, &data) == 0);
+    ASSERT(((const uint64_t*)data)[0] == 0 && ((const uint64_t*)data)[STATE_WORDS - 1] == 0);
+    ipm_triple_buffer_read_end(reader);
+
+    //  Reader keeps its state while the writer publishes newer ones, and gets the latest one when it reads again
+    write_state(writer, 1);
+    ASSERT(ipm_triple_buffer_publish(writer) == 1);
+    const void* held;
+    ASSERT(ipm_triple_buffer_read_begin(reader, &held) == 1);
+    for (uint64_t i = 2; i <= 10; ++i)
+    {
+        write_state(writer, i);
+        ASSERT(ipm_triple_buffer_publish(writer) == i);
+        ASSERT(((const uint64_t*)held)[0] == 1);
+    }
+    ipm_triple_buffer_read_end(reader);
+    ASSERT(ipm_triple_buffer_read_begin(reader, &data) == 10);
+    ASSERT(((const uint64_t*)data)[STATE_WORDS - 1] == 10);
+
+    //  Second reader holding a buffer is one more than the buffers were made for, so the writer has none left
+    ipm_triple_buffer* extra_reader;
+    res = ipm_triple_buffer_open(mem, &extra_reader);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    write_state(writer, 11);
+    ASSERT(ipm_triple_buffer_publish(writer) == 11);
+    ASSERT(ipm_triple_buffer_read_begin(extra_reader, &held) == 11);
+    write_state(writer, 12);
+    ASSERT(ipm_triple_buffer_publish(writer) == 12);
+    void* free_data;
+    res = ipm_triple_buffer_write_begin(writer, &free_data);
+    ASSERT(res == IPM_RESULT_ERR_REGION_CLAIMED);
+    ipm_triple_buffer_close(extra_reader);
+    ipm_triple_buffer_close(reader);
+    ipm_triple_buffer_close(writer);
+
+    //  Readers in other processes, which only ever see whole states, and never older ones than they saw before
+    res = ipm_triple_buffer_create(mem, STATE_WORDS * sizeof(uint64_t), READER_COUNT, &writer);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    pid_t children[READER_COUNT];
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        children[i] = fork();
+        ASSERT(children[i] != -1);
+        if (children[i] == 0)
+        {
+            ipm_memory_clean(mem);
+            _exit(run_reader(&ctx));
+        }
+    }
+    for (uint64_t i = 1; i <= STATE_COUNT; ++i)
+    {
+        write_state(writer, i);
+        ASSERT(ipm_triple_buffer_publish(writer) == i);
+    }
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        int ret_v;
+        ASSERT(waitpid(children[i], &ret_v, 0) == children[i]);
+        ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+    }
+    ipm_triple_buffer_close(writer);
+
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <wait.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+
+enum
+{
+    PING_OFFSET = 0,
+    PONG_OFFSET = 64,
+    ROUND_COUNT = 10000,
+};
+
+static _Atomic uint32_t* word_at(ipm_memory* mem, size_t offset)
+{
+    return (_Atomic uint32_t*)((uint8_t*)ipm_memory_pointer(mem) + offset);
+}
+
+//  Waits until the word no longer holds the given value, which also covers waking up without a notification
+static void wait_for_change(ipm_memory* mem, size_t offset, uint32_t value)
+{
+    while (atomic_load(word_at(mem, offset)) == value)
+    {
+        const ipm_result res = ipm_memory_wait(mem, offset, value, 10000);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+}
+
+static int run_ponger(const ipm_context* ctx)
+{
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_open(ctx, "wait_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    for (uint32_t i = 0; i < ROUND_COUNT; ++i)
+    {
+        wait_for_change(mem, PING_OFFSET, i);
+        atomic_store(word_at(mem, PONG_OFFSET), i + 1);
+        res = ipm_memory_notify(mem, PONG_OFFSET, 1);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+    }
+    ipm_memory_close(mem);
+    return 0;
+}
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+
+    ipm_memory* mem;
+    ipm_result res = ipm_memory_create(&ctx, 4096, "wait_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    atomic_store(word_at(mem, PING_OFFSET), 0);
+    atomic_store(word_at(mem, PONG_OFFSET), 0);
+
+    res = ipm_memory_wait(mem, 2, 0, 10);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    res = ipm_memory_wait(mem, 4096, 0, 10);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    res = ipm_memory_notify(mem, 4094, 1);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    //  Word does not hold the expected value, so there is no wait
+    res = ipm_memory_wait(mem, PING_OFFSET, 1, 10000);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_wait(mem, PING_OFFSET, 0, 10);
+    ASSERT(res == IPM_RESULT_ERR_TIMED_OUT);
+    res = ipm_memory_notify(mem, PING_OFFSET, UINT32_MAX);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Two processes take turns, each sleeping until the other changes its word
+    const pid_t child = fork();
+    ASSERT(child != -1);
+    if (child == 0)
+    {
+        ipm_memory_clean(mem);
+        _exit(run_ponger(&ctx));
+    }
+    for (uint32_t i = 0; i < ROUND_COUNT; ++i)
+    {
+        atomic_store(word_at(mem, PING_OFFSET), i + 1);
+        res = ipm_memory_notify(mem, PING_OFFSET, 1);
+        ASSERT(res == IPM_RESULT_SUCCESS);
+        wait_for_change(mem, PONG_OFFSET, i);
+        ASSERT(atomic_load(word_at(mem, PONG_OFFSET)) == i + 1);
+    }
+    int ret_v;
+    ASSERT(waitpid(child, &ret_v, 0) == child);
+    ASSERT(WIFEXITED(ret_v) && WEXITSTATUS(ret_v) == EXIT_SUCCESS);
+
+    ipm_memory_close(mem);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include "test_common.h"
+#include <ipm/ipm_memory.h>
+
+int main()
+{
+    const ipm_context ctx =
+            {
+            .report_param = NULL,
+            .report_callback = common_error_report_fn,
+            .alloc_callback = allocate_callback,
+            .free_callback = deallocate_callback,
+            .alloc_param = state_ptr,
+            .free_param = state_ptr,
+            };
+    const size_t block_size = 8 * IPM_MEMORY_WINDOW_GRANULARITY;
+
+    ipm_memory* mem = NULL;
+    ipm_result res = ipm_memory_create(&ctx, block_size, "window_block", IPM_ACCESS_MODE_READ_WRITE, &mem);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    char* const whole = ipm_memory_pointer(mem);
+
+    ipm_memory* windowed = NULL;
+    res = ipm_memory_open_windowed(&ctx, "window_block", IPM_ACCESS_MODE_READ_WRITE, 2, &windowed);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_pointer(windowed) == NULL);
+    ASSERT(ipm_memory_get_info(windowed).block_size == block_size);
+
+    //  Writes through a window are seen through the whole mapping and the other way around
+    char* ptr;
+    res = ipm_memory_map_window(windowed, 5 * IPM_MEMORY_WINDOW_GRANULARITY + 100, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ptr[0] = 'A';
+    ASSERT(whole[5 * IPM_MEMORY_WINDOW_GRANULARITY + 100] == 'A');
+    whole[5 * IPM_MEMORY_WINDOW_GRANULARITY + 101] = 'B';
+    ASSERT(ptr[1] == 'B');
+
+    //  Windows used by claims are not unmapped, so once all of them are, no other region can be mapped
+    char* claimed_1;
+    char* claimed_2;
+    ipm_id claim_1, claim_2, claim_3;
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_WRITE, 0, 64, &claim_1, (void**)&claimed_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_WRITE, block_size - 64, 64, &claim_2, (void**)&claimed_2);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_get_info(windowed).active_claims == 2);
+    claimed_1[0] = 'C';
+    claimed_2[63] = 'D';
+    ASSERT(whole[0] == 'C');
+    ASSERT(whole[block_size - 1] == 'D');
+    res = ipm_memory_map_window(windowed, 3 * IPM_MEMORY_WINDOW_GRANULARITY, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_ERR_NO_FREE_WINDOW);
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_ONLY, 3 * IPM_MEMORY_WINDOW_GRANULARITY, 16, &claim_3, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_ERR_NO_FREE_WINDOW);
+
+    //  Regions within the same window share it
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_WRITE, 4096, 64, &claim_3, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ptr == claimed_1 + 4096);
+    res = ipm_memory_release_window(windowed, claim_3, ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    res = ipm_memory_release_window(windowed, claim_1, claimed_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_map_window(windowed, 3 * IPM_MEMORY_WINDOW_GRANULARITY, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ptr[0] = 'E';
+    ASSERT(whole[3 * IPM_MEMORY_WINDOW_GRANULARITY] == 'E');
+    res = ipm_memory_release_window(windowed, claim_2, claimed_2);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Windows are no longer kept by claims released without ipm_memory_release_window
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_WRITE, 0, 64, &claim_1, (void**)&claimed_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_WRITE, block_size - 64, 64, &claim_2, (void**)&claimed_2);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_release_region(windowed, claim_1);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_claim_window(windowed, IPM_ACCESS_MODE_READ_WRITE, 3 * IPM_MEMORY_WINDOW_GRANULARITY, 64, &claim_1, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_map_window(windowed, 0, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_ERR_NO_FREE_WINDOW);
+    res = ipm_memory_remove_all_active_claims(windowed);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_map_window(windowed, 0, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_map_window(windowed, 5 * IPM_MEMORY_WINDOW_GRANULARITY, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    //  Windowed handle can not claim without a window, nor do anything that needs the whole block mapped
+    res = ipm_memory_claim_region(windowed, IPM_ACCESS_MODE_READ_ONLY, 0, 16, &claim_1);
+    ASSERT(res == IPM_RESULT_ERR_NOT_SUPPORTED);
+    ipm_snapshot* snapshot;
+    res = ipm_memory_snapshot(windowed, &snapshot);
+    ASSERT(res == IPM_RESULT_ERR_NOT_SUPPORTED);
+
+    //  Windows past the end of the block are dropped once it shrinks
+    res = ipm_memory_resize_shrink(mem, 2 * IPM_MEMORY_WINDOW_GRANULARITY);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    ASSERT(ipm_memory_needs_sync(windowed));
+    res = ipm_memory_sync(windowed);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+    res = ipm_memory_map_window(windowed, 3 * IPM_MEMORY_WINDOW_GRANULARITY, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_ERR_BAD_VALUE);
+    res = ipm_memory_map_window(windowed, IPM_MEMORY_WINDOW_GRANULARITY, 16, (void**)&ptr);
+    ASSERT(res == IPM_RESULT_SUCCESS);
+
+    ipm_memory_close(windowed);
+    ipm_memory_close(mem);
+
+    return 0;
+}